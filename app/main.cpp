@@ -2,9 +2,30 @@
 #include <Eigen/Core>
 #include "CLI11.hpp"
 #include "particle.hpp"
+#include "particleSystem.hpp"
 #include "nbody.hpp"
+#include "gravityKernel.hpp"
+#include "directSolver.hpp"
+#include "symmetricDirectSolver.hpp"
+#include "tiledDirectSolver.hpp"
+#include "barnesHutSolver.hpp"
+#include "fmmSolver.hpp"
+#include "particleMeshSolver.hpp"
+#include "eulerIntegrator.hpp"
+#include "symplecticIntegrator.hpp"
+#include "wisdomHolmanIntegrator.hpp"
+#include "ias15Integrator.hpp"
+#include "blockTimestepIntegrator.hpp"
 #include "solarSystemGenerator.hpp"
 #include "randomSystemGenerator.hpp"
+#include "sweep.hpp"
+#include "checkpoint.hpp"
+#include "simulator.hpp"
+#include "trajectoryWriter.hpp"
+#include "perfCounters.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+#include <chrono>
 
 int main(int argc, char **argv)
 {
@@ -23,11 +44,65 @@ int main(int argc, char **argv)
     double epsilon(0);
     app.add_option("--ep, --epsilon", epsilon, "parameter epsilon for simulation in the random system")->check(CLI::PositiveNumber);
     std::string task("None");
-    app.add_option("--task", task, "task to run. (RS: random system, SS: solar system))");
-    int n_particles;
+    app.add_option("--task", task, "task to run. (RS: random system, SS: solar system, ES: ensemble of random systems, one per seed))");
+    int n_particles(0);
     app.add_option("--np, --n_particles", n_particles, "The number of particles in the system")->check(CLI::PositiveNumber);
     int seed(2023);
     app.add_option("--sd, --seed", seed, "random seed for random initialized system. (default seed: 2023)")->check(CLI::PositiveNumber);
+    int n_seeds(1);
+    app.add_option("--seeds", n_seeds, "number of consecutive seeds from --sd whose random systems the ES task steps side by side, with direct summation and euler or kdk steps. (default: 1)")->check(CLI::PositiveNumber);
+    std::string solver_name("direct");
+    app.add_option("--solver", solver_name, "force solver (direct: all pairs from both sides, symmetric: each pair once, tiled: all pairs in cache-sized tiles, tree: Barnes-Hut octree, fmm: fast multipole method, pm: particle-mesh FFT). (default: direct)");
+    double theta(0.5);
+    app.add_option("--theta", theta, "opening angle of the tree and fmm solvers, smaller is more accurate. (default: 0.5)")->check(CLI::NonNegativeNumber);
+    int order(4);
+    app.add_option("--order", order, "expansion order of the fmm solver, larger is more accurate. (default: 4)")->check(CLI::NonNegativeNumber);
+    int grid_size(64);
+    app.add_option("--grid", grid_size, "grid nodes per dimension of the pm solver, rounded up to a power of two. (default: 64)")->check(CLI::PositiveNumber);
+    std::string assignment_name("tsc");
+    app.add_option("--assignment", assignment_name, "mass assignment of the pm solver (cic: cloud in cell, tsc: triangular shaped cloud). (default: tsc)")->check(CLI::IsMember({"cic", "tsc"}));
+    std::string integrator_name("euler");
+    app.add_option("--integrator", integrator_name, "integrator (euler: first order, kdk: leapfrog kick-drift-kick, verlet: velocity Verlet, the same map as kdk, dkd: position Verlet drift-kick-drift, yoshida4: Forest-Ruth/Yoshida fourth order, yoshida6: Yoshida sixth order, wh: Wisdom-Holman Kepler drifts about the first body, for Sun-dominated systems, ias15: adaptive 15th order Gauss-Radau, dt is only its first trial step). (default: euler)")->check(CLI::IsMember({"euler", "kdk", "verlet", "dkd", "yoshida4", "yoshida6", "wh", "ias15"}));
+    double tolerance(1e-9);
+    app.add_option("--tolerance", tolerance, "error tolerance of the ias15 integrator. (default: 1e-9)")->check(CLI::PositiveNumber);
+    int max_level(0);
+    app.add_option("--levels", max_level, "levels of power-of-two block timesteps below dt, each body steps with dt / 2^level chosen from its orbit (0: steps of dt for all bodies with --integrator). (default: 0)")->check(CLI::Range(0, 30));
+    double eta(0.01);
+    app.add_option("--eta", eta, "accuracy parameter of the block timesteps, a body's step is about eta times its orbital timescale |v| / |a|. (default: 0.01)")->check(CLI::PositiveNumber);
+    int sort_interval(0);
+    app.add_option("--sort", sort_interval, "re-sort the bodies of the random system along a Morton curve every this many steps, for memory locality (0: never). (default: 0)")->check(CLI::NonNegativeNumber);
+    bool sweep(false);
+    app.add_flag("--sweep", sweep, "run every combination of --sweep-np, the seeds of --sd and --seeds, --sweep-ep and --sweep-dt for the RS or SS task in one process, small systems one per thread and large ones with all threads, and print one table");
+    std::vector<int> sweep_particles;
+    app.add_option("--sweep-np", sweep_particles, "numbers of particles of the sweep, comma separated. (default: --np)")->delimiter(',')->check(CLI::PositiveNumber);
+    std::vector<double> sweep_epsilons;
+    app.add_option("--sweep-ep", sweep_epsilons, "softening parameters of the sweep, comma separated. (default: --ep)")->delimiter(',')->check(CLI::NonNegativeNumber);
+    std::vector<double> sweep_dts;
+    app.add_option("--sweep-dt", sweep_dts, "time steps of the sweep, comma separated, each run covers --yt years or --ns steps. (default: --dt)")->delimiter(',')->check(CLI::PositiveNumber);
+    std::string checkpoint_path;
+    app.add_option("--checkpoint", checkpoint_path, "write a binary checkpoint of the RS or SS task to this file every --checkpoint-every steps and after the last step, replacing it atomically");
+    int checkpoint_interval(0);
+    app.add_option("--checkpoint-every", checkpoint_interval, "steps between checkpoints. (default: 0, only after the last step)")->check(CLI::NonNegativeNumber);
+    std::string restart_path;
+    app.add_option("--restart", restart_path, "resume the run of this checkpoint bit for bit, given the same --solver and --integrator options. the task, dt, epsilon, seed, solver and integrator parameters, instruction set, number of steps and checkpoint interval come from the checkpoint, which is updated in place unless --checkpoint is given");
+    std::string trajectory_path;
+    app.add_option("--trajectory", trajectory_path, "write the positions of the RS or SS task every --trajectory-every steps to this binary file, from a background thread");
+    int trajectory_interval(100);
+    app.add_option("--trajectory-every", trajectory_interval, "steps between trajectory frames. (default: 100)")->check(CLI::PositiveNumber);
+    std::string trajectory_policy("block");
+    app.add_option("--trajectory-policy", trajectory_policy, "what to do with a frame while the writer is still busy with the previous one (block: wait for it, drop: skip the frame). (default: block)")->check(CLI::IsMember({"block", "drop"}));
+    std::string profile_path;
+    app.add_option("--profile", profile_path, "write the time of every phase of the steps, their histograms, interactions per second and GFLOP/s as JSON to this file on exit (needs a build with -DNBODY_PROFILE=ON)");
+    std::string trace_path;
+    app.add_option("--trace", trace_path, "write a per-thread timeline of the phases of the steps to this file on exit, for chrome://tracing or Perfetto (needs a build with -DNBODY_PROFILE=ON)");
+    int trace_interval(1);
+    app.add_option("--trace-every", trace_interval, "keep every this many force evaluations of each thread in the trace, with the phases up to the next one. (default: 1)")->check(CLI::PositiveNumber);
+    int trace_capacity(1 << 16);
+    app.add_option("--trace-buffer", trace_capacity, "events kept per thread, the oldest are overwritten beyond. (default: 65536)")->check(CLI::PositiveNumber);
+    bool perf_counters(false);
+    app.add_flag("--perf-counters", perf_counters, "count cycles, instructions, L1 and last level cache misses and branch misses of every phase in the --profile report, where the machine exposes them");
+    std::string simd("auto");
+    app.add_option("--simd", simd, "instruction set of the gravity kernel (auto, scalar, SSE2, AVX2, AVX512). (default: auto)");
 
     CLI11_PARSE(app, argc, argv);
 
@@ -37,6 +112,80 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if (!profile_path.empty() || !trace_path.empty())
+    {
+        // the calibration of the parallel threshold runs force evaluations of its own, done before anything is timed
+        getParallelThreshold();
+        Profiler::get().reset();
+    }
+    if (!profile_path.empty())
+    {
+        if (!Profiler::isEnabled())
+        {
+            std::cerr << "Warning: the profiler is compiled out, configure with -DNBODY_PROFILE=ON to time the phases." << std::endl;
+        }
+        Profiler::get().setReportPath(profile_path);
+        std::string error;
+        if (perf_counters && !PerfCounters::get().start(error))
+        {
+            std::cerr << "Warning: no hardware counters (" << error << "), the profile reports wall time only." << std::endl;
+        }
+    }
+    else if (perf_counters)
+    {
+        std::cerr << "Warning: --perf-counters only adds to the --profile report." << std::endl;
+    }
+    if (!trace_path.empty())
+    {
+        if (!Profiler::isEnabled())
+        {
+            std::cerr << "Warning: the profiler is compiled out, configure with -DNBODY_PROFILE=ON to trace the phases." << std::endl;
+        }
+        Tracer::get().start(trace_path, trace_interval, trace_capacity);
+    }
+    // a restart takes the task, the time step, the system and the length of the run from the checkpoint
+    ParticleSystem restart_system;
+    SimulatorProgress restart_progress;
+    CheckpointInfo restart_info;
+    if (!restart_path.empty())
+    {
+        std::string error;
+        if (!readCheckpoint(restart_path, restart_system, dt, restart_progress, restart_info, error))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        task = restart_info.task;
+        epsilon = restart_info.epsilon;
+        seed = restart_info.seed;
+        // the parameters of the solver, the integrator and the kernel as well, so that the steps repeat bit for bit
+        theta = restart_info.theta;
+        order = restart_info.order;
+        grid_size = restart_info.grid_size;
+        assignment_name = restart_info.assignment;
+        max_level = restart_info.max_level;
+        eta = restart_info.eta;
+        tolerance = restart_info.tolerance;
+        simd = restart_info.simd;
+        if (year_time <= 0 && n_steps <= 0)
+        {
+            n_steps = restart_info.target_steps;
+        }
+        if (checkpoint_path.empty())
+        {
+            checkpoint_path = restart_path;
+        }
+        if (checkpoint_interval == 0)
+        {
+            checkpoint_interval = restart_info.interval;
+        }
+    }
+    // a sweep over several time steps steps each for the same total time, unless the number of steps is given
+    const bool year_given = year_time > 0;
+    if (sweep && dt <= 0 && !sweep_dts.empty())
+    {
+        dt = sweep_dts[0];
+    }
     if (dt > 0)
     {
         if (year_time > 0 & n_steps <= 0)
@@ -61,10 +210,244 @@ int main(int argc, char **argv)
         std::cerr << "Error: ht is required, please refer to the help information '-h'." << std::endl;
         return 1;
     }
+    if (simd != "auto")
+    {
+        SimdLevel level;
+        if (!parseSimdLevel(simd, level))
+        {
+            std::cerr << "Error: unknown instruction set '" << simd << "', please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        if (!isSimdLevelSupported(level))
+        {
+            std::cerr << "Warning: " << simdLevelName(level) << " is not supported on this machine." << std::endl;
+        }
+        setSimdLevel(level);
+    }
+    std::cout << "gravity kernel: " << simdLevelName(getSimdLevel()) << std::endl;
+    // a fresh solver and integrator for every system, null for an unknown solver
+    auto make_solver = [&](double solver_epsilon) -> std::shared_ptr<ForceSolver> {
+        if (solver_name == "direct")
+        {
+            return std::make_shared<DirectSolver>(solver_epsilon);
+        }
+        else if (solver_name == "symmetric")
+        {
+            return std::make_shared<SymmetricDirectSolver>(solver_epsilon);
+        }
+        else if (solver_name == "tiled")
+        {
+            return std::make_shared<TiledDirectSolver>(solver_epsilon);
+        }
+        else if (solver_name == "tree")
+        {
+            return std::make_shared<BarnesHutSolver>(solver_epsilon, theta);
+        }
+        else if (solver_name == "fmm")
+        {
+            return std::make_shared<FmmSolver>(solver_epsilon, order, theta);
+        }
+        else if (solver_name == "pm")
+        {
+            return std::make_shared<ParticleMeshSolver>(solver_epsilon, grid_size, assignment_name == "cic" ? MassAssignment::CIC : MassAssignment::TSC);
+        }
+        return nullptr;
+    };
+    auto make_integrator = [&]() -> std::shared_ptr<Integrator> {
+        if (max_level > 0)
+        {
+            return std::make_shared<BlockTimestepIntegrator>(max_level, eta);
+        }
+        else if (integrator_name == "kdk" || integrator_name == "verlet")
+        {
+            return std::make_shared<SymplecticIntegrator>(SymplecticScheme::Leapfrog);
+        }
+        else if (integrator_name == "dkd")
+        {
+            return std::make_shared<SymplecticIntegrator>(SymplecticScheme::PositionVerlet);
+        }
+        else if (integrator_name == "yoshida4")
+        {
+            return std::make_shared<SymplecticIntegrator>(SymplecticScheme::Yoshida4);
+        }
+        else if (integrator_name == "yoshida6")
+        {
+            return std::make_shared<SymplecticIntegrator>(SymplecticScheme::Yoshida6);
+        }
+        else if (integrator_name == "ias15")
+        {
+            return std::make_shared<Ias15Integrator>(tolerance);
+        }
+        else if (integrator_name == "wh")
+        {
+            return std::make_shared<WisdomHolmanIntegrator>();
+        }
+        return std::make_shared<EulerIntegrator>();
+    };
+    std::shared_ptr<ForceSolver> solver = make_solver(epsilon);
+    if (!solver)
+    {
+        std::cerr << "Error: unknown solver '" << solver_name << "', please refer to the help information '-h'." << std::endl;
+        return 1;
+    }
+    std::shared_ptr<Integrator> integrator = make_integrator();
+    if (sweep)
+    {
+        if (task != "SS" && task != "RS")
+        {
+            std::cerr << "Error: the sweep runs the RS or SS task, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        if (task == "RS" && sweep_particles.empty() && n_particles <= 0)
+        {
+            std::cerr << "Error: n_particles is required, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        std::cout << "force solver: " << solver_name << std::endl
+                  << "integrator: " << (max_level > 0 ? "block timesteps" : integrator_name) << std::endl
+                  << "task: Sweep" << std::endl;
+        std::vector<int> seeds;
+        for (int s = seed; s < seed + n_seeds; s++)
+        {
+            seeds.push_back(s);
+        }
+        if (task == "SS")
+        {
+            sweep_particles = {0};
+        }
+        else if (sweep_particles.empty())
+        {
+            sweep_particles = {n_particles};
+        }
+        if (sweep_epsilons.empty())
+        {
+            sweep_epsilons = {epsilon};
+        }
+        if (sweep_dts.empty())
+        {
+            sweep_dts = {dt};
+        }
+        Sweep runs(sweep_particles, seeds, sweep_epsilons, sweep_dts, year_time, year_given ? 0 : n_steps, make_solver, make_integrator, sort_interval);
+        auto start_time = std::chrono::high_resolution_clock::now();
+        runs.run();
+        auto end_time = std::chrono::high_resolution_clock::now();
+        std::cout << runs.getRuns().size()
+                  << " runs in "
+                  << std::chrono::duration<double>(end_time - start_time).count()
+                  << " s"
+                  << std::endl;
+        runs.print(std::cout);
+        return 0;
+    }
+    if (task == "ES" && solver_name != "direct")
+    {
+        std::cerr << "Error: the ensemble sums the forces directly, --solver " << solver_name << " does not apply, please refer to the help information '-h'." << std::endl;
+        return 1;
+    }
+    // the names a restart has to match, before the parameters are added for the report
+    const std::string solver_key = solver_name;
+    const std::string integrator_key = max_level > 0 ? "block" : integrator_name;
+    if (auto tiled = std::dynamic_pointer_cast<TiledDirectSolver>(solver))
+    {
+        solver_name += " (tile = " + std::to_string(tiled->getSourceTile()) + ", block = " + std::to_string(tiled->getTargetBlock()) + ")";
+    }
+    else if (solver_name == "tree")
+    {
+        solver_name += " (theta = " + std::to_string(theta) + ")";
+    }
+    else if (solver_name == "fmm")
+    {
+        solver_name += " (order = " + std::to_string(order) + ", theta = " + std::to_string(theta) + ")";
+    }
+    else if (auto pm = std::dynamic_pointer_cast<ParticleMeshSolver>(solver))
+    {
+        solver_name += " (grid = " + std::to_string(pm->getGridSize()) + ", " + assignment_name + ")";
+    }
+    std::cout << "force solver: " << solver_name << std::endl;
+    if (max_level > 0)
+    {
+        integrator_name = "block timesteps (levels = " + std::to_string(max_level) + ", eta = " + std::to_string(eta) + ")";
+    }
+    std::cout << "integrator: " << integrator_name << std::endl;
+    if (!checkpoint_path.empty() || !trajectory_path.empty())
+    {
+        if (task != "SS" && task != "RS")
+        {
+            std::cerr << "Error: checkpoints and trajectories are written for the RS or SS task, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        if (sort_interval > 0)
+        {
+            std::cerr << "Error: --sort is not supported with checkpoints and trajectories, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        CheckpointInfo info;
+        ParticleSystem system;
+        if (!restart_path.empty())
+        {
+            if (restart_info.solver != solver_key || restart_info.integrator != integrator_key)
+            {
+                std::cerr << "Error: " << restart_path << " was written with --solver " << restart_info.solver << " and --integrator " << restart_info.integrator << "." << std::endl;
+                return 1;
+            }
+            info = restart_info;
+            system = std::move(restart_system);
+        }
+        else if (task == "SS")
+        {
+            system = SolarSystemGenerator().generateParticleSystem();
+        }
+        else if (n_particles > 0)
+        {
+            system = RandomSystemGenerator(n_particles, seed, epsilon).generateParticleSystem();
+        }
+        else
+        {
+            std::cerr << "Error: n_particles is required, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        if (restart_path.empty())
+        {
+            info.task = task;
+            info.solver = solver_key;
+            info.integrator = integrator_key;
+            info.seed = task == "RS" ? seed : 0;
+            info.epsilon = epsilon;
+            info.initial_energy = calTotalEnergy(system, epsilon);
+            info.theta = theta;
+            info.order = order;
+            info.grid_size = grid_size;
+            info.assignment = assignment_name;
+            info.max_level = max_level;
+            info.eta = eta;
+            info.tolerance = tolerance;
+            info.simd = simdLevelName(getSimdLevel());
+        }
+        info.target_steps = n_steps;
+        info.interval = checkpoint_interval;
+        std::cout << "task: " << (task == "SS" ? "Solar System" : "Random System") << (restart_path.empty() ? "" : ", restarted from " + restart_path) << std::endl;
+        Simulator simulator(std::move(system), solver, integrator, dt);
+        if (!restart_path.empty())
+        {
+            simulator.setProgress(restart_progress);
+        }
+        std::unique_ptr<TrajectoryWriter> trajectory;
+        if (!trajectory_path.empty())
+        {
+            trajectory = std::make_unique<TrajectoryWriter>(trajectory_path, simulator.getSystem().size(), trajectory_interval,
+                                                            trajectory_policy == "drop" ? TrajectoryPolicy::Drop : TrajectoryPolicy::Block);
+            if (!trajectory->isOpen())
+            {
+                std::cerr << "Error: cannot create " << trajectory_path << "." << std::endl;
+                return 1;
+            }
+        }
+        return run_Simulation(simulator, info, checkpoint_path, trajectory.get()) ? 0 : 1;
+    }
     if (task == "SS") // The Solar system
     {
         std::cout << "task: Solar System" << std::endl;
-        run_Solar_System(dt, year_time, n_steps, epsilon);
+        run_Solar_System(*solver, *integrator, dt, year_time, n_steps);
         return 0;
     }
     else if (task == "RS") // The random initialized system
@@ -73,11 +456,19 @@ int main(int argc, char **argv)
         {
             std::cout << "Task: Random System" << std::endl;
             std::shared_ptr<RandomSystemGenerator> generator = std::make_shared<RandomSystemGenerator>(n_particles, seed, epsilon);
-            std::vector<std::shared_ptr<Particle>> SS_initial = generator->generateInitialConditions();
-            double total_energy_initial = calTotalEnergy(SS_initial);
-            // ! SS_initial will be changed in the update_Solar_System function
-            std::vector<std::shared_ptr<Particle>> SS_updated = update_Solar_System(SS_initial, dt, year_time, n_steps, epsilon);
-            double total_energy_updated = calTotalEnergy(SS_updated);
+            ParticleSystem RS = generator->generateParticleSystem();
+            // take the energies from the first and last force evaluations if possible, an extra O(N^2) pass otherwise.
+            // the integrator restarts after every re-sort, so its own energies would only cover the last interval
+            bool fused_energy = integrator->recordsEnergy() && solver->supportsPotential() && sort_interval == 0;
+            integrator->setRecordEnergy(fused_energy);
+            double total_energy_initial = fused_energy ? 0 : calTotalEnergy(RS, epsilon);
+            // RS is updated in place
+            update_Solar_System(RS, *solver, *integrator, dt, year_time, n_steps, sort_interval);
+            double total_energy_updated = fused_energy ? integrator->getFinalEnergy() : calTotalEnergy(RS, epsilon);
+            if (fused_energy)
+            {
+                total_energy_initial = integrator->getInitialEnergy();
+            }
 
             std::cout << "total energy of the solar system at the beginning is "
                       << total_energy_initial
@@ -92,6 +483,12 @@ int main(int argc, char **argv)
             std::cout << "total energy increased during this period is "
                       << total_energy_updated - total_energy_initial
                       << std::endl;
+            // the relative error shows the accuracy given up by approximate solvers
+            std::cout << "relative energy error with the "
+                      << solver_name
+                      << " solver is "
+                      << std::abs((total_energy_updated - total_energy_initial) / total_energy_initial)
+                      << std::endl;
             return 0;
         }
         else
@@ -101,6 +498,22 @@ int main(int argc, char **argv)
         }
         return 0;
     }
+    else if (task == "ES") // an ensemble of random systems
+    {
+        if (n_particles <= 0)
+        {
+            std::cerr << "Error: n_particles is required, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        if (max_level > 0 || (integrator_name != "euler" && integrator_name != "kdk" && integrator_name != "verlet"))
+        {
+            std::cerr << "Error: the ensemble steps with euler or kdk only, please refer to the help information '-h'." << std::endl;
+            return 1;
+        }
+        std::cout << "Task: Ensemble of Random Systems" << std::endl;
+        run_Ensemble(n_particles, seed, n_seeds, epsilon, integrator_name == "euler" ? EnsembleScheme::Euler : EnsembleScheme::Leapfrog, dt, year_time, n_steps);
+        return 0;
+    }
     else
     {
         std::cerr << "Error: task is required, please refer to the help information '-h'." << std::endl;
@@ -0,0 +1,119 @@
+#include "benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ios>
+#include <omp.h>
+#include <sched.h>
+
+BenchmarkResult measure(const std::function<void()> &call, int warmup, int repetitions, double min_ms)
+{
+    using clock = std::chrono::steady_clock;
+    // the warmup calls also estimate the time of one call
+    double call_ms = 0;
+    for (int w = 0; w < warmup; w++)
+    {
+        auto start_time = clock::now();
+        call();
+        call_ms = std::chrono::duration<double, std::milli>(clock::now() - start_time).count();
+    }
+    BenchmarkResult result;
+    result.repetitions = repetitions;
+    result.iterations = call_ms > 0 ? std::max<long long>(1, static_cast<long long>(std::ceil(min_ms / call_ms))) : 1;
+    std::vector<double> times(repetitions);
+    for (int r = 0; r < repetitions; r++)
+    {
+        auto start_time = clock::now();
+        for (long long k = 0; k < result.iterations; k++)
+        {
+            call();
+        }
+        times[r] = std::chrono::duration<double, std::milli>(clock::now() - start_time).count() / result.iterations;
+    }
+    std::sort(times.begin(), times.end());
+    result.min = times.front();
+    result.median = repetitions % 2 ? times[repetitions / 2] : 0.5 * (times[repetitions / 2 - 1] + times[repetitions / 2]);
+    for (double t : times)
+    {
+        result.mean += t / repetitions;
+    }
+    for (double t : times)
+    {
+        result.stddev += (t - result.mean) * (t - result.mean);
+    }
+    result.stddev = repetitions > 1 ? std::sqrt(result.stddev / (repetitions - 1)) : 0;
+    return result;
+}
+
+bool pinThreads(int n_threads)
+{
+    // read before any thread is pinned, the master thread is pinned with the others
+    static cpu_set_t initial;
+    static const bool has_mask = sched_getaffinity(0, sizeof(initial), &initial) == 0;
+    if (!has_mask)
+    {
+        return false;
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &initial))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty())
+    {
+        return false;
+    }
+    bool pinned = true;
+    #pragma omp parallel num_threads(n_threads) reduction(&&:pinned)
+    {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &mask);
+        pinned = sched_setaffinity(0, sizeof(mask), &mask) == 0;
+    }
+    return pinned;
+}
+
+void writeCsv(std::ostream &out, const std::vector<BenchmarkResult> &results)
+{
+    out << "benchmark,n,threads,repetitions,iterations,min_ms,median_ms,mean_ms,stddev_ms,items_per_s" << std::endl;
+    for (const BenchmarkResult &result : results)
+    {
+        out << result.name << ','
+            << result.n << ','
+            << result.threads << ','
+            << result.repetitions << ','
+            << result.iterations << ','
+            << result.min << ','
+            << result.median << ','
+            << result.mean << ','
+            << result.stddev << ','
+            << result.items / result.median * 1e3
+            << std::endl;
+    }
+}
+
+void writeJson(std::ostream &out, const std::vector<BenchmarkResult> &results, const std::string &simd, bool pinned)
+{
+    out << "{\n  \"simd\": \"" << simd << "\",\n  \"pinned\": " << std::boolalpha << pinned << std::noboolalpha << ",\n  \"results\": [";
+    for (std::size_t k = 0; k < results.size(); k++)
+    {
+        const BenchmarkResult &result = results[k];
+        out << (k > 0 ? "," : "") << "\n    {"
+            << "\"benchmark\": \"" << result.name << "\", "
+            << "\"n\": " << result.n << ", "
+            << "\"threads\": " << result.threads << ", "
+            << "\"repetitions\": " << result.repetitions << ", "
+            << "\"iterations\": " << result.iterations << ", "
+            << "\"min_ms\": " << result.min << ", "
+            << "\"median_ms\": " << result.median << ", "
+            << "\"mean_ms\": " << result.mean << ", "
+            << "\"stddev_ms\": " << result.stddev << ", "
+            << "\"items_per_s\": " << result.items / result.median * 1e3
+            << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
@@ -0,0 +1,37 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// timings of one benchmark case, all times in ms per call
+struct BenchmarkResult
+{
+    std::string name;
+    int n = 0;
+    int threads = 1;
+    // timed repetitions, and calls per repetition
+    int repetitions = 0;
+    long long iterations = 0;
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double stddev = 0;
+    // work items of one call (pair interactions, bodies), 0 if not counted
+    double items = 0;
+};
+
+// time call after warmup untimed calls: every repetition makes enough calls to last at least min_ms, and the
+// time per call of each repetition goes into the statistics
+BenchmarkResult measure(const std::function<void()> &call, int warmup, int repetitions, double min_ms);
+// pin the k-th thread of a team of n_threads OpenMP threads to the k-th CPU of the affinity mask the process
+// started with (cyclically). the threads of later regions of the same size are the same ones and stay pinned.
+// returns false if the mask cannot be read or set
+bool pinThreads(int n_threads);
+// write results as CSV with a header line, or as a JSON document
+void writeCsv(std::ostream &out, const std::vector<BenchmarkResult> &results);
+void writeJson(std::ostream &out, const std::vector<BenchmarkResult> &results, const std::string &simd, bool pinned);
+
+#endif // BENCHMARK_HPP
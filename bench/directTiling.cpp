@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include "CLI11.hpp"
+#include "particleSystem.hpp"
+#include "randomSystemGenerator.hpp"
+#include "gravityKernel.hpp"
+#include "directSolver.hpp"
+#include "tiledDirectSolver.hpp"
+
+// flops of one pair interaction, the usual convention for direct N-body codes
+constexpr double FLOPS_PER_PAIR = 20;
+// bytes of one source: mass and position
+constexpr double BYTES_PER_SOURCE = 4 * sizeof(double);
+
+// best wall time (s) of one force evaluation over the repetitions, shared by all OpenMP threads
+double timeSolver(ForceSolver &solver, ParticleSystem &system, int repetitions)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; r++)
+    {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel
+        solver.computeAccelerations(system);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end_time - start_time).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    CLI::App app("Compare the direct solver with the cache-blocked tiled solver");
+    int min_n(1024);
+    app.add_option("--min-n", min_n, "smallest number of particles (default: 1024)")->check(CLI::PositiveNumber);
+    int max_n(65536);
+    app.add_option("--max-n", max_n, "largest number of particles, doubled from min-n (default: 65536)")->check(CLI::PositiveNumber);
+    int repetitions(3);
+    app.add_option("--reps", repetitions, "repetitions per measurement, the best is kept (default: 3)")->check(CLI::PositiveNumber);
+    int source_tile(0);
+    app.add_option("--tile", source_tile, "sources per tile of the tiled solver (default: 0, tuned)")->check(CLI::NonNegativeNumber);
+    int target_block(0);
+    app.add_option("--block", target_block, "targets per block of the tiled solver (default: 0, tuned)")->check(CLI::NonNegativeNumber);
+    double epsilon(0.001);
+    app.add_option("--ep, --epsilon", epsilon, "softening parameter (default: 0.001)")->check(CLI::NonNegativeNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    DirectSolver direct(epsilon);
+    TiledDirectSolver tiled(epsilon, source_tile, target_block);
+    std::cout << "gravity kernel: " << simdLevelName(getSimdLevel())
+              << ", tile = " << tiled.getSourceTile() << " sources, block = " << tiled.getTargetBlock() << " targets" << std::endl;
+    // the direct solver streams all sources once per target, the tiled solver once per block of targets
+    std::cout << std::setw(8) << "N"
+              << std::setw(14) << "direct (ms)"
+              << std::setw(10) << "GFLOP/s"
+              << std::setw(10) << "GB/s"
+              << std::setw(14) << "tiled (ms)"
+              << std::setw(10) << "GFLOP/s"
+              << std::setw(10) << "GB/s"
+              << std::setw(10) << "speedup"
+              << std::endl;
+    for (int n = min_n; n <= max_n; n *= 2)
+    {
+        RandomSystemGenerator generator(n - 1);
+        ParticleSystem system = generator.generateParticleSystem();
+        const double pairs = static_cast<double>(n) * n;
+        const double blocks = (n + tiled.getTargetBlock() - 1) / tiled.getTargetBlock();
+        double direct_s = timeSolver(direct, system, repetitions);
+        double tiled_s = timeSolver(tiled, system, repetitions);
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << n
+                  << std::setw(14) << direct_s * 1e3
+                  << std::setw(10) << FLOPS_PER_PAIR * pairs / direct_s * 1e-9
+                  << std::setw(10) << BYTES_PER_SOURCE * pairs / direct_s * 1e-9
+                  << std::setw(14) << tiled_s * 1e3
+                  << std::setw(10) << FLOPS_PER_PAIR * pairs / tiled_s * 1e-9
+                  << std::setw(10) << BYTES_PER_SOURCE * n * blocks / tiled_s * 1e-9
+                  << std::setw(10) << direct_s / tiled_s
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <omp.h>
+#include "CLI11.hpp"
+#include "benchmark.hpp"
+#include "nbody.hpp"
+#include "particle.hpp"
+#include "particleSystem.hpp"
+#include "randomSystemGenerator.hpp"
+#include "solarSystemGenerator.hpp"
+#include "directSolver.hpp"
+#include "symplecticIntegrator.hpp"
+#include "simulator.hpp"
+#include "gravityKernel.hpp"
+
+// one benchmark over the sizes: set up a system of n bodies and return the call to time with its work items
+struct BenchmarkCase
+{
+    std::string name;
+    // the cost grows as N^order, to skip the sizes predicted to exceed the time limit
+    int order;
+    // timed on one thread only
+    bool serial;
+    std::function<std::function<void()>(int n, double &items)> setup;
+};
+
+void printResult(const BenchmarkResult &result)
+{
+    std::cout << std::left << std::setw(22) << result.name << std::right
+              << std::setw(8) << result.n
+              << std::setw(9) << result.threads
+              << std::scientific << std::setprecision(3)
+              << std::setw(13) << result.median
+              << std::setw(13) << result.min
+              << std::setw(13) << result.stddev
+              << std::setw(13) << result.items / result.median * 1e3
+              << std::defaultfloat
+              << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    CLI::App app("Time the kernels, energies, generators and whole steps of the library over system sizes and thread counts");
+    int min_n(8);
+    app.add_option("--min-n", min_n, "smallest number of bodies (default: 8)")->check(CLI::PositiveNumber);
+    int max_n(65536);
+    app.add_option("--max-n", max_n, "largest number of bodies, doubled from min-n (default: 65536)")->check(CLI::PositiveNumber);
+    std::vector<int> thread_counts;
+    app.add_option("--threads", thread_counts, "thread counts of the parallel benchmarks (default: 1, 2, 4, ... up to the available threads)")->check(CLI::PositiveNumber);
+    int warmup(1);
+    app.add_option("--warmup", warmup, "untimed calls before the repetitions (default: 1)")->check(CLI::PositiveNumber);
+    int repetitions(5);
+    app.add_option("--reps", repetitions, "timed repetitions per case (default: 5)")->check(CLI::PositiveNumber);
+    double min_ms(10);
+    app.add_option("--min-ms", min_ms, "shortest repetition, short calls are repeated within it (default: 10)")->check(CLI::NonNegativeNumber);
+    double max_ms(2000);
+    app.add_option("--max-ms", max_ms, "skip the sizes at which one call is predicted to take longer than this (default: 2000)")->check(CLI::PositiveNumber);
+    bool no_pin(false);
+    app.add_flag("--no-pin", no_pin, "leave the threads unpinned");
+    std::string filter;
+    app.add_option("--filter", filter, "only the benchmarks whose names contain this");
+    std::string csv_path;
+    app.add_option("--csv", csv_path, "write the results as CSV to this file");
+    std::string json_path;
+    app.add_option("--json", json_path, "write the results as JSON to this file");
+    double epsilon(0.01);
+    app.add_option("--ep, --epsilon", epsilon, "softening parameter (default: 0.01)")->check(CLI::NonNegativeNumber);
+    double dt(0.001);
+    app.add_option("--dt", dt, "time step of the whole steps (default: 0.001)")->check(CLI::PositiveNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    if (thread_counts.empty())
+    {
+        for (int t = 1; t < omp_get_max_threads(); t *= 2)
+        {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(omp_get_max_threads());
+    }
+    // measured now, not inside the first timed step
+    getParallelThreshold();
+
+    // the systems outlive the setup calls, one per benchmark is alive at a time
+    ParticleSystem system;
+    std::vector<std::shared_ptr<Particle>> particles;
+    std::unique_ptr<Simulator> simulator;
+    std::vector<BenchmarkCase> cases = {
+        {"calcAcceleration", 1, true, [&](int n, double &items) {
+             particles = RandomSystemGenerator(n - 1).generateParticleSystem().toParticles();
+             items = n - 1;
+             // the acceleration of one body by all the others, pair by pair
+             return std::function<void()>([&] {
+                 Eigen::Vector3d acceleration{0, 0, 0};
+                 for (std::size_t j = 1; j < particles.size(); j++)
+                 {
+                     acceleration += calcAcceleration(*particles[0], *particles[j], epsilon);
+                 }
+                 particles[0]->setAcceleration(acceleration);
+             });
+         }},
+        {"updateAcceleration", 2, false, [&](int n, double &items) {
+             system = RandomSystemGenerator(n - 1).generateParticleSystem();
+             items = static_cast<double>(n) * (n - 1);
+             return std::function<void()>([&] {
+                 const int n_particles = system.size();
+                 #pragma omp parallel for
+                 for (int i = 0; i < n_particles; i++)
+                 {
+                     system.updateAcceleration(i, epsilon);
+                 }
+             });
+         }},
+        {"calTotalEnergy", 2, false, [&](int n, double &items) {
+             system = RandomSystemGenerator(n - 1).generateParticleSystem();
+             items = 0.5 * n * (n - 1);
+             return std::function<void()>([&] { calTotalEnergy(system, epsilon); });
+         }},
+        {"randomSystemGenerator", 1, true, [&](int n, double &items) {
+             items = n;
+             return std::function<void()>([n] { RandomSystemGenerator(n - 1).generateParticleSystem(); });
+         }},
+        {"step", 2, false, [&](int n, double &items) {
+             simulator = std::make_unique<Simulator>(RandomSystemGenerator(n - 1).generateParticleSystem(), std::make_shared<DirectSolver>(epsilon),
+                                                     std::make_shared<SymplecticIntegrator>(SymplecticScheme::Leapfrog), dt);
+             // the first step also evaluates the forces of the initial positions, the later ones reuse the closing
+             // evaluation of the step before
+             simulator->step();
+             items = static_cast<double>(n) * n;
+             // one steady-state kick-drift-kick step of direct summation, as run by the application
+             return std::function<void()>([&] { simulator->step(); });
+         }},
+    };
+
+    const std::string simd = simdLevelName(getSimdLevel());
+    bool pinned = !no_pin;
+    std::cout << "gravity kernel: " << simd << std::endl;
+    std::cout << std::left << std::setw(22) << "benchmark" << std::right
+              << std::setw(8) << "N"
+              << std::setw(9) << "threads"
+              << std::setw(13) << "median (ms)"
+              << std::setw(13) << "min (ms)"
+              << std::setw(13) << "stddev (ms)"
+              << std::setw(13) << "items/s"
+              << std::endl;
+    std::vector<BenchmarkResult> results;
+    // the serial benchmarks and the solar system once, on one thread, then the parallel ones for each thread count
+    for (int pass = 0; pass <= static_cast<int>(thread_counts.size()); pass++)
+    {
+        const int threads = pass == 0 ? 1 : thread_counts[pass - 1];
+        omp_set_num_threads(threads);
+        if (!no_pin && !pinThreads(threads))
+        {
+            std::cerr << "Warning: cannot pin the threads, they are left to the scheduler." << std::endl;
+            pinned = false;
+            no_pin = true;
+        }
+        if (pass == 0 && std::string("solarSystemGenerator").find(filter) != std::string::npos)
+        {
+            BenchmarkResult result = measure([] { SolarSystemGenerator().generateParticleSystem(); }, warmup, repetitions, min_ms);
+            result.name = "solarSystemGenerator";
+            result.n = 9;
+            result.items = 9;
+            printResult(result);
+            results.push_back(result);
+        }
+        for (const BenchmarkCase &benchmark : cases)
+        {
+            if (benchmark.serial != (pass == 0) || benchmark.name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+            for (int n = min_n; n <= max_n; n *= 2)
+            {
+                double items(0);
+                std::function<void()> call = benchmark.setup(n, items);
+                BenchmarkResult result = measure(call, warmup, repetitions, min_ms);
+                result.name = benchmark.name;
+                result.n = n;
+                result.threads = threads;
+                result.items = items;
+                printResult(result);
+                results.push_back(result);
+                if (result.median * std::pow(2, benchmark.order) > max_ms && 2 * n <= max_n)
+                {
+                    std::cout << std::left << std::setw(22) << benchmark.name << std::right
+                              << " skipped from N = " << 2 * n << ", over --max-ms" << std::endl;
+                    break;
+                }
+            }
+        }
+    }
+    system = ParticleSystem();
+    particles.clear();
+    simulator.reset();
+
+    if (!csv_path.empty())
+    {
+        std::ofstream file(csv_path);
+        writeCsv(file, results);
+        if (!file)
+        {
+            std::cerr << "Error: cannot write " << csv_path << "." << std::endl;
+            return 1;
+        }
+    }
+    if (!json_path.empty())
+    {
+        std::ofstream file(json_path);
+        writeJson(file, results, simd, pinned);
+        if (!file)
+        {
+            std::cerr << "Error: cannot write " << json_path << "." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include "CLI11.hpp"
+#include "particleSystem.hpp"
+#include "randomSystemGenerator.hpp"
+#include "directSolver.hpp"
+#include "barnesHutSolver.hpp"
+#include "fmmSolver.hpp"
+
+// best wall time (ms) of one force evaluation over the repetitions, shared by all OpenMP threads
+double timeSolver(ForceSolver &solver, ParticleSystem &system, int repetitions)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; r++)
+    {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel
+        solver.computeAccelerations(system);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end_time - start_time).count());
+    }
+    return best;
+}
+
+// relative RMS difference of the accelerations of two systems
+double accelerationError(const ParticleSystem &approximate, const ParticleSystem &reference)
+{
+    double error2(0), norm2(0);
+    for (std::size_t i = 0; i < reference.size(); i++)
+    {
+        double dx = approximate.ax()[i] - reference.ax()[i];
+        double dy = approximate.ay()[i] - reference.ay()[i];
+        double dz = approximate.az()[i] - reference.az()[i];
+        error2 += dx * dx + dy * dy + dz * dz;
+        norm2 += reference.ax()[i] * reference.ax()[i] + reference.ay()[i] * reference.ay()[i] + reference.az()[i] * reference.az()[i];
+    }
+    return std::sqrt(error2 / norm2);
+}
+
+int main(int argc, char **argv)
+{
+    CLI::App app("Find the number of particles where the FMM solver overtakes direct and tree summation");
+    int min_n(256);
+    app.add_option("--min-n", min_n, "smallest number of particles (default: 256)")->check(CLI::PositiveNumber);
+    int max_n(262144);
+    app.add_option("--max-n", max_n, "largest number of particles, doubled from min-n (default: 262144)")->check(CLI::PositiveNumber);
+    int order(4);
+    app.add_option("--order", order, "expansion order of the FMM solver (default: 4)")->check(CLI::NonNegativeNumber);
+    double theta(0.5);
+    app.add_option("--theta", theta, "opening angle of the tree and FMM solvers (default: 0.5)")->check(CLI::PositiveNumber);
+    int repetitions(3);
+    app.add_option("--reps", repetitions, "repetitions per measurement, the best is kept (default: 3)")->check(CLI::PositiveNumber);
+    double max_direct_ms(20000);
+    app.add_option("--max-direct-ms", max_direct_ms, "stop timing direct summation once one evaluation is predicted to exceed this, and extrapolate as N^2 (default: 20000)")->check(CLI::PositiveNumber);
+    double epsilon(0.001);
+    app.add_option("--ep, --epsilon", epsilon, "softening parameter (default: 0.001)")->check(CLI::NonNegativeNumber);
+    CLI11_PARSE(app, argc, argv);
+
+    DirectSolver direct(epsilon);
+    BarnesHutSolver tree(epsilon, theta);
+    FmmSolver fmm(epsilon, order, theta);
+
+    std::cout << std::setw(10) << "N"
+              << std::setw(14) << "direct (ms)"
+              << std::setw(14) << "tree (ms)"
+              << std::setw(14) << "fmm (ms)"
+              << std::setw(14) << "tree error"
+              << std::setw(14) << "fmm error"
+              << std::endl;
+    int crossover_direct(-1), crossover_tree(-1);
+    double last_direct_ms(0);
+    int last_direct_n(0);
+    for (int n = min_n; n <= max_n; n *= 2)
+    {
+        RandomSystemGenerator generator(n - 1);
+        ParticleSystem reference = generator.generateParticleSystem();
+        ParticleSystem tree_system = reference;
+        ParticleSystem fmm_system = reference;
+
+        // direct summation is only timed while it stays affordable, then extrapolated as N^2
+        double predicted_ms = last_direct_n > 0 ? last_direct_ms * std::pow(double(n) / last_direct_n, 2) : 0;
+        bool measured = predicted_ms < max_direct_ms;
+        double direct_ms = measured ? timeSolver(direct, reference, repetitions) : predicted_ms;
+        if (measured)
+        {
+            last_direct_ms = direct_ms;
+            last_direct_n = n;
+        }
+        double tree_ms = timeSolver(tree, tree_system, repetitions);
+        double fmm_ms = timeSolver(fmm, fmm_system, repetitions);
+
+        std::cout << std::setw(10) << n
+                  << std::setw(13) << direct_ms << (measured ? " " : "*")
+                  << std::setw(14) << tree_ms
+                  << std::setw(14) << fmm_ms;
+        if (measured)
+        {
+            std::cout << std::setw(14) << accelerationError(tree_system, reference)
+                      << std::setw(14) << accelerationError(fmm_system, reference);
+        }
+        std::cout << std::endl;
+
+        // the crossover is the first N from which FMM stays ahead
+        if (fmm_ms < direct_ms && crossover_direct < 0)
+        {
+            crossover_direct = n;
+        }
+        else if (fmm_ms >= direct_ms)
+        {
+            crossover_direct = -1;
+        }
+        if (fmm_ms < tree_ms && crossover_tree < 0)
+        {
+            crossover_tree = n;
+        }
+        else if (fmm_ms >= tree_ms)
+        {
+            crossover_tree = -1;
+        }
+    }
+    std::cout << "* extrapolated from the last measured direct summation" << std::endl;
+    std::cout << "FMM (order " << order << ") overtakes direct summation at N = ";
+    std::cout << (crossover_direct > 0 ? std::to_string(crossover_direct) : "not within the range") << std::endl;
+    std::cout << "FMM (order " << order << ") overtakes tree summation at N = ";
+    std::cout << (crossover_tree > 0 ? std::to_string(crossover_tree) : "not within the range") << std::endl;
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef BARNESHUTSOLVER_HPP
+#define BARNESHUTSOLVER_HPP
+
+#include <forceSolver.hpp>
+#include <octree.hpp>
+
+// Barnes-Hut tree code: a cell whose size seen from a target is below the opening angle theta acts as a point
+// mass at its centre of mass. the octree is rebuilt in parallel on every call.
+class BarnesHutSolver : public ForceSolver
+{
+public:
+    // constructor by softening parameter, opening angle and maximum number of particles in a leaf
+    BarnesHutSolver(double epsilon = 0, double theta = 0.5, int leaf_size = 8);
+    // update the accelerations of all particles in the system
+    void computeAccelerations(ParticleSystem &system) override;
+    // update the accelerations of the listed particles only
+    void computeActiveAccelerations(ParticleSystem &system, const std::vector<int> &active) override;
+    // get the opening angle
+    double getTheta() const;
+    // get the tree built by the last call
+    const Octree &getTree() const;
+
+private:
+    // acceleration of one target by a walk of the tree
+    void walk(double x, double y, double z, double &acc_x, double &acc_y, double &acc_z) const;
+
+    double theta;
+    Octree tree;
+};
+
+#endif // BARNESHUTSOLVER_HPP
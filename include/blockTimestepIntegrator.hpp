@@ -0,0 +1,44 @@
+#ifndef BLOCKTIMESTEPINTEGRATOR_HPP
+#define BLOCKTIMESTEPINTEGRATOR_HPP
+
+#include <integrator.hpp>
+#include <vector>
+
+// kick-drift-kick leapfrog with individual power-of-two block timesteps.
+// a particle on level k takes steps of dt / 2^k, chosen from its orbital timescale eta * |v| / |a|, so slow outer
+// bodies are kicked (and have their accelerations evaluated) far less often than fast inner ones. all particles
+// drift together to the next time at which some level is due, then only the particles of the due levels get new
+// accelerations. a particle moves to a finer level at the end of any of its steps, and within a base step to the
+// next coarser level only when that level is due as well, so every level stays synchronised with the base step dt.
+// at the end of each base step every level is due and the levels are chosen afresh, as at the start of a call, so
+// a run split into several calls takes the same steps as one call.
+class BlockTimestepIntegrator : public Integrator
+{
+public:
+    // constructor by the number of levels below the base step and the accuracy parameter of the timestep criterion
+    BlockTimestepIntegrator(int max_level = 8, double eta = 0.01);
+    // advance the system by n_steps base steps of dt
+    void integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps) override;
+    // get the number of levels below the base step
+    int getMaxLevel() const;
+    // get the accuracy parameter of the timestep criterion
+    double getEta() const;
+    // level of each particle at the end of the last call, its step is dt / 2^level
+    const std::vector<int> &getLevels() const;
+    // every particle is due at the end of a call, with the accelerations of its final position
+    bool leavesAccelerationsCurrent() const override;
+
+private:
+    // level whose step fits the timescale of the i-th particle
+    int chooseLevel(const ParticleSystem &system, int i, double dt) const;
+
+    int max_level;
+    double eta;
+    std::vector<int> levels;
+    // particles due at the current time
+    std::vector<int> active;
+    // next time at which some level is due, in steps of the finest level
+    long long next_tick;
+};
+
+#endif // BLOCKTIMESTEPINTEGRATOR_HPP
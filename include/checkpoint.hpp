@@ -0,0 +1,49 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <particleSystem.hpp>
+#include <simulator.hpp>
+#include <string>
+
+// version of the layout written by writeCheckpoint, files of other versions are refused
+constexpr int CHECKPOINT_VERSION = 2;
+
+// the parameters of a run stored next to its state, for a restart to check or take over
+struct CheckpointInfo
+{
+    // names of the task, the solver and the integrator, at most 31 characters each
+    std::string task;
+    std::string solver;
+    std::string integrator;
+    // seed of the random system and softening parameter of the forces
+    int seed = 0;
+    double epsilon = 0;
+    // steps of the whole run, and between checkpoints
+    long long target_steps = 0;
+    int interval = 0;
+    // total energy at the start of the run
+    double initial_energy = 0;
+    // parameters of the solver and the integrator: opening angle, expansion order, grid size and mass assignment,
+    // block timestep levels and accuracy, ias15 tolerance, and the instruction set of the gravity kernel
+    double theta = 0;
+    int order = 0;
+    int grid_size = 0;
+    std::string assignment;
+    int max_level = 0;
+    double eta = 0;
+    double tolerance = 0;
+    std::string simd;
+};
+
+// write the system, time step and progress of a simulator, with info, to a binary checkpoint at path.
+// the file holds a fixed header and the raw arrays of the system at cache line aligned offsets, in the byte order
+// of the machine. it is written next to path, synced and renamed over it, and the directory is synced after the
+// rename, so that a crash leaves either the previous checkpoint or the new one. returns false, with a message in
+// error, on failure
+bool writeCheckpoint(const std::string &path, const Simulator &simulator, const CheckpointInfo &info, std::string &error);
+// read a checkpoint written by writeCheckpoint. the file is mapped into memory and every block of the arrays is
+// copied into the system with one memcpy, without parsing. returns false, with a message in error and the other
+// arguments unchanged, on failure
+bool readCheckpoint(const std::string &path, ParticleSystem &system, double &dt, SimulatorProgress &progress, CheckpointInfo &info, std::string &error);
+
+#endif // CHECKPOINT_HPP
@@ -0,0 +1,20 @@
+#ifndef DIRECTSOLVER_HPP
+#define DIRECTSOLVER_HPP
+
+#include <forceSolver.hpp>
+
+// all-pairs summation with the SIMD kernel picked at startup, every pair is evaluated from both sides
+class DirectSolver : public ForceSolver
+{
+public:
+    // constructor by softening parameter epsilon
+    DirectSolver(double epsilon = 0);
+    // update the accelerations of all particles in the system
+    void computeAccelerations(ParticleSystem &system) override;
+    // the potentials come out of the same kernel
+    bool supportsPotential() const override;
+    // update the accelerations of the listed particles only
+    void computeActiveAccelerations(ParticleSystem &system, const std::vector<int> &active) override;
+};
+
+#endif // DIRECTSOLVER_HPP
@@ -0,0 +1,56 @@
+#ifndef ENSEMBLESYSTEM_HPP
+#define ENSEMBLESYSTEM_HPP
+
+#include <gravityKernel.hpp>
+#include <particleSystem.hpp>
+#include <vector>
+
+// time stepping schemes of an ensemble
+enum class EnsembleScheme
+{
+    Euler,   // the same map as EulerIntegrator
+    Leapfrog // kick-drift-kick, the same map as SymplecticIntegrator with SymplecticScheme::Leapfrog
+};
+
+// many independent systems with the same number of bodies, stepped side by side by direct summation.
+// the systems are packed in batches of ENSEMBLE_LANES, interleaved so that the vector lanes of the ensemble kernel
+// run across the systems of a batch: for tiny systems SIMD across the bodies of one system leaves most lanes idle.
+// the last batch is padded with massless bodies at the origin.
+class EnsembleSystem
+{
+public:
+    // constructor copying systems of the same size, forces softened by epsilon
+    EnsembleSystem(const std::vector<ParticleSystem> &systems, double epsilon = 0);
+    // number of systems
+    int size() const;
+    // number of bodies of each system
+    int getBodies() const;
+    // advance every system by n_steps steps of dt. the batches are independent and shared out with an orphaned
+    // worksharing loop, so the call must be made by every thread of the enclosing parallel region (or serially)
+    void integrate(EnsembleScheme scheme, double dt, int n_steps);
+    // total energy of every system
+    std::vector<double> calTotalEnergies() const;
+    // copy of the k-th system
+    ParticleSystem getSystem(int k) const;
+
+private:
+    // the systems of one batch over n_steps steps
+    void integrateBatch(int batch, EnsembleScheme scheme, double dt, int n_steps);
+    // v += a * kick and x += v * drift for all bodies of a batch, drift first if drift_first (Euler)
+    void kickDrift(int batch, double kick, double drift, bool drift_first);
+    // update the accelerations of all bodies of a batch
+    void computeAccelerations(int batch);
+
+    int n_systems;
+    int n_bodies;
+    int n_batches;
+    double epsilon2;
+    EnsembleKernel kernel;
+    // per batch, the masses of n_bodies * ENSEMBLE_LANES values, the vectors in x, y and z blocks of that length
+    AlignedVector<double> mass;
+    AlignedVector<double> position;
+    AlignedVector<double> velocity;
+    AlignedVector<double> acceleration;
+};
+
+#endif // ENSEMBLESYSTEM_HPP
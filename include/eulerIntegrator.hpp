@@ -0,0 +1,14 @@
+#ifndef EULERINTEGRATOR_HPP
+#define EULERINTEGRATOR_HPP
+
+#include <integrator.hpp>
+
+// first order Euler steps of one global dt: positions move with the old velocities, then velocities with the old accelerations
+class EulerIntegrator : public Integrator
+{
+public:
+    // advance the system by n_steps steps of dt
+    void integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps) override;
+};
+
+#endif // EULERINTEGRATOR_HPP
@@ -0,0 +1,33 @@
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include <complex>
+#include <vector>
+
+// in-place radix-2 complex FFT of an n x n x n cube stored as (i * n + j) * n + k, n a power of two.
+// the inverse transform is normalised, so forward then inverse gives back the input.
+class Fft3d
+{
+public:
+    // constructor by edge length of the cube
+    Fft3d(int n = 1);
+    // get the edge length of the cube
+    int size() const;
+    // transform the cube in place.
+    // must be called by every thread of the enclosing OpenMP parallel region (or serially)
+    void transform(std::complex<double> *data, bool inverse) const;
+    // transform one contiguous line of n values in place
+    void transformLine(std::complex<double> *line, bool inverse) const;
+
+private:
+    int n;
+    // bit-reversed index of each position
+    std::vector<int> bit_reverse;
+    // exp(-2 pi i k / n) for k < n / 2
+    std::vector<std::complex<double>> twiddles;
+};
+
+// smallest power of two not below n
+int nextPowerOfTwo(int n);
+
+#endif // FFT_HPP
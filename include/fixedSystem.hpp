@@ -0,0 +1,112 @@
+#ifndef FIXEDSYSTEM_HPP
+#define FIXEDSYSTEM_HPP
+
+#include <gravityKernel.hpp>
+#include <particleSystem.hpp>
+
+// a system of exactly N bodies in fixed-size arrays inside the object, stepped on the calling thread by direct
+// summation with the fixed-size kernel of the active instruction set: no heap, no threads, no virtual calls and
+// every loop with a trip count known at compile time. meant for small systems such as the solar system, for which
+// the overheads of the general solvers and integrators cost more than the forces.
+template <int N>
+class FixedSystem
+{
+    static_assert(N >= 1 && N <= MAX_FIXED_SIZE, "no fixed-size kernel is built for this number of bodies");
+
+public:
+    // entries of each array, N rounded up to a multiple of 8, the padding is zero
+    static constexpr int STRIDE = (N + 7) / 8 * 8;
+
+    // copy of a system of N bodies, forces softened by epsilon
+    FixedSystem(const ParticleSystem &system, double epsilon = 0) : epsilon2{epsilon * epsilon}, kernel{getFixedKernel(N)}
+    {
+        for (int i = 0; i < N; i++)
+        {
+            this->m[i] = system.masses()[i];
+            for (int d = 0; d < 3; d++)
+            {
+                this->x[d * STRIDE + i] = system.x()[d * system.stride() + i];
+                this->v[d * STRIDE + i] = system.vx()[d * system.stride() + i];
+                this->a[d * STRIDE + i] = system.ax()[d * system.stride() + i];
+            }
+        }
+    }
+    // write the positions, velocities and accelerations back into a system of N bodies
+    void copyTo(ParticleSystem &system) const
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int d = 0; d < 3; d++)
+            {
+                system.x()[d * system.stride() + i] = this->x[d * STRIDE + i];
+                system.vx()[d * system.stride() + i] = this->v[d * STRIDE + i];
+                system.ax()[d * system.stride() + i] = this->a[d * STRIDE + i];
+            }
+        }
+    }
+    // update the accelerations of all bodies
+    void computeAccelerations()
+    {
+        this->kernel(this->m, this->x, this->x + STRIDE, this->x + 2 * STRIDE, this->epsilon2, this->a, this->a + STRIDE, this->a + 2 * STRIDE);
+    }
+    // n_steps forward Euler steps of dt, the same map as EulerIntegrator
+    void eulerSteps(double dt, int n_steps)
+    {
+        for (int n = 0; n < n_steps; n++)
+        {
+            this->computeAccelerations();
+            this->kickDrift(dt, dt, true);
+        }
+    }
+    // n_steps kick-drift-kick leapfrog steps of dt, the same map as SymplecticIntegrator with SymplecticScheme::Leapfrog
+    // the opening force evaluation is left out if accelerations_current, the accelerations copied in being those of
+    // the current positions
+    void leapfrogSteps(double dt, int n_steps, bool accelerations_current = false)
+    {
+        if (n_steps <= 0)
+        {
+            return;
+        }
+        if (!accelerations_current)
+        {
+            this->computeAccelerations();
+        }
+        for (int n = 0; n < n_steps; n++)
+        {
+            // the closing half kick of a step is merged with the opening one of the next
+            this->kickDrift(n > 0 ? dt : 0.5 * dt, dt, false);
+            this->computeAccelerations();
+        }
+        this->kickDrift(0.5 * dt, 0, false);
+    }
+
+private:
+    // v += a * kick and x += v * drift for the N bodies, with the drift first if drift_first (Euler)
+    void kickDrift(double kick, double drift, bool drift_first)
+    {
+        unrolled<3>([&](auto d) {
+            for (int i = d * STRIDE; i < d * STRIDE + N; i++)
+            {
+                if (drift_first)
+                {
+                    this->x[i] += this->v[i] * drift;
+                    this->v[i] += this->a[i] * kick;
+                }
+                else
+                {
+                    this->v[i] += this->a[i] * kick;
+                    this->x[i] += this->v[i] * drift;
+                }
+            }
+        });
+    }
+
+    alignas(64) double m[STRIDE] = {};
+    alignas(64) double x[3 * STRIDE] = {};
+    alignas(64) double v[3 * STRIDE] = {};
+    alignas(64) double a[3 * STRIDE] = {};
+    double epsilon2;
+    FixedKernel kernel;
+};
+
+#endif // FIXEDSYSTEM_HPP
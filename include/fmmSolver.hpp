@@ -0,0 +1,71 @@
+#ifndef FMMSOLVER_HPP
+#define FMMSOLVER_HPP
+
+#include <array>
+#include <forceSolver.hpp>
+#include <octree.hpp>
+#include <vector>
+
+// Fast Multipole Method with Cartesian Taylor expansions of configurable order.
+// every cell carries multipole moments about its centre (P2M, M2M), well-separated cell pairs found by a dual
+// tree traversal exchange them into local expansions (M2L), which are shifted down the tree (L2L) and evaluated
+// at the particles (L2P). cells that are too close interact directly (P2P), the softening only applies there.
+// the targets are split into the independent subtrees of the octree, each walked by one thread.
+class FmmSolver : public ForceSolver
+{
+public:
+    // constructor by softening parameter, expansion order, opening angle and maximum number of particles in a leaf
+    FmmSolver(double epsilon = 0, int order = 4, double theta = 0.5, int leaf_size = 32);
+    // update the accelerations of all particles in the system
+    void computeAccelerations(ParticleSystem &system) override;
+    // get the expansion order
+    int getOrder() const;
+    // get the opening angle
+    double getTheta() const;
+
+private:
+    // out[o] += value * u[a] * v[b]
+    struct Term
+    {
+        int o, a, b;
+        double value;
+    };
+    // scratch space of one thread
+    struct Workspace
+    {
+        std::vector<double> derivatives, powers;
+    };
+    // index of the multi-index (i, j, k)
+    int termIndex(int i, int j, int k) const;
+    // d^alpha for every multi-index alpha
+    void calPowers(double dx, double dy, double dz, double *powers) const;
+    // Taylor coefficients of 1/r at (dx, dy, dz)
+    void calDerivatives(double dx, double dy, double dz, double *derivatives) const;
+    // multipoles of a subtree
+    void upward(int node, Workspace &workspace);
+    // interactions of the target cell with the source cell
+    void traverse(int target, int source, Workspace &workspace);
+    // direct interaction of the particles of two cells
+    void p2p(int target, int source);
+    // local expansions of a subtree, evaluated at its particles
+    void downward(int node, Workspace &workspace);
+
+    int order;
+    double theta;
+    Octree tree;
+    // multi-indices of the terms, by increasing degree
+    std::vector<std::array<int, 3>> terms;
+    std::vector<int> term_lookup;
+    // for each term, a lower term and the dimension it differs in (for powers)
+    std::vector<int> lower_term, lower_dim;
+    // for each term, the terms alpha - e_k and alpha - 2 e_k of the derivative recurrence (-1 if they do not exist)
+    std::vector<std::array<int, 3>> minus_one, minus_two;
+    // translation tables
+    std::vector<Term> m2m_table, m2l_table, l2l_table, gradient_table;
+    // expansions of all cells, terms.size() values per cell
+    std::vector<double> multipoles, locals;
+    // accelerations in Morton order
+    AlignedVector<double> acc_x, acc_y, acc_z;
+};
+
+#endif // FMMSOLVER_HPP
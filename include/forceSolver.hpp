@@ -0,0 +1,36 @@
+#ifndef FORCESOLVER_HPP
+#define FORCESOLVER_HPP
+
+#include <particleSystem.hpp>
+#include <vector>
+
+// computes the gravitational acceleration of every particle in a system
+class ForceSolver
+{
+public:
+    // constructor by softening parameter epsilon
+    ForceSolver(double epsilon = 0);
+    virtual ~ForceSolver() = default;
+    // update the accelerations of all particles in the system.
+    // must be called by every thread of the enclosing OpenMP parallel region (or serially), the work is shared
+    // with orphaned worksharing constructs and the accelerations are complete when the call returns on any thread.
+    virtual void computeAccelerations(ParticleSystem &system) = 0;
+    // update the accelerations of the listed particles, same calling convention as computeAccelerations.
+    // solvers that cannot restrict their targets update all particles, which the callers must tolerate.
+    virtual void computeActiveAccelerations(ParticleSystem &system, const std::vector<int> &active);
+    // get the softening parameter
+    double getEpsilon() const;
+    // whether the solver can fill the potentials of the system in the same pass as the accelerations
+    virtual bool supportsPotential() const;
+    // request the potentials with the next force evaluations, ignored if they are not supported.
+    // must not be changed while a computeAccelerations call is running on another thread
+    void setComputePotential(bool compute_potential);
+    // whether the potentials are requested and supported
+    bool getComputePotential() const;
+
+protected:
+    double epsilon;
+    bool compute_potential;
+};
+
+#endif // FORCESOLVER_HPP
@@ -3,11 +3,15 @@
 
 #include <memory>
 #include <particle.hpp>
+#include <particleSystem.hpp>
 
 class InitialConditionGenerator
 {
 public:
-    virtual std::vector<std::shared_ptr<Particle>> generateInitialConditions() = 0;
+    // generate the initial conditions as a structure-of-arrays system
+    virtual ParticleSystem generateParticleSystem() = 0;
+    // generate the initial conditions as a list of particles
+    virtual std::vector<std::shared_ptr<Particle>> generateInitialConditions();
 // private:
     std::vector<std::shared_ptr<Particle>> p_list;
 
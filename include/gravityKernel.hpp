@@ -0,0 +1,136 @@
+#ifndef GRAVITYKERNEL_HPP
+#define GRAVITYKERNEL_HPP
+
+#include <cstddef>
+#include <particleSystem.hpp>
+#include <string>
+#include <utility>
+
+// instruction sets the direct-summation kernel is built for
+enum class SimdLevel
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+// a direct-summation kernel: accelerations of the targets [begin, end) due to all n_sources sources.
+// the source arrays are 64-byte aligned and n_sources is a multiple of 8, as in a ParticleSystem.
+// a source at distance zero from the target (the target itself, or padding when epsilon is 0) is skipped.
+// the vector variants use a reciprocal square root estimate refined by Newton iterations and agree with
+// calcAcceleration to a relative error of about 1e-12.
+// if phi is not null, the potential -sum m_j / r of every target is written to it in the same pass.
+using GravityKernel = void (*)(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                               std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi);
+
+// a symmetric pair kernel: visits the pairs (i, j) for all sources j > i once and adds the contribution of j to
+// the accumulators of i and the equal and opposite contribution of i to those of j.
+// the arrays follow the same layout rules as GravityKernel, the accumulators have n_sources entries.
+// if phi is not null, the pair potentials are accumulated into it the same way.
+using PairKernel = void (*)(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                            std::size_t i, double *ax, double *ay, double *az, double *phi);
+
+// a tile kernel: adds to the accumulators of the targets [begin, end) the accelerations due to the sources
+// [source_begin, source_end) only, so that a tile of sources can be reused from cache by a block of targets.
+// source_begin and source_end are multiples of 8, the arrays follow the same layout rules as GravityKernel.
+using TileKernel = void (*)(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                            double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az);
+
+// largest system a fixed-size kernel is built for
+constexpr int MAX_FIXED_SIZE = 16;
+
+// a fixed-size kernel: accelerations of all particles of a system of the n bodies it is built for, each due to all
+// others. the targets go in the vector lanes and the loop over the n sources is unrolled at compile time.
+// the arrays have n rounded up to a multiple of 8 entries and are 64-byte aligned, the padding is written as well.
+using FixedKernel = void (*)(const double *m, const double *x, const double *y, const double *z, double epsilon2, double *ax, double *ay, double *az);
+
+// number of independent systems an ensemble kernel steps side by side
+constexpr int ENSEMBLE_LANES = 8;
+
+// an ensemble kernel: accelerations of all bodies of ENSEMBLE_LANES independent systems of n_bodies bodies each.
+// entry i * ENSEMBLE_LANES + k of an array belongs to body i of system k, so the vector lanes run across the
+// systems and a system of a few bodies keeps them all busy. the arrays are 64-byte aligned, every pair is visited
+// once. a system padded with massless bodies at the origin gets zero accelerations for them.
+using EnsembleKernel = void (*)(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                                double *ax, double *ay, double *az);
+
+// call f(std::integral_constant<int, I>{}) for I = 0, ..., N - 1, unrolled at compile time
+template <typename F, int... I>
+inline void unrolled(F &&f, std::integer_sequence<int, I...>)
+{
+    (f(std::integral_constant<int, I>{}), ...);
+}
+template <int N, typename F>
+inline void unrolled(F &&f)
+{
+    unrolled(f, std::make_integer_sequence<int, N>{});
+}
+
+// name of an instruction set, e.g. "AVX2"
+const char *simdLevelName(SimdLevel level);
+// parse a name as printed by simdLevelName (case insensitive), returns false if unknown
+bool parseSimdLevel(const std::string &name, SimdLevel &level);
+// whether the kernel for an instruction set is built in and runs on this CPU
+bool isSimdLevelSupported(SimdLevel level);
+// the best instruction set supported by this CPU
+SimdLevel detectSimdLevel();
+// the instruction set used by computeAccelerations, detected at startup
+SimdLevel getSimdLevel();
+// force an instruction set, falls back to the best supported one if it is not available
+void setSimdLevel(SimdLevel level);
+// the kernel for an instruction set
+GravityKernel getGravityKernel(SimdLevel level = getSimdLevel());
+// the symmetric pair kernel for an instruction set
+PairKernel getPairKernel(SimdLevel level = getSimdLevel());
+// the tile kernel for an instruction set
+TileKernel getTileKernel(SimdLevel level = getSimdLevel());
+// the fixed-size kernel for systems of n bodies, 1 <= n <= MAX_FIXED_SIZE, for an instruction set
+FixedKernel getFixedKernel(int n, SimdLevel level = getSimdLevel());
+// the ensemble kernel for an instruction set
+EnsembleKernel getEnsembleKernel(SimdLevel level = getSimdLevel());
+// update the accelerations of the particles [begin, end) of the system with the active kernel
+// and, if potential is set, their potentials
+void computeAccelerations(ParticleSystem &system, double epsilon, std::size_t begin, std::size_t end, bool potential = false);
+
+// kernel variants
+void accelerationsScalar(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                         std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi);
+void accelerationsSSE2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                       std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi);
+void accelerationsAVX2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                       std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi);
+void accelerationsAVX512(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                         std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi);
+void tileAccelerationsScalar(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                             double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az);
+void tileAccelerationsSSE2(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                           double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az);
+void tileAccelerationsAVX2(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                           double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az);
+void tileAccelerationsAVX512(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                             double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az);
+void pairAccelerationsScalar(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                             std::size_t i, double *ax, double *ay, double *az, double *phi);
+void pairAccelerationsSSE2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi);
+void pairAccelerationsAVX2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi);
+void pairAccelerationsAVX512(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                             std::size_t i, double *ax, double *ay, double *az, double *phi);
+// fixed-size kernel variants for systems of n bodies
+FixedKernel fixedKernelScalar(int n);
+FixedKernel fixedKernelSSE2(int n);
+FixedKernel fixedKernelAVX2(int n);
+FixedKernel fixedKernelAVX512(int n);
+// ensemble kernel variants
+void ensembleAccelerationsScalar(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                                 double *ax, double *ay, double *az);
+void ensembleAccelerationsSSE2(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                               double *ax, double *ay, double *az);
+void ensembleAccelerationsAVX2(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                               double *ax, double *ay, double *az);
+void ensembleAccelerationsAVX512(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                                 double *ax, double *ay, double *az);
+
+#endif // GRAVITYKERNEL_HPP
@@ -0,0 +1,72 @@
+#ifndef IAS15INTEGRATOR_HPP
+#define IAS15INTEGRATOR_HPP
+
+#include <array>
+#include <integrator.hpp>
+#include <vector>
+
+// adaptive 15th order Gauss-Radau integrator in the style of IAS15 (Rein & Spiegel 2015).
+// over a step the acceleration is a polynomial of degree 7 in time, fitted by predictor-corrector iterations to
+// the accelerations at the 7 Gauss-Radau nodes. the size of its highest coefficient relative to the accelerations
+// estimates the error, which sets the next step so the error stays at the tolerance (1e-9 gives errors below
+// double precision), and steps whose new size falls below a quarter of the tried one are rejected and redone.
+// positions and velocities are summed with compensation, so round-off does not grow over long runs.
+// integrate() advances the system by the total time dt * n_steps, dt is only the first trial step. the last step
+// of a call is cut short to end at that time; a call declared to continue the previous one (setAccelerationsCurrent)
+// goes on from the step size and the predicted polynomial left by it, otherwise it starts afresh.
+class Ias15Integrator : public Integrator
+{
+public:
+    // constructor by error tolerance
+    Ias15Integrator(double tolerance = 1e-9);
+    // advance the system by dt * n_steps with adaptive steps
+    void integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps) override;
+    // get the error tolerance
+    double getTolerance() const;
+    // number of steps accepted by the last call
+    long long getAcceptedSteps() const;
+    // number of steps rejected by the last call
+    long long getRejectedSteps() const;
+    // size of the step the last call would have taken next
+    double getStep() const;
+    // accepted and rejected steps of the last call
+    std::string getStepReport() const override;
+    // every step starts and ends with a force evaluation at the current state
+    bool recordsEnergy() const override;
+    // the last step ends with the accelerations of the final state
+    bool leavesAccelerationsCurrent() const override;
+    // forget the step size and the predicted polynomial
+    void clearState() override;
+
+private:
+    static constexpr int NODES = 8;
+    // x_{n} at node n by the current polynomial, into the stage system
+    void predict(ParticleSystem &system, int node);
+    // update the polynomial with the accelerations of the stage system at node n
+    void correct(const ParticleSystem &system, int node);
+    // rescale the polynomial to a step shorter by step_ratio from the same start
+    void rescale(std::size_t length);
+    // g coefficients from b coefficients
+    void updateG(std::size_t length);
+
+    double tolerance;
+    // Gauss-Radau nodes in [0, 1], the first one is 0
+    std::array<double, NODES> nodes;
+    // b_k = sum_j c[j][k] g_j
+    std::array<std::array<double, NODES - 1>, NODES - 1> c;
+    // binomial coefficients, to shift the polynomial to the next step
+    std::array<std::array<double, NODES>, NODES> binomial;
+    // coefficients of the acceleration polynomial a(t) = a0 + sum_k b_k t^(k+1), in divided differences (g),
+    // and as predicted at the start of the step (e), each 3 * stride values
+    std::array<AlignedVector<double>, NODES - 1> b, g, e;
+    // compensation of the summed positions and velocities
+    AlignedVector<double> compensation_x, compensation_v;
+    // positions at the nodes, and the accelerations there
+    ParticleSystem stage;
+    // state of the step control, shared by the threads
+    double time, step, step_ratio, max_acceleration, max_change, max_b, last_change;
+    bool finished, converged, accepted, predicted;
+    long long accepted_steps, rejected_steps;
+};
+
+#endif // IAS15INTEGRATOR_HPP
@@ -0,0 +1,57 @@
+#ifndef INTEGRATOR_HPP
+#define INTEGRATOR_HPP
+
+#include <forceSolver.hpp>
+#include <particleSystem.hpp>
+#include <string>
+
+// advances the positions and velocities of a system in time, with accelerations from a force solver
+class Integrator
+{
+public:
+    virtual ~Integrator() = default;
+    // advance the system by n_steps steps of dt.
+    // must be called by every thread of the enclosing OpenMP parallel region (or serially), like
+    // ForceSolver::computeAccelerations, the system is complete when the call returns on any thread.
+    virtual void integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps) = 0;
+    // number of accelerations of single particles evaluated by the last call
+    long long getForceEvaluations() const;
+    // summary of the steps taken by the last call for integrators that choose their own, empty otherwise
+    virtual std::string getStepReport() const;
+    // whether the integrator can take the energies at the start and the end of integrate from the potentials of
+    // its own first and last force evaluations, which the solver must support (ForceSolver::supportsPotential)
+    virtual bool recordsEnergy() const;
+    // request the energies with the next calls of integrate, must not be changed during a call
+    void setRecordEnergy(bool record_energy);
+    // whether the energies are requested
+    bool getRecordEnergy() const;
+    // declare whether the accelerations in the systems passed to the next calls of integrate are those of their
+    // current positions, as left by a previous call (see leavesAccelerationsCurrent), so that schemes starting
+    // with a force evaluation can skip it and schemes keeping a state between steps can carry it over from that
+    // call. must not be changed during a call
+    void setAccelerationsCurrent(bool accelerations_current);
+    // whether the accelerations are declared current
+    bool getAccelerationsCurrent() const;
+    // whether integrate leaves the accelerations of the final positions in the system
+    virtual bool leavesAccelerationsCurrent() const;
+    // forget the state carried over between calls besides the accelerations, so that the next call starts the way
+    // a fresh integrator would, as after a restart from a checkpoint
+    virtual void clearState();
+    // total energy before the last call of integrate, if recorded
+    double getInitialEnergy() const;
+    // total energy after the last call of integrate, if recorded
+    double getFinalEnergy() const;
+
+protected:
+    // total energy from the potentials filled by the last force evaluation, then stop requesting them.
+    // called by a single thread
+    double takeEnergy(const ParticleSystem &system, ForceSolver &solver) const;
+
+    long long force_evaluations = 0;
+    bool record_energy = false;
+    bool accelerations_current = false;
+    double initial_energy = 0;
+    double final_energy = 0;
+};
+
+#endif // INTEGRATOR_HPP
@@ -0,0 +1,16 @@
+#ifndef KEPLER_HPP
+#define KEPLER_HPP
+
+#include <cstddef>
+
+// number of orbits solved together by keplerDrift
+constexpr int KEPLER_BATCH = 64;
+
+// advance n independent two-body orbits about a fixed central mass mu by time dt, in place.
+// positions and velocities are relative to the central mass. Kepler's equation is solved in universal
+// variables for every kind of orbit, by Newton's method on a whole batch at once: the Stumpff functions are
+// evaluated by their series in a branch-free loop the compiler vectorises, and only arguments too large for the
+// series (steps of a sizeable fraction of an orbit) fall back to the trigonometric forms.
+void keplerDrift(double mu, double dt, std::size_t n, double *x, double *y, double *z, double *vx, double *vy, double *vz);
+
+#endif // KEPLER_HPP
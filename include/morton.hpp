@@ -0,0 +1,34 @@
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+// bits per dimension of a Morton key, three dimensions fill the lower 63 bits
+constexpr int MORTON_BITS = 21;
+
+// spread the lower 21 bits of v so that two zero bits sit between neighbouring bits
+inline std::uint64_t spreadBits(std::uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+// Morton (Z-order) key of a point in the cube of edge size with its lowest corner at (min_x, min_y, min_z).
+// each triplet of bits holds x, y, z from high to low, the top triplet selects the octant of the cube.
+inline std::uint64_t mortonKey(double x, double y, double z, double min_x, double min_y, double min_z, double size)
+{
+    const double scale = static_cast<double>(1 << MORTON_BITS) / size;
+    auto cell = [scale](double v, double min) {
+        double u = (v - min) * scale;
+        return static_cast<std::uint64_t>(std::min(std::max(u, 0.0), static_cast<double>((1 << MORTON_BITS) - 1)));
+    };
+    return spreadBits(cell(x, min_x)) << 2 | spreadBits(cell(y, min_y)) << 1 | spreadBits(cell(z, min_z));
+}
+
+#endif // MORTON_HPP
@@ -0,0 +1,38 @@
+#ifndef MORTONSORTER_HPP
+#define MORTONSORTER_HPP
+
+#include <cstdint>
+#include <particleSystem.hpp>
+#include <vector>
+
+// reorders the storage of a system along the Morton (Z-order) curve of its bounding cube, so that particles close
+// in space are close in memory. the keys are sorted by a parallel least significant digit radix sort, passes in
+// which all keys share the digit are skipped. the particles keep their ids, restore puts them back in id order.
+class MortonSorter
+{
+public:
+    // sort the particles of the system along the Morton curve.
+    // must be called by every thread of the enclosing OpenMP parallel region (or serially), like
+    // ForceSolver::computeAccelerations, the system is sorted when the call returns on any thread.
+    void sort(ParticleSystem &system);
+    // put the particles back in the order of their ids, same calling convention as sort
+    void restore(ParticleSystem &system);
+
+private:
+    // bits sorted per radix pass
+    static constexpr int RADIX_BITS = 8;
+    static constexpr int RADIX = 1 << RADIX_BITS;
+    // sort the first n keys, carrying the particle indices in order along
+    void radixSort(int n);
+    // move the particle order[s] of the system to slot s
+    void permute(ParticleSystem &system);
+
+    std::vector<std::uint64_t> keys, scratch_keys;
+    std::vector<int> order, scratch_order;
+    // digit counts of each thread, turned into the first output slot of each digit and thread
+    std::vector<std::size_t> histograms;
+    bool skip_pass;
+    ParticleSystem scratch;
+};
+
+#endif // MORTONSORTER_HPP
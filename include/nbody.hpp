@@ -3,15 +3,58 @@
 
 #include <Eigen/Core>
 #include <memory>
+#include <particleSystem.hpp>
+#include <checkpoint.hpp>
+#include <ensembleSystem.hpp>
+#include <forceSolver.hpp>
+#include <integrator.hpp>
+#include <simulator.hpp>
+#include <string>
 
 class Particle;
+class TrajectoryWriter;
 // calculate the acceleration of p1 due to p2
 Eigen::Vector3d calcAcceleration(Particle &p1, Particle &p2, double epsilon = 0);
 // update the position and velocity of each body
 std::vector<std::shared_ptr<Particle>> update_Solar_System(std::vector<std::shared_ptr<Particle>> Solar_System, double dt, double total_time, int n_steps, double epsilon = 0);
+// update the position and velocity of each body, with accelerations from solver, advanced by integrator
+std::vector<std::shared_ptr<Particle>> update_Solar_System(std::vector<std::shared_ptr<Particle>> Solar_System, ForceSolver &solver, Integrator &integrator, double dt, double total_time, int n_steps);
+// update the position and velocity of each body of a structure-of-arrays system in place
+void update_Solar_System(ParticleSystem &system, double dt, double total_time, int n_steps, double epsilon = 0);
+// update the position and velocity of each body of a structure-of-arrays system in place, with accelerations from solver
+void update_Solar_System(ParticleSystem &system, ForceSolver &solver, double dt, double total_time, int n_steps);
+// update the position and velocity of each body of a structure-of-arrays system in place, advanced by integrator.
+// if sort_interval > 0 the storage is sorted along a Morton curve every sort_interval steps, the bodies are
+// returned in their original order
+void update_Solar_System(ParticleSystem &system, ForceSolver &solver, Integrator &integrator, double dt, double total_time, int n_steps, int sort_interval = 0);
+// advance a system as update_Solar_System does, without the report: by the fixed-size engine if it computes the
+// same steps, else by all OpenMP threads from getParallelThreshold() bodies on and on the calling thread below.
+// to advance different systems on the threads of a parallel region, call it inside a nested region of one thread,
+// which the worksharing constructs of the steps then bind to.
+// returns the number of force evaluations of single particles
+long long advanceSystem(ParticleSystem &system, ForceSolver &solver, Integrator &integrator, double dt, int n_steps, int sort_interval = 0);
+// smallest number of bodies stepped by all OpenMP threads, smaller systems step on the calling thread.
+// measured once per process, never reached if only one thread is available
+int getParallelThreshold();
 // simulate the solar system with time step dt and total time total_time
 void run_Solar_System(double dt, double total_time, int n_steps, double epsilon = 0);
+// simulate the solar system with time step dt and total time total_time, with accelerations from solver
+void run_Solar_System(ForceSolver &solver, double dt, double total_time, int n_steps);
+// simulate the solar system with time step dt and total time total_time, with accelerations from solver, advanced by integrator
+void run_Solar_System(ForceSolver &solver, Integrator &integrator, double dt, double total_time, int n_steps);
+// advance a simulator to info.target_steps steps and print the running time and the energy change since the start
+// of the run. unless checkpoint_path is empty, a checkpoint is written to it every info.interval steps of the run
+// and after the last one; unless trajectory is null, a snapshot is handed to it every trajectory->getInterval()
+// steps, and it is closed at the end. returns false if an output cannot be written
+bool run_Simulation(Simulator &simulator, const CheckpointInfo &info, const std::string &checkpoint_path, TrajectoryWriter *trajectory = nullptr);
+// simulate the random systems of num_planets planets for the seeds [first_seed, first_seed + n_seeds) side by side
+// in an ensemble, with time step dt and total time total_time, and print the energy drift of each seed
+void run_Ensemble(int num_planets, int first_seed, int n_seeds, double epsilon, EnsembleScheme scheme, double dt, double total_time, int n_steps);
 // calculate the total energy of the solar system
 double calTotalEnergy(const std::vector<std::shared_ptr<Particle>>& Solar_System);
+// calculate the total energy of a structure-of-arrays system, with the potential softened by epsilon
+double calTotalEnergy(const ParticleSystem &system, double epsilon = 0);
+// calculate the total energy of a system from the potentials filled by the last force evaluation
+double calTotalEnergyFromPotentials(const ParticleSystem &system);
 
 # endif // NBODY_HPP
\ No newline at end of file
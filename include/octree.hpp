@@ -0,0 +1,72 @@
+#ifndef OCTREE_HPP
+#define OCTREE_HPP
+
+#include <cstdint>
+#include <particleSystem.hpp>
+#include <utility>
+#include <vector>
+
+// a cell of the octree, children of a cell are stored next to each other
+struct OctreeNode
+{
+    // centre of mass and total mass of the particles in the cell
+    double x, y, z, mass;
+    // geometric centre and edge length of the cell
+    double cx, cy, cz, size;
+    // index of the first child and number of children, first_child is -1 for leaves
+    int first_child, n_children;
+    // range of the cell's particles in Morton order
+    int begin, end;
+};
+
+// octree over the particles of a system sorted along a Morton curve.
+// the top two levels are built serially, the cells below them become independent subtrees built in parallel
+// and are then attached to one flat array of nodes with the root first.
+class Octree
+{
+public:
+    // constructor by maximum number of particles in a leaf
+    Octree(int leaf_size = 8);
+    // rebuild the tree for the system.
+    // must be called by every thread of the enclosing OpenMP parallel region (or serially)
+    void build(const ParticleSystem &system);
+    // get the nodes of the tree, the root is the first one
+    const std::vector<OctreeNode> &getNodes() const;
+    // cells whose subtrees together hold every particle exactly once, so they can be processed independently
+    const std::vector<int> &getSubtreeRoots() const;
+    // number of nodes in the serially built top levels, they come first in the node array
+    int getTopCount() const;
+    // number of particles in the tree
+    int size() const { return this->keys.size(); }
+    // original index of the s-th particle in Morton order
+    int getIndex(int s) const { return this->keys[s].second; }
+    // masses and positions in Morton order
+    const double *masses() const { return this->sorted_mass.data(); }
+    const double *x() const { return this->sorted_x.data(); }
+    const double *y() const { return this->sorted_y.data(); }
+    const double *z() const { return this->sorted_z.data(); }
+
+private:
+    // a subtree whose construction is deferred to the parallel phase
+    struct DeferredCell
+    {
+        int node, begin, end, level;
+        double cx, cy, cz, size;
+    };
+    // build the cell of the sorted particles [begin, end) into nodes[index]
+    void buildNode(std::vector<OctreeNode> &nodes, int index, int begin, int end, int level, double cx, double cy, double cz, double size, bool top);
+
+    int leaf_size;
+    // Morton keys paired with the original particle indices, sorted by key
+    std::vector<std::pair<std::uint64_t, int>> keys;
+    AlignedVector<double> sorted_mass, sorted_x, sorted_y, sorted_z;
+    std::vector<OctreeNode> nodes;
+    std::vector<DeferredCell> deferred;
+    std::vector<std::vector<OctreeNode>> subtrees;
+    std::vector<int> subtree_roots;
+    int n_top;
+    // bounding cube of the particles
+    double min_x, min_y, min_z, box_size;
+};
+
+#endif // OCTREE_HPP
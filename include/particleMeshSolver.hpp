@@ -0,0 +1,46 @@
+#ifndef PARTICLEMESHSOLVER_HPP
+#define PARTICLEMESHSOLVER_HPP
+
+#include <complex>
+#include <fft.hpp>
+#include <forceSolver.hpp>
+#include <vector>
+
+// schemes to assign masses to the mesh and to interpolate accelerations back
+enum class MassAssignment
+{
+    CIC, // cloud in cell, 2 x 2 x 2 nodes
+    TSC  // triangular shaped cloud, 3 x 3 x 3 nodes
+};
+
+// particle-mesh solver for large, smooth distributions: masses are assigned to a grid over the bounding cube,
+// the potential is the convolution with 1/r done by FFT on a grid padded to twice the size (so the system is
+// isolated, not periodic), and accelerations are central differences of the potential interpolated back with
+// the same scheme. forces are smoothed on the scale of a grid cell, the softening parameter is not used.
+class ParticleMeshSolver : public ForceSolver
+{
+public:
+    // constructor by softening parameter, number of grid nodes per dimension (rounded up to a power of two) and assignment scheme
+    ParticleMeshSolver(double epsilon = 0, int grid_size = 64, MassAssignment assignment = MassAssignment::TSC);
+    // update the accelerations of all particles in the system
+    void computeAccelerations(ParticleSystem &system) override;
+    // get the number of grid nodes per dimension
+    int getGridSize() const;
+
+private:
+    // grid nodes and weights of one coordinate, returns the number of nodes used
+    int weights(double u, int *nodes, double *w) const;
+
+    int grid_size;
+    MassAssignment assignment;
+    // transform of the padded grid, twice grid_size per dimension
+    Fft3d fft;
+    // transform of the Green's function -1/r for unit node spacing
+    std::vector<std::complex<double>> green;
+    // padded density grid, then potential
+    std::vector<std::complex<double>> mesh;
+    // corner of the grid and node spacing
+    double origin_x, origin_y, origin_z, spacing;
+};
+
+#endif // PARTICLEMESHSOLVER_HPP
@@ -0,0 +1,153 @@
+#ifndef PARTICLESYSTEM_HPP
+#define PARTICLESYSTEM_HPP
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+class Particle;
+
+// allocator handing out cache-line aligned storage, so that SIMD kernels can use aligned loads
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T *p, std::size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// a 3-vector whose x/y/z components live in three different arrays of a ParticleSystem
+using Vector3dView = Eigen::Map<Eigen::Vector3d, Eigen::Unaligned, Eigen::InnerStride<>>;
+
+class ParticleSystem;
+
+// a thin Particle-style handle on one particle of a ParticleSystem
+class ParticleView
+{
+public:
+    // constructor by system and index
+    ParticleView(ParticleSystem &system, std::size_t index);
+    // get the position of the particle
+    Vector3dView getPosition();
+    // get the velocity of the particle
+    Vector3dView getVelocity();
+    // get the acceleration of the particle
+    Vector3dView getAcceleration();
+    // get the mass of the particle
+    const double &getMass();
+    // update the position and velocity of the particle
+    void update(double dt);
+    // set the acceleration of the particle
+    void setAcceleration(const Eigen::Vector3d &acceleration);
+    // set the velocity of the particle
+    void setVelocity(const Eigen::Vector3d &velocity);
+    // set the position of the particle
+    void setPosition(const Eigen::Vector3d &position);
+    // calculate the kinetic energy of the particle
+    double calKineticEnergy();
+
+private:
+    ParticleSystem &system;
+    std::size_t index;
+};
+
+// all particles of a system stored as a structure of arrays.
+// positions, velocities and accelerations are each kept in one aligned buffer of three blocks (x, then y, then z)
+// of length stride(), a multiple of eight, so every block starts on a cache line. Entries past size() are zero.
+// every particle carries a stable id, its index when it was added, which follows it when the storage is reordered.
+class ParticleSystem
+{
+public:
+    // constructor of an empty system
+    ParticleSystem();
+    // constructor by number of particles, all with zero mass at the origin
+    explicit ParticleSystem(std::size_t n);
+    // constructor copying a list of particles
+    explicit ParticleSystem(const std::vector<std::shared_ptr<Particle>> &p_list);
+    // append a particle to the system
+    void addParticle(double mass, const Eigen::Vector3d &position, const Eigen::Vector3d &velocity, const Eigen::Vector3d &acceleration);
+    // reserve storage for at least n particles
+    void reserve(std::size_t n);
+    // number of particles in the system
+    std::size_t size() const { return n; }
+    // distance between the x, y and z blocks of the arrays
+    std::size_t stride() const { return capacity; }
+    // get a Particle-style view of the i-th particle
+    ParticleView operator[](std::size_t i);
+    // raw arrays
+    double *masses() { return mass.data(); }
+    const double *masses() const { return mass.data(); }
+    double *x() { return position.data(); }
+    double *y() { return position.data() + capacity; }
+    double *z() { return position.data() + 2 * capacity; }
+    const double *x() const { return position.data(); }
+    const double *y() const { return position.data() + capacity; }
+    const double *z() const { return position.data() + 2 * capacity; }
+    double *vx() { return velocity.data(); }
+    double *vy() { return velocity.data() + capacity; }
+    double *vz() { return velocity.data() + 2 * capacity; }
+    const double *vx() const { return velocity.data(); }
+    const double *vy() const { return velocity.data() + capacity; }
+    const double *vz() const { return velocity.data() + 2 * capacity; }
+    double *ax() { return acceleration.data(); }
+    double *ay() { return acceleration.data() + capacity; }
+    double *az() { return acceleration.data() + 2 * capacity; }
+    const double *ax() const { return acceleration.data(); }
+    const double *ay() const { return acceleration.data() + capacity; }
+    const double *az() const { return acceleration.data() + 2 * capacity; }
+    // potentials -sum m_j / r, filled by the force solvers that support it
+    double *potentials() { return potential.data(); }
+    const double *potentials() const { return potential.data(); }
+    // stable ids, -1 past size()
+    int *ids() { return id.data(); }
+    const int *ids() const { return id.data(); }
+    // update the position and velocity of the i-th particle
+    void update(std::size_t i, double dt);
+    // update the acceleration of the i-th particle by all other particles
+    void updateAcceleration(std::size_t i, double epsilon);
+    // calculate the kinetic energy of the i-th particle
+    double calKineticEnergy(std::size_t i) const;
+    // calculate the potential energy of the i-th particle with all other particles (half of each pair)
+    double calPotentialEnergy(std::size_t i) const;
+    // copy the particles source[order[s]] into the slots s in [begin, end), the system must hold at least end particles
+    void gather(const ParticleSystem &source, const int *order, std::size_t begin, std::size_t end);
+    // copy positions, velocities and accelerations back into a list of particles of the same size, by id
+    void copyTo(const std::vector<std::shared_ptr<Particle>> &p_list) const;
+    // create a new list of particles from the system, in the order of the ids
+    std::vector<std::shared_ptr<Particle>> toParticles() const;
+
+private:
+    std::size_t n;
+    std::size_t capacity;
+    AlignedVector<double> mass;
+    AlignedVector<double> position;
+    AlignedVector<double> velocity;
+    AlignedVector<double> acceleration;
+    AlignedVector<double> potential;
+    std::vector<int> id;
+};
+
+#endif // PARTICLESYSTEM_HPP
@@ -0,0 +1,52 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// hardware events counted around the profiled phases
+enum class PerfEvent
+{
+    Cycles,
+    Instructions,
+    L1dMisses,   // level 1 data cache read misses
+    LlcMisses,   // last level cache read misses
+    BranchMisses,
+    Count
+};
+
+constexpr int PERF_EVENTS = static_cast<int>(PerfEvent::Count);
+using PerfValues = std::array<std::uint64_t, PERF_EVENTS>;
+// lower case name of an event, as in the reports
+const char *perfEventName(PerfEvent event);
+
+// Linux hardware performance counters of the calling thread, read through perf_event_open. each thread opens its
+// own group of the events on its first read, counting user space only so that the usual perf_event_paranoid
+// setting allows it. events the machine does not expose are left out, and if none can be opened, as in most
+// containers and virtual machines, the counters stay inactive and the profile reports wall time only
+class PerfCounters
+{
+public:
+    // the counters of the process
+    static PerfCounters &get();
+    // open the counters on the calling thread and have the profile scopes read them. returns false, with the
+    // reason in error, if no event can be counted
+    bool start(std::string &error);
+    // whether the profile scopes read the counters
+    bool isActive() const { return this->active.load(std::memory_order_acquire); }
+    // whether an event is counted
+    bool isAvailable(PerfEvent event) const;
+    // the running totals of the calling thread, scaled up if the kernel multiplexed the group. the events that are
+    // not counted read 0. returns false if the counters of the thread cannot be opened or read
+    bool read(PerfValues &values);
+
+private:
+    PerfCounters() = default;
+
+    std::atomic<bool> active{false};
+    std::array<bool, PERF_EVENTS> available{};
+};
+
+#endif // PERFCOUNTERS_HPP
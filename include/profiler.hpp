@@ -0,0 +1,130 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <omp.h>
+#include <ostream>
+#include <perfCounters.hpp>
+#include <string>
+#include <vector>
+
+// phases of a run timed by the profiler
+enum class ProfilePhase
+{
+    Force,       // force evaluations of the solvers
+    Integration, // kicks and drifts of the integrators
+    Energy,      // total energies
+    IO,          // checkpoints and trajectory frames
+    Barrier,     // waits at the barriers between the phases of a step
+    Step,        // whole calls of advanceSystem, counted per step
+    Count
+};
+
+constexpr int PROFILE_PHASES = static_cast<int>(ProfilePhase::Count);
+// lower case name of a phase, as in the reports
+const char *profilePhaseName(ProfilePhase phase);
+// bins of the duration histograms, bin b counts the durations in [2^b, 2^(b+1)) ns
+constexpr int PROFILE_BINS = 40;
+// flops of one pair interaction, the usual convention for direct N-body codes
+constexpr double PROFILE_FLOPS_PER_PAIR = 20;
+
+// accumulated times of the phases on every thread that recorded one, and the pair interactions of direct summation.
+// each thread adds to its own counters, created on its first record, so recording takes no lock after that.
+// the scopes are only compiled in with NBODY_PROFILE (the CMake option of the same name), see the macros below
+class Profiler
+{
+public:
+    // the profiler of the process
+    static Profiler &get();
+    // write the report to the path set by setReportPath, if any
+    ~Profiler();
+    // whether the library was built with the scopes compiled in
+    static bool isEnabled();
+    // add a duration of a phase on the calling thread, spanning count occurrences of equal length
+    void record(ProfilePhase phase, double seconds, long long count = 1);
+    // add the hardware events counted over a phase on the calling thread
+    void recordEvents(ProfilePhase phase, const PerfValues &events);
+    // add pair interactions computed by direct summation
+    void addInteractions(long long interactions);
+    // clear the counters of all threads, called outside a parallel region
+    void reset();
+    // write a JSON report: the total, per-thread times and histogram of each phase, the interactions per second
+    // and GFLOP/s of the force evaluations, timed by the slowest thread, and the hardware events of each phase
+    // summed over the threads while PerfCounters are active
+    void writeReport(std::ostream &out) const;
+    // write the report to a file when the process exits
+    void setReportPath(const std::string &path);
+
+private:
+    struct alignas(64) ThreadCounters
+    {
+        std::array<double, PROFILE_PHASES> seconds{};
+        std::array<long long, PROFILE_PHASES> occurrences{};
+        std::array<std::array<long long, PROFILE_BINS>, PROFILE_PHASES> histogram{};
+        long long interactions = 0;
+        std::array<PerfValues, PROFILE_PHASES> events{};
+    };
+
+    Profiler() = default;
+    // the counters of the calling thread
+    ThreadCounters &local();
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadCounters>> threads;
+    std::string report_path;
+};
+
+// times the enclosing scope into a phase on the calling thread, hands it to the tracer while one is running and
+// counts its hardware events while PerfCounters are active
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfilePhase phase, long long count = 1);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    ProfilePhase phase;
+    long long count;
+    std::chrono::steady_clock::time_point start;
+    bool counting = false;
+    PerfValues events_start;
+};
+
+// NBODY_PROFILE_SCOPE(phase[, count]) times the rest of the enclosing scope, NBODY_PROFILE_INTERACTIONS(n) counts
+// the pair interactions of a force evaluation once per team, and NBODY_BARRIER() is an OpenMP barrier whose wait
+// is timed. without NBODY_PROFILE the first two expand to nothing (their arguments are not evaluated) and the last
+// to the bare barrier
+#ifdef NBODY_PROFILE
+#define NBODY_PROFILE_JOIN_(a, b) a##b
+#define NBODY_PROFILE_JOIN(a, b) NBODY_PROFILE_JOIN_(a, b)
+#define NBODY_PROFILE_SCOPE(...) ProfileScope NBODY_PROFILE_JOIN(profile_scope_, __LINE__)(__VA_ARGS__)
+#define NBODY_PROFILE_INTERACTIONS(n)                 \
+    do                                                \
+    {                                                 \
+        if (omp_get_thread_num() == 0)                \
+        {                                             \
+            Profiler::get().addInteractions(n);       \
+        }                                             \
+    } while (0)
+#define NBODY_BARRIER()                                      \
+    do                                                       \
+    {                                                        \
+        ProfileScope profile_barrier(ProfilePhase::Barrier); \
+        _Pragma("omp barrier")                               \
+    } while (0)
+#else
+#define NBODY_PROFILE_SCOPE(...) static_cast<void>(0)
+#define NBODY_PROFILE_INTERACTIONS(n) static_cast<void>(0)
+#define NBODY_BARRIER()        \
+    do                         \
+    {                          \
+        _Pragma("omp barrier") \
+    } while (0)
+#endif
+
+#endif // PROFILER_HPP
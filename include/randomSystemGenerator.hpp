@@ -10,7 +10,7 @@ public:
     // constructor, default seed is 2023
     RandomSystemGenerator(int num_planets, int seed = 2023, double epsilon = 0.001);
     // generate the initial conditions
-    std::vector<std::shared_ptr<Particle>> generateInitialConditions();
+    ParticleSystem generateParticleSystem();
 private:
     int seed;
     int num_planets;
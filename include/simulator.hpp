@@ -0,0 +1,65 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <forceSolver.hpp>
+#include <integrator.hpp>
+#include <memory>
+#include <particleSystem.hpp>
+
+// how far a run has got besides the system, enough to resume it exactly
+struct SimulatorProgress
+{
+    // the time is counted in steps from the last change of dt (the epoch), so that it does not drift by rounding
+    double epoch = 0;
+    long long epoch_steps = 0;
+    long long steps = 0;
+    long long force_evaluations = 0;
+    // whether the accelerations in the system are those of its positions, left by the last steps
+    bool accelerations_current = false;
+};
+
+// a system with its solver, integrator and time step, advanced in place by any number of steps at a time.
+// between calls the run is paused at a step boundary and can be inspected, edited and resumed; the calls copy and
+// allocate nothing themselves. the integrators carry their accelerations and state over from one call to the next,
+// so the calls take the same steps as a single call of advanceSystem over the same total, except for the adaptive
+// steps of Ias15Integrator, whose last step in each call is cut short to end on the step boundary.
+// every call is made outside a parallel region, the storage is not re-sorted
+class Simulator
+{
+public:
+    // constructor taking over a system, stepped by dt from time 0
+    Simulator(ParticleSystem system, std::shared_ptr<ForceSolver> solver, std::shared_ptr<Integrator> integrator, double dt);
+    // advance by one step
+    void step();
+    // advance by n_steps steps
+    void advance(int n_steps);
+    // advance by the whole steps that do not take the time past t, returns their number
+    int runUntil(double t);
+    // time reached
+    double getTime() const;
+    // steps taken
+    long long getSteps() const;
+    // force evaluations of single particles over all steps
+    long long getForceEvaluations() const;
+    double getDt() const;
+    // change the time step of the next steps
+    void setDt(double dt);
+    const ParticleSystem &getSystem() const;
+    // the system for changes between steps, after which its accelerations are recomputed
+    ParticleSystem &editSystem();
+    ForceSolver &getSolver();
+    Integrator &getIntegrator();
+    // the progress, saved with the system to resume the run later
+    const SimulatorProgress &getProgress() const;
+    // continue from a saved progress, the system holding the state saved with it
+    void setProgress(const SimulatorProgress &progress);
+
+private:
+    ParticleSystem system;
+    std::shared_ptr<ForceSolver> solver;
+    std::shared_ptr<Integrator> integrator;
+    double dt;
+    SimulatorProgress progress;
+};
+
+#endif // SIMULATOR_HPP
@@ -9,7 +9,7 @@ public:
     // constructor
     SolarSystemGenerator();
     // generate the initial conditions
-    std::vector<std::shared_ptr<Particle>> generateInitialConditions();
+    ParticleSystem generateParticleSystem();
 };
 
 #endif /* SOLARSYSTEMGENERATOR_HPP */
@@ -0,0 +1,59 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <forceSolver.hpp>
+#include <functional>
+#include <integrator.hpp>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// one run of a sweep, its parameters and results
+struct SweepRun
+{
+    // planets of the random system, 0 for the solar system
+    int n_particles;
+    int seed;
+    double epsilon;
+    double dt;
+    int n_steps;
+    // bodies of the system, wall-clock time of the steps in ms, total energies before and after
+    int n_bodies = 0;
+    double running_time = 0;
+    double initial_energy = 0;
+    double final_energy = 0;
+};
+
+// every combination of numbers of planets, seeds, softening parameters and time steps, run in one process.
+// the runs of systems below getParallelThreshold() bodies are spread over the threads, one run per thread at a
+// time, and the larger ones follow one after another, each stepped by all threads.
+class Sweep
+{
+public:
+    // a fresh solver with a softening parameter, and a fresh integrator, for every run
+    using SolverFactory = std::function<std::shared_ptr<ForceSolver>(double epsilon)>;
+    using IntegratorFactory = std::function<std::shared_ptr<Integrator>()>;
+
+    // constructor by parameter lists, a number of planets of 0 stands for the solar system (the seeds do not apply).
+    // every run covers total_time years, or n_steps steps if n_steps > 0. random systems are re-sorted every
+    // sort_interval steps as in update_Solar_System
+    Sweep(const std::vector<int> &n_particles, const std::vector<int> &seeds, const std::vector<double> &epsilons, const std::vector<double> &dts,
+          double total_time, int n_steps, SolverFactory make_solver, IntegratorFactory make_integrator, int sort_interval = 0);
+    // execute all runs, called outside a parallel region
+    void run();
+    // the runs, in the order of the parameter lists with the time step varying fastest
+    const std::vector<SweepRun> &getRuns() const;
+    // write the results as one markdown table
+    void print(std::ostream &out) const;
+
+private:
+    // set up, step and measure one run
+    void execute(SweepRun &run) const;
+
+    std::vector<SweepRun> runs;
+    SolverFactory make_solver;
+    IntegratorFactory make_integrator;
+    int sort_interval;
+};
+
+#endif // SWEEP_HPP
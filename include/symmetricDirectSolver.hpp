@@ -0,0 +1,23 @@
+#ifndef SYMMETRICDIRECTSOLVER_HPP
+#define SYMMETRICDIRECTSOLVER_HPP
+
+#include <forceSolver.hpp>
+
+// all-pairs summation visiting every pair i < j once and applying equal and opposite contributions.
+// each thread accumulates into its own buffer, the buffers are summed once all pairs are done.
+class SymmetricDirectSolver : public ForceSolver
+{
+public:
+    // constructor by softening parameter epsilon
+    SymmetricDirectSolver(double epsilon = 0);
+    // update the accelerations of all particles in the system
+    void computeAccelerations(ParticleSystem &system) override;
+    // the potentials come out of the same kernel
+    bool supportsPotential() const override;
+
+private:
+    // x/y/z accelerations and potentials of each thread, 4 * stride values per thread
+    AlignedVector<double> thread_buffers;
+};
+
+#endif // SYMMETRICDIRECTSOLVER_HPP
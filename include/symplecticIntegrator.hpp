@@ -0,0 +1,47 @@
+#ifndef SYMPLECTICINTEGRATOR_HPP
+#define SYMPLECTICINTEGRATOR_HPP
+
+#include <integrator.hpp>
+#include <vector>
+
+// symplectic schemes built from kicks (v += a h) and drifts (x += v h)
+enum class SymplecticScheme
+{
+    Leapfrog,       // kick-drift-kick, second order. velocity Verlet is the same map
+    PositionVerlet, // drift-kick-drift, second order
+    Yoshida4,       // Forest-Ruth / Yoshida composition of three leapfrog steps, fourth order
+    Yoshida6        // Yoshida's composition of seven leapfrog steps (solution A), sixth order
+};
+
+// fixed step symplectic integrator: a step is a symmetric composition of leapfrog substeps with weights w_k.
+// the half kicks (or drifts) between substeps are merged, and the last one of a step with the first one of the
+// next, so every substep costs exactly one force evaluation, shared by the kick that ends one substep and the
+// kick that starts the next. each kick is fused with the following drift into one pass over the particles.
+class SymplecticIntegrator : public Integrator
+{
+public:
+    // constructor by scheme
+    SymplecticIntegrator(SymplecticScheme scheme = SymplecticScheme::Leapfrog);
+    // advance the system by n_steps steps of dt
+    void integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps) override;
+    // get the scheme
+    SymplecticScheme getScheme() const;
+    // order of accuracy of the scheme
+    int getOrder() const;
+    // the schemes starting with a kick evaluate the forces at the initial and the final positions
+    bool recordsEnergy() const override;
+    // the same schemes end with a force evaluation at the final positions
+    bool leavesAccelerationsCurrent() const override;
+
+private:
+    // v += a * kick, then x += v * drift, for every particle
+    void kickDrift(ParticleSystem &system, double kick, double drift) const;
+
+    SymplecticScheme scheme;
+    // weights of the leapfrog substeps, summing to one
+    std::vector<double> weights;
+    // true if a substep starts and ends with half kicks, false for half drifts
+    bool kick_first;
+};
+
+#endif // SYMPLECTICINTEGRATOR_HPP
@@ -0,0 +1,28 @@
+#ifndef TILEDDIRECTSOLVER_HPP
+#define TILEDDIRECTSOLVER_HPP
+
+#include <forceSolver.hpp>
+
+// all-pairs summation blocked for the cache: the targets are split into blocks handed out to the threads, and
+// each block sweeps the sources tile by tile, so a tile stays in L1/L2 while every target of the block uses it.
+// the tile sizes are tuned once per process by timing candidates on a synthetic system, unless given.
+class TiledDirectSolver : public ForceSolver
+{
+public:
+    // constructor by softening parameter, sources per tile and targets per block (0: tuned)
+    TiledDirectSolver(double epsilon = 0, int source_tile = 0, int target_block = 0);
+    // update the accelerations of all particles in the system
+    void computeAccelerations(ParticleSystem &system) override;
+    // get the number of sources per tile
+    int getSourceTile() const;
+    // get the number of targets per block
+    int getTargetBlock() const;
+    // the fastest tile sizes on this machine, measured on the first call with the active kernel
+    static void tuneTileSizes(int &source_tile, int &target_block);
+
+private:
+    int source_tile;
+    int target_block;
+};
+
+#endif // TILEDDIRECTSOLVER_HPP
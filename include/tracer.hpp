@@ -0,0 +1,71 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <profiler.hpp>
+#include <string>
+#include <vector>
+
+// a timeline of the phases timed by the profiler scopes, per thread, exported in the Chrome trace event format
+// (chrome://tracing, Perfetto). every thread appends to its own ring buffer, allocated on its first event, so
+// recording takes no lock; when a buffer is full the oldest events are overwritten and counted as dropped.
+// force evaluations are sampled: only every sample_interval-th one of a thread is kept, together with the integration
+// and barrier phases that follow it up to the next one, so a sampled window is one (sub)step. the rarer energy, I/O
+// and step phases are always kept. needs the scopes compiled in with NBODY_PROFILE
+class Tracer
+{
+public:
+    // the tracer of the process
+    static Tracer &get();
+    // write the trace to the path given to start, if any
+    ~Tracer();
+    // record from now on, keeping at most capacity events per thread, written to path on exit.
+    // called outside a parallel region
+    void start(const std::string &path, int sample_interval = 1, std::size_t capacity = 1 << 16);
+    // stop recording, the events so far are kept
+    void stop();
+    // whether events are recorded
+    bool isActive() const { return this->active.load(std::memory_order_relaxed); }
+    // add a phase from begin to end on the calling thread
+    void record(ProfilePhase phase, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+    // write the trace event JSON of all threads, called outside a parallel region
+    void writeTrace(std::ostream &out) const;
+    // events kept, and overwritten by newer ones, over all threads
+    long long getRecorded() const;
+    long long getDropped() const;
+
+private:
+    struct Event
+    {
+        ProfilePhase phase;
+        // ns since start
+        long long begin, end;
+    };
+    struct ThreadBuffer
+    {
+        std::vector<Event> events;
+        // events appended so far, the next goes to head % capacity
+        long long head = 0;
+        // force evaluations seen, and whether the current window is sampled
+        long long forces = 0;
+        bool sampled = true;
+    };
+
+    Tracer() = default;
+    // the buffer of the calling thread
+    ThreadBuffer &local();
+
+    std::atomic<bool> active{false};
+    std::string path;
+    int sample_interval = 1;
+    std::size_t capacity = 0;
+    std::chrono::steady_clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+};
+
+#endif // TRACER_HPP
@@ -0,0 +1,87 @@
+#ifndef TRAJECTORYWRITER_HPP
+#define TRAJECTORYWRITER_HPP
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <particleSystem.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// what a trajectory writer does with a snapshot while the previous one is still waiting to be written
+enum class TrajectoryPolicy
+{
+    Block, // wait for the I/O thread, every snapshot is written
+    Drop   // skip the snapshot, the integration never waits
+};
+
+// periodic snapshots of the positions of a system, written to a binary file by a background thread.
+// a snapshot is copied into the front of two buffers and handed over; the I/O thread swaps it to the back, converts
+// it and writes it while the next one is filled, so the stepping only waits (or drops) when the disk falls behind
+// by a whole snapshot.
+// the file starts with a 64 byte header: "NBODYTRJ", the version and the bytes per coordinate (uint32 each), and the
+// number of bodies (uint64). every frame is the step (int64) and the time (double), then the x, y and z
+// coordinates of all bodies in single precision, one block per component
+class TrajectoryWriter
+{
+public:
+    // constructor opening path for a system of n_bodies bodies, snapshots taken every interval steps
+    TrajectoryWriter(const std::string &path, std::size_t n_bodies, int interval, TrajectoryPolicy policy = TrajectoryPolicy::Block);
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+    // close, if not done yet
+    ~TrajectoryWriter();
+    // whether the file could be created
+    bool isOpen() const;
+    // steps between snapshots
+    int getInterval() const;
+    // hand the positions of a system of n_bodies bodies at step and time to the I/O thread, called outside a
+    // parallel region. returns false if the snapshot was dropped, the writer is closed or the system does not hold
+    // n_bodies bodies
+    bool submit(const ParticleSystem &system, long long step, double time);
+    // write the snapshot handed over last and stop the I/O thread. returns whether every frame was written
+    bool close();
+    // frames written, snapshots dropped, and the number and total time (ms) of the waits for the I/O thread,
+    // complete after close
+    long long getWritten() const;
+    long long getDropped() const;
+    long long getStalls() const;
+    double getStallTime() const;
+
+private:
+    // one snapshot, the positions in x, y and z blocks of n_bodies values
+    struct Snapshot
+    {
+        long long step = 0;
+        double time = 0;
+        std::vector<double> positions;
+    };
+
+    // body of the I/O thread
+    void writeLoop();
+    // convert a snapshot and append it to the file
+    void writeFrame(const Snapshot &snapshot);
+
+    std::size_t n_bodies;
+    int interval;
+    TrajectoryPolicy policy;
+    std::ofstream file;
+    // filled by submit, and written by the I/O thread
+    Snapshot front, back;
+    std::vector<float> frame;
+    // front holds a snapshot not yet taken by the I/O thread
+    bool pending = false;
+    bool closing = false;
+    bool opened = false;
+    bool failed = false;
+    long long written = 0;
+    long long dropped = 0;
+    long long stalls = 0;
+    double stall_time = 0;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::thread thread;
+};
+
+#endif // TRAJECTORYWRITER_HPP
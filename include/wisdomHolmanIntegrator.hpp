@@ -0,0 +1,45 @@
+#ifndef WISDOMHOLMANINTEGRATOR_HPP
+#define WISDOMHOLMANINTEGRATOR_HPP
+
+#include <integrator.hpp>
+
+// Wisdom-Holman symplectic mapping in democratic heliocentric coordinates, for systems dominated by a central
+// body, the first particle of the system (the Sun of both generators).
+// the planets keep heliocentric positions and barycentric velocities. a step is a half kick by the
+// planet-planet interactions, a half jump by the motion of the central body, an exact Kepler drift of every planet
+// about the central mass, another half jump and another half kick. steps of about a twentieth of the innermost
+// orbit keep the energy error bounded. the interactions are computed by the force solver on the planets alone.
+class WisdomHolmanIntegrator : public Integrator
+{
+public:
+    // advance the system by n_steps steps of dt
+    void integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps) override;
+    // the heliocentric state and the interactions of the final positions are kept for a call that continues
+    bool leavesAccelerationsCurrent() const override;
+    // forget the heliocentric state, the next call converts the system again
+    void clearState() override;
+
+private:
+    // v += a * h for every planet
+    void kick(double h);
+    // x += h * (total momentum of the planets) / central mass for every planet
+    void jump(double h);
+    // Kepler drift of every planet by h
+    void drift(double h);
+
+    // heliocentric positions, barycentric velocities and interaction accelerations of the planets
+    ParticleSystem planets;
+    double central_mass;
+    // centre of mass and its velocity
+    double cm_x, cm_y, cm_z, cm_vx, cm_vy, cm_vz;
+    // displacement of the jump, shared by all planets
+    double jump_x, jump_y, jump_z;
+    // steps of last_dt since the centre of mass was taken, the half kick of the last step applied to the system
+    // but not yet to the planets, and whether there is a state to continue
+    long long elapsed_steps = 0;
+    double last_dt = 0;
+    double owed_kick = 0;
+    bool resumable = false;
+};
+
+#endif // WISDOMHOLMANINTEGRATOR_HPP
@@ -0,0 +1,114 @@
+#include "barnesHutSolver.hpp"
+#include "profiler.hpp"
+#include "morton.hpp"
+#include <cmath>
+
+namespace
+{
+    // whether a point lies in the cube of a cell. for theta above 1/sqrt(3) the centre of mass of a cell can pass
+    // the opening test from a target inside it, which would then feel its own mass
+    bool contains(const OctreeNode &node, double x, double y, double z)
+    {
+        const double half = node.size / 2;
+        return std::abs(x - node.cx) <= half && std::abs(y - node.cy) <= half && std::abs(z - node.cz) <= half;
+    }
+}
+
+BarnesHutSolver::BarnesHutSolver(double epsilon, double theta, int leaf_size) : ForceSolver(epsilon), theta{theta}, tree(leaf_size)
+{
+}
+
+double BarnesHutSolver::getTheta() const
+{
+    return this->theta;
+}
+
+const Octree &BarnesHutSolver::getTree() const
+{
+    return this->tree;
+}
+
+void BarnesHutSolver::walk(double x, double y, double z, double &acc_x, double &acc_y, double &acc_z) const
+{
+    const double epsilon2 = this->epsilon * this->epsilon;
+    const double theta2 = this->theta * this->theta;
+    const std::vector<OctreeNode> &nodes = this->tree.getNodes();
+    const double *m = this->tree.masses(), *px = this->tree.x(), *py = this->tree.y(), *pz = this->tree.z();
+    // at most 8 children are pushed per level
+    int stack[8 * (MORTON_BITS + 1)];
+    int top = 0;
+    stack[top++] = 0;
+    acc_x = acc_y = acc_z = 0;
+    while (top > 0)
+    {
+        const OctreeNode &node = nodes[stack[--top]];
+        double dx = node.x - x;
+        double dy = node.y - y;
+        double dz = node.z - z;
+        double d2 = dx * dx + dy * dy + dz * dz;
+        if (node.first_child < 0)
+        {
+            // leaf: sum its particles directly
+            for (int p = node.begin; p < node.end; p++)
+            {
+                double rx = px[p] - x;
+                double ry = py[p] - y;
+                double rz = pz[p] - z;
+                double r2 = rx * rx + ry * ry + rz * rz + epsilon2;
+                if (r2 > 0)
+                {
+                    double factor = m[p] / (r2 * std::sqrt(r2));
+                    acc_x += factor * rx;
+                    acc_y += factor * ry;
+                    acc_z += factor * rz;
+                }
+            }
+        }
+        else if (node.size * node.size < theta2 * d2 && !contains(node, x, y, z))
+        {
+            // far enough away: the cell acts as a point mass
+            double r2 = d2 + epsilon2;
+            double factor = node.mass / (r2 * std::sqrt(r2));
+            acc_x += factor * dx;
+            acc_y += factor * dy;
+            acc_z += factor * dz;
+        }
+        else
+        {
+            for (int c = node.first_child; c < node.first_child + node.n_children; c++)
+            {
+                stack[top++] = c;
+            }
+        }
+    }
+}
+
+void BarnesHutSolver::computeAccelerations(ParticleSystem &system)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+    this->tree.build(system);
+    // walk the tree for every target, in Morton order so neighbouring targets share most of their walk
+    const int n_particles = this->tree.size();
+    const double *x = this->tree.x(), *y = this->tree.y(), *z = this->tree.z();
+    double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    #pragma omp for schedule(dynamic, 64)
+    for (int s = 0; s < n_particles; s++)
+    {
+        int i = this->tree.getIndex(s);
+        this->walk(x[s], y[s], z[s], ax[i], ay[i], az[i]);
+    }
+}
+
+void BarnesHutSolver::computeActiveAccelerations(ParticleSystem &system, const std::vector<int> &active)
+{
+    this->tree.build(system);
+    const int n_active = active.size();
+    const double *x = system.x(), *y = system.y(), *z = system.z();
+    double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    #pragma omp for schedule(dynamic, 64)
+    for (int a = 0; a < n_active; a++)
+    {
+        const int i = active[a];
+        this->walk(x[i], y[i], z[i], ax[i], ay[i], az[i]);
+    }
+}
@@ -0,0 +1,145 @@
+#include "blockTimestepIntegrator.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+BlockTimestepIntegrator::BlockTimestepIntegrator(int max_level, double eta) : max_level{std::clamp(max_level, 0, 30)}, eta{eta}
+{
+}
+
+int BlockTimestepIntegrator::getMaxLevel() const
+{
+    return this->max_level;
+}
+
+double BlockTimestepIntegrator::getEta() const
+{
+    return this->eta;
+}
+
+const std::vector<int> &BlockTimestepIntegrator::getLevels() const
+{
+    return this->levels;
+}
+
+int BlockTimestepIntegrator::chooseLevel(const ParticleSystem &system, int i, double dt) const
+{
+    const double v2 = system.vx()[i] * system.vx()[i] + system.vy()[i] * system.vy()[i] + system.vz()[i] * system.vz()[i];
+    const double a2 = system.ax()[i] * system.ax()[i] + system.ay()[i] * system.ay()[i] + system.az()[i] * system.az()[i];
+    if (a2 == 0)
+    {
+        return 0;
+    }
+    // a particle at rest but accelerated, like a Sun starting at the origin, starts on the finest level
+    const double timescale = this->eta * std::sqrt(v2 / a2);
+    if (timescale <= 0)
+    {
+        return this->max_level;
+    }
+    const int level = static_cast<int>(std::ceil(std::log2(dt / timescale)));
+    return std::clamp(level, 0, this->max_level);
+}
+
+void BlockTimestepIntegrator::integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps)
+{
+    const int n_particles = system.size();
+    const int max_level = this->max_level;
+    const long long end_tick = static_cast<long long>(n_steps) << max_level;
+    const double tick = std::ldexp(dt, -max_level);
+    double *x = system.x(), *y = system.y(), *z = system.z();
+    double *vx = system.vx(), *vy = system.vy(), *vz = system.vz();
+    const double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    // v += a * h for the i-th particle
+    auto kick = [&](int i, double h) {
+        vx[i] += ax[i] * h;
+        vy[i] += ay[i] * h;
+        vz[i] += az[i] * h;
+    };
+    #pragma omp single
+    {
+        this->levels.assign(n_particles, 0);
+        this->active.resize(n_particles);
+        for (int i = 0; i < n_particles; i++)
+        {
+            this->active[i] = i;
+        }
+        this->force_evaluations = this->accelerations_current ? 0 : n_particles;
+    }
+    // opening half kick of every particle with its first step, from the accelerations left by the previous call if
+    // they are current
+    if (!this->accelerations_current)
+    {
+        solver.computeAccelerations(system);
+        NBODY_BARRIER();
+    }
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n_particles; i++)
+    {
+        this->levels[i] = this->chooseLevel(system, i, dt);
+        kick(i, 0.5 * std::ldexp(dt, -this->levels[i]));
+    }
+    long long current_tick = 0;
+    while (current_tick < end_tick)
+    {
+        #pragma omp single
+        {
+            // the finest occupied level decides when the next particles are due
+            const int finest = n_particles > 0 ? *std::max_element(this->levels.begin(), this->levels.end()) : 0;
+            const long long finest_ticks = 1LL << (max_level - finest);
+            this->next_tick = (current_tick / finest_ticks + 1) * finest_ticks;
+            // the levels due at the next tick are those whose step divides it
+            int due_level = max_level;
+            while (due_level > 0 && this->next_tick % (1LL << (max_level - due_level + 1)) == 0)
+            {
+                due_level--;
+            }
+            this->active.clear();
+            for (int i = 0; i < n_particles; i++)
+            {
+                if (this->levels[i] >= due_level)
+                {
+                    this->active.push_back(i);
+                }
+            }
+            this->force_evaluations += this->active.size();
+        }
+        const long long target_tick = this->next_tick;
+        // drift everyone to the next time some level is due
+        const double drift = tick * (target_tick - current_tick);
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n_particles; i++)
+        {
+            x[i] += vx[i] * drift;
+            y[i] += vy[i] * drift;
+            z[i] += vz[i] * drift;
+        }
+        solver.computeActiveAccelerations(system, this->active);
+        NBODY_BARRIER();
+        // closing half kick of the finished step, then opening half kick of the next one on the new level
+        const int n_active = this->active.size();
+        #pragma omp for schedule(static)
+        for (int a = 0; a < n_active; a++)
+        {
+            const int i = this->active[a];
+            const int level = this->levels[i];
+            kick(i, 0.5 * std::ldexp(dt, -level));
+            if (target_tick < end_tick)
+            {
+                int new_level = this->chooseLevel(system, i, dt);
+                if (new_level < level && target_tick % (1LL << max_level) != 0)
+                {
+                    // within a base step coarser only one level at a time, and only when that level is due as well
+                    new_level = target_tick % (1LL << (max_level - level + 1)) == 0 ? level - 1 : level;
+                }
+                this->levels[i] = new_level;
+                kick(i, 0.5 * std::ldexp(dt, -new_level));
+            }
+        }
+        current_tick = target_tick;
+    }
+}
+
+bool BlockTimestepIntegrator::leavesAccelerationsCurrent() const
+{
+    return true;
+}
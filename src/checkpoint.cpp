@@ -0,0 +1,312 @@
+#include "checkpoint.hpp"
+#include "profiler.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr char MAGIC[8] = {'N', 'B', 'O', 'D', 'Y', 'C', 'K', 'P'};
+    // read back differently by a machine of the other byte order
+    constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr int NAME_LENGTH = 32;
+
+    // the fixed header at the start of a checkpoint, padded to a cache line multiple so that the arrays after it
+    // stay aligned in the mapping
+    struct alignas(64) Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;
+        std::uint64_t header_size;
+        std::uint64_t n_particles;
+        std::uint64_t stride;
+        double dt;
+        double epoch;
+        double epsilon;
+        double initial_energy;
+        std::int64_t epoch_steps;
+        std::int64_t steps;
+        std::int64_t force_evaluations;
+        std::int64_t target_steps;
+        std::int32_t seed;
+        std::int32_t interval;
+        std::int32_t accelerations_current;
+        char task[NAME_LENGTH];
+        char solver[NAME_LENGTH];
+        char integrator[NAME_LENGTH];
+        double theta;
+        double eta;
+        double tolerance;
+        std::int32_t order;
+        std::int32_t grid_size;
+        std::int32_t max_level;
+        char assignment[NAME_LENGTH];
+        char simd[NAME_LENGTH];
+    };
+
+    // masses, positions, velocities, accelerations and potentials, then the ids, each stride entries per block
+    constexpr int DOUBLE_BLOCKS = 11;
+
+    std::uint64_t fileSize(std::uint64_t stride)
+    {
+        return sizeof(Header) + stride * (DOUBLE_BLOCKS * sizeof(double) + sizeof(int));
+    }
+
+    void copyName(char (&field)[NAME_LENGTH], const std::string &name)
+    {
+        std::strncpy(field, name.c_str(), NAME_LENGTH - 1);
+        field[NAME_LENGTH - 1] = '\0';
+    }
+
+    std::string readName(const char (&field)[NAME_LENGTH])
+    {
+        return std::string(field, strnlen(field, NAME_LENGTH));
+    }
+
+    // write all bytes, retrying short writes
+    bool writeAll(int fd, const void *data, std::size_t bytes)
+    {
+        const char *p = static_cast<const char *>(data);
+        while (bytes > 0)
+        {
+            ssize_t written = ::write(fd, p, bytes);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            p += written;
+            bytes -= written;
+        }
+        return true;
+    }
+
+    // whether the ids of a file are a permutation of 0..n_particles-1 followed by -1 up to stride, as the sorter and
+    // the copies back into particle lists index with them
+    bool validIds(const int *ids, std::uint64_t n_particles, std::uint64_t stride)
+    {
+        if (n_particles > static_cast<std::uint64_t>(std::numeric_limits<int>::max()))
+        {
+            return false;
+        }
+        std::vector<bool> seen(n_particles, false);
+        for (std::uint64_t i = 0; i < n_particles; i++)
+        {
+            if (ids[i] < 0 || static_cast<std::uint64_t>(ids[i]) >= n_particles || seen[ids[i]])
+            {
+                return false;
+            }
+            seen[ids[i]] = true;
+        }
+        for (std::uint64_t i = n_particles; i < stride; i++)
+        {
+            if (ids[i] != -1)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool writeCheckpoint(const std::string &path, const Simulator &simulator, const CheckpointInfo &info, std::string &error)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::IO);
+    const ParticleSystem &system = simulator.getSystem();
+    const SimulatorProgress &progress = simulator.getProgress();
+    const std::size_t stride = system.stride();
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.header_size = sizeof(Header);
+    header.n_particles = system.size();
+    header.stride = stride;
+    header.dt = simulator.getDt();
+    header.epoch = progress.epoch;
+    header.epsilon = info.epsilon;
+    header.initial_energy = info.initial_energy;
+    header.epoch_steps = progress.epoch_steps;
+    header.steps = progress.steps;
+    header.force_evaluations = progress.force_evaluations;
+    header.target_steps = info.target_steps;
+    header.seed = info.seed;
+    header.interval = info.interval;
+    header.accelerations_current = progress.accelerations_current;
+    copyName(header.task, info.task);
+    copyName(header.solver, info.solver);
+    copyName(header.integrator, info.integrator);
+    header.theta = info.theta;
+    header.eta = info.eta;
+    header.tolerance = info.tolerance;
+    header.order = info.order;
+    header.grid_size = info.grid_size;
+    header.max_level = info.max_level;
+    copyName(header.assignment, info.assignment);
+    copyName(header.simd, info.simd);
+
+    const std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        error = "cannot create " + temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    // the padding entries of the system are zero, so each array goes out in one piece
+    bool written = writeAll(fd, &header, sizeof(Header))
+                   && writeAll(fd, system.masses(), stride * sizeof(double))
+                   && writeAll(fd, system.x(), 3 * stride * sizeof(double))
+                   && writeAll(fd, system.vx(), 3 * stride * sizeof(double))
+                   && writeAll(fd, system.ax(), 3 * stride * sizeof(double))
+                   && writeAll(fd, system.potentials(), stride * sizeof(double))
+                   && writeAll(fd, system.ids(), stride * sizeof(int))
+                   && ::fsync(fd) == 0;
+    if (!written)
+    {
+        error = "cannot write " + temporary + ": " + std::strerror(errno);
+    }
+    if (::close(fd) != 0 && written)
+    {
+        error = "cannot write " + temporary + ": " + std::strerror(errno);
+        written = false;
+    }
+    if (!written)
+    {
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    if (::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        error = "cannot rename " + temporary + " to " + path + ": " + std::strerror(errno);
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    // the rename is only durable once the directory holding the entry is synced as well
+    const std::size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (directory_fd < 0)
+    {
+        error = "cannot open " + directory + ": " + std::strerror(errno);
+        return false;
+    }
+    if (::fsync(directory_fd) != 0)
+    {
+        error = "cannot sync " + directory + ": " + std::strerror(errno);
+        ::close(directory_fd);
+        return false;
+    }
+    ::close(directory_fd);
+    return true;
+}
+
+bool readCheckpoint(const std::string &path, ParticleSystem &system, double &dt, SimulatorProgress &progress, CheckpointInfo &info, std::string &error)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::IO);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<std::uint64_t>(status.st_size) < sizeof(Header))
+    {
+        error = path + " is not a checkpoint";
+        ::close(fd);
+        return false;
+    }
+    const std::size_t length = status.st_size;
+    // the arrays are read once, front to back, so the whole file is faulted in with the mapping
+    void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    const char *bytes = static_cast<const char *>(mapping);
+    Header header;
+    std::memcpy(&header, bytes, sizeof(Header));
+    std::string problem;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        problem = path + " is not a checkpoint";
+    }
+    else if (header.byte_order != BYTE_ORDER_MARK)
+    {
+        problem = path + " was written on a machine of another byte order";
+    }
+    else if (header.version != CHECKPOINT_VERSION)
+    {
+        problem = path + " is a checkpoint of version " + std::to_string(header.version) + ", version " + std::to_string(CHECKPOINT_VERSION) + " is expected";
+    }
+    else if (header.header_size != sizeof(Header) || header.stride < header.n_particles || header.stride % 8 != 0 || length != fileSize(header.stride))
+    {
+        problem = path + " is truncated or corrupt";
+    }
+    else if (!validIds(reinterpret_cast<const int *>(bytes + sizeof(Header) + DOUBLE_BLOCKS * header.stride * sizeof(double)), header.n_particles, header.stride))
+    {
+        problem = path + " is truncated or corrupt";
+    }
+    if (!problem.empty())
+    {
+        error = problem;
+        ::munmap(mapping, length);
+        return false;
+    }
+
+    const std::size_t n_particles = header.n_particles, stride = header.stride;
+    ParticleSystem loaded(n_particles);
+    const double *blocks = reinterpret_cast<const double *>(bytes + sizeof(Header));
+    // block k of the file is stride values long, that of the system loaded.stride()
+    auto copy = [&](double *target, int first_block, int n_blocks) {
+        for (int k = 0; k < n_blocks; k++)
+        {
+            std::memcpy(target + k * loaded.stride(), blocks + (first_block + k) * stride, n_particles * sizeof(double));
+        }
+    };
+    copy(loaded.masses(), 0, 1);
+    copy(loaded.x(), 1, 3);
+    copy(loaded.vx(), 4, 3);
+    copy(loaded.ax(), 7, 3);
+    copy(loaded.potentials(), 10, 1);
+    std::memcpy(loaded.ids(), blocks + DOUBLE_BLOCKS * stride, n_particles * sizeof(int));
+    ::munmap(mapping, length);
+
+    system = std::move(loaded);
+    dt = header.dt;
+    progress.epoch = header.epoch;
+    progress.epoch_steps = header.epoch_steps;
+    progress.steps = header.steps;
+    progress.force_evaluations = header.force_evaluations;
+    progress.accelerations_current = header.accelerations_current != 0;
+    info.task = readName(header.task);
+    info.solver = readName(header.solver);
+    info.integrator = readName(header.integrator);
+    info.seed = header.seed;
+    info.epsilon = header.epsilon;
+    info.target_steps = header.target_steps;
+    info.interval = header.interval;
+    info.initial_energy = header.initial_energy;
+    info.theta = header.theta;
+    info.order = header.order;
+    info.grid_size = header.grid_size;
+    info.assignment = readName(header.assignment);
+    info.max_level = header.max_level;
+    info.eta = header.eta;
+    info.tolerance = header.tolerance;
+    info.simd = readName(header.simd);
+    return true;
+}
@@ -0,0 +1,52 @@
+#include "directSolver.hpp"
+#include "profiler.hpp"
+#include "gravityKernel.hpp"
+#include <omp.h>
+
+DirectSolver::DirectSolver(double epsilon) : ForceSolver(epsilon)
+{
+}
+
+void DirectSolver::computeAccelerations(ParticleSystem &system)
+{
+    const int n_particles = system.size();
+    const double epsilon2 = this->epsilon * this->epsilon;
+    GravityKernel kernel = getGravityKernel();
+    double *phi = this->getComputePotential() ? system.potentials() : nullptr;
+    NBODY_PROFILE_INTERACTIONS(static_cast<long long>(n_particles) * (n_particles - 1));
+    if (omp_get_num_threads() == 1)
+    {
+        // one call for all targets, the loop scheduling would cost more than the forces of a small system
+        NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+        kernel(system.masses(), system.x(), system.y(), system.z(), system.stride(), epsilon2, 0, n_particles, system.ax(), system.ay(), system.az(), phi);
+        return;
+    }
+    {
+        NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+        #pragma omp for schedule(runtime) nowait
+        for (int i = 0; i < n_particles; i++)
+        {
+            kernel(system.masses(), system.x(), system.y(), system.z(), system.stride(), epsilon2, i, i + 1, system.ax(), system.ay(), system.az(), phi);
+        }
+    }
+    // the barrier of the loop, timed apart from the forces
+    NBODY_BARRIER();
+}
+
+bool DirectSolver::supportsPotential() const
+{
+    return true;
+}
+
+void DirectSolver::computeActiveAccelerations(ParticleSystem &system, const std::vector<int> &active)
+{
+    const int n_active = active.size();
+    const double epsilon2 = this->epsilon * this->epsilon;
+    GravityKernel kernel = getGravityKernel();
+    #pragma omp for schedule(runtime)
+    for (int a = 0; a < n_active; a++)
+    {
+        const int i = active[a];
+        kernel(system.masses(), system.x(), system.y(), system.z(), system.stride(), epsilon2, i, i + 1, system.ax(), system.ay(), system.az(), nullptr);
+    }
+}
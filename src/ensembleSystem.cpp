@@ -0,0 +1,162 @@
+#include "ensembleSystem.hpp"
+#include <cmath>
+
+EnsembleSystem::EnsembleSystem(const std::vector<ParticleSystem> &systems, double epsilon)
+    : n_systems{static_cast<int>(systems.size())}, n_bodies{systems.empty() ? 0 : static_cast<int>(systems[0].size())},
+      n_batches{(n_systems + ENSEMBLE_LANES - 1) / ENSEMBLE_LANES}, epsilon2{epsilon * epsilon}, kernel{getEnsembleKernel()}
+{
+    const std::size_t length = static_cast<std::size_t>(this->n_bodies) * ENSEMBLE_LANES;
+    this->mass.assign(this->n_batches * length, 0.0);
+    this->position.assign(3 * this->n_batches * length, 0.0);
+    this->velocity.assign(3 * this->n_batches * length, 0.0);
+    this->acceleration.assign(3 * this->n_batches * length, 0.0);
+    for (int k = 0; k < this->n_systems; k++)
+    {
+        const ParticleSystem &system = systems[k];
+        const std::size_t batch = k / ENSEMBLE_LANES, lane = k % ENSEMBLE_LANES;
+        for (int i = 0; i < this->n_bodies; i++)
+        {
+            const std::size_t slot = i * ENSEMBLE_LANES + lane;
+            this->mass[batch * length + slot] = system.masses()[i];
+            for (int d = 0; d < 3; d++)
+            {
+                this->position[(3 * batch + d) * length + slot] = system.x()[d * system.stride() + i];
+                this->velocity[(3 * batch + d) * length + slot] = system.vx()[d * system.stride() + i];
+            }
+        }
+    }
+}
+
+int EnsembleSystem::size() const
+{
+    return this->n_systems;
+}
+
+int EnsembleSystem::getBodies() const
+{
+    return this->n_bodies;
+}
+
+void EnsembleSystem::computeAccelerations(int batch)
+{
+    const std::size_t length = static_cast<std::size_t>(this->n_bodies) * ENSEMBLE_LANES;
+    const double *m = this->mass.data() + batch * length;
+    const double *x = this->position.data() + 3 * batch * length;
+    double *a = this->acceleration.data() + 3 * batch * length;
+    this->kernel(m, x, x + length, x + 2 * length, this->n_bodies, this->epsilon2, a, a + length, a + 2 * length);
+}
+
+void EnsembleSystem::kickDrift(int batch, double kick, double drift, bool drift_first)
+{
+    // positions, velocities and accelerations of a batch are looped over as flat arrays of all three blocks
+    const std::size_t length = 3 * static_cast<std::size_t>(this->n_bodies) * ENSEMBLE_LANES;
+    double *x = this->position.data() + batch * length;
+    double *v = this->velocity.data() + batch * length;
+    const double *a = this->acceleration.data() + batch * length;
+    if (drift_first)
+    {
+        #pragma omp simd
+        for (std::size_t k = 0; k < length; k++)
+        {
+            x[k] += v[k] * drift;
+            v[k] += a[k] * kick;
+        }
+    }
+    else
+    {
+        #pragma omp simd
+        for (std::size_t k = 0; k < length; k++)
+        {
+            v[k] += a[k] * kick;
+            x[k] += v[k] * drift;
+        }
+    }
+}
+
+void EnsembleSystem::integrateBatch(int batch, EnsembleScheme scheme, double dt, int n_steps)
+{
+    if (scheme == EnsembleScheme::Euler)
+    {
+        for (int n = 0; n < n_steps; n++)
+        {
+            this->computeAccelerations(batch);
+            this->kickDrift(batch, dt, dt, true);
+        }
+        return;
+    }
+    if (n_steps <= 0)
+    {
+        return;
+    }
+    // K D K ... K D K, the closing half kick of a step merged with the opening one of the next
+    this->computeAccelerations(batch);
+    for (int n = 0; n < n_steps; n++)
+    {
+        this->kickDrift(batch, n > 0 ? dt : 0.5 * dt, dt, false);
+        this->computeAccelerations(batch);
+    }
+    this->kickDrift(batch, 0.5 * dt, 0, false);
+}
+
+void EnsembleSystem::integrate(EnsembleScheme scheme, double dt, int n_steps)
+{
+    // each batch runs all its steps without synchronising with the others
+    #pragma omp for schedule(dynamic)
+    for (int batch = 0; batch < this->n_batches; batch++)
+    {
+        this->integrateBatch(batch, scheme, dt, n_steps);
+    }
+}
+
+std::vector<double> EnsembleSystem::calTotalEnergies() const
+{
+    const std::size_t length = static_cast<std::size_t>(this->n_bodies) * ENSEMBLE_LANES;
+    std::vector<double> energies(this->n_batches * ENSEMBLE_LANES, 0.0);
+    for (int batch = 0; batch < this->n_batches; batch++)
+    {
+        const double *m = this->mass.data() + batch * length;
+        const double *x = this->position.data() + 3 * batch * length, *y = x + length, *z = x + 2 * length;
+        const double *vx = this->velocity.data() + 3 * batch * length, *vy = vx + length, *vz = vx + 2 * length;
+        double *energy = energies.data() + batch * ENSEMBLE_LANES;
+        for (std::size_t i = 0; i < length; i += ENSEMBLE_LANES)
+        {
+            #pragma omp simd
+            for (int k = 0; k < ENSEMBLE_LANES; k++)
+            {
+                energy[k] += 0.5 * m[i + k] * (vx[i + k] * vx[i + k] + vy[i + k] * vy[i + k] + vz[i + k] * vz[i + k]);
+            }
+            for (std::size_t j = i + ENSEMBLE_LANES; j < length; j += ENSEMBLE_LANES)
+            {
+                #pragma omp simd
+                for (int k = 0; k < ENSEMBLE_LANES; k++)
+                {
+                    double dx = x[j + k] - x[i + k];
+                    double dy = y[j + k] - y[i + k];
+                    double dz = z[j + k] - z[i + k];
+                    double r2 = dx * dx + dy * dy + dz * dz + this->epsilon2;
+                    // the padding bodies are massless, skip their zero distances
+                    energy[k] -= r2 > 0 ? m[i + k] * m[j + k] / std::sqrt(r2) : 0.0;
+                }
+            }
+        }
+    }
+    energies.resize(this->n_systems);
+    return energies;
+}
+
+ParticleSystem EnsembleSystem::getSystem(int k) const
+{
+    const std::size_t length = static_cast<std::size_t>(this->n_bodies) * ENSEMBLE_LANES;
+    const std::size_t batch = k / ENSEMBLE_LANES, lane = k % ENSEMBLE_LANES;
+    ParticleSystem system;
+    system.reserve(this->n_bodies);
+    for (int i = 0; i < this->n_bodies; i++)
+    {
+        const std::size_t slot = i * ENSEMBLE_LANES + lane;
+        auto vector = [&](const AlignedVector<double> &values) {
+            return Eigen::Vector3d(values[3 * batch * length + slot], values[(3 * batch + 1) * length + slot], values[(3 * batch + 2) * length + slot]);
+        };
+        system.addParticle(this->mass[batch * length + slot], vector(this->position), vector(this->velocity), vector(this->acceleration));
+    }
+    return system;
+}
@@ -0,0 +1,29 @@
+#include "eulerIntegrator.hpp"
+#include "profiler.hpp"
+
+void EulerIntegrator::integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps)
+{
+    const int n_particles = system.size();
+    // positions, velocities and accelerations are looped over as flat arrays of all three blocks, the padding is zero
+    const int length = 3 * system.stride();
+    double *x = system.x(), *v = system.vx();
+    const double *a = system.ax();
+    #pragma omp single
+    this->force_evaluations = static_cast<long long>(n_particles) * n_steps;
+    for (int n = 0; n < n_steps; n++)
+    {
+        // update the gravitational acceleration of each body, complete on every thread when the call returns
+        solver.computeAccelerations(system);
+        // update the position and velocity of each body, the barrier keeps the next forces waiting
+        {
+            NBODY_PROFILE_SCOPE(ProfilePhase::Integration);
+            #pragma omp for schedule(static) nowait
+            for (int k = 0; k < length; k++)
+            {
+                x[k] += v[k] * dt;
+                v[k] += a[k] * dt;
+            }
+        }
+        NBODY_BARRIER();
+    }
+}
@@ -0,0 +1,104 @@
+#include "fft.hpp"
+#include <cmath>
+#include <utility>
+
+int nextPowerOfTwo(int n)
+{
+    int power = 1;
+    while (power < n)
+    {
+        power *= 2;
+    }
+    return power;
+}
+
+Fft3d::Fft3d(int n) : n{nextPowerOfTwo(n)}
+{
+    int bits = 0;
+    while ((1 << bits) < this->n)
+    {
+        bits++;
+    }
+    this->bit_reverse.resize(this->n);
+    for (int i = 0; i < this->n; i++)
+    {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++)
+        {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        this->bit_reverse[i] = reversed;
+    }
+    for (int k = 0; k < this->n / 2; k++)
+    {
+        this->twiddles.push_back(std::polar(1.0, -2 * M_PI * k / this->n));
+    }
+}
+
+int Fft3d::size() const
+{
+    return this->n;
+}
+
+void Fft3d::transformLine(std::complex<double> *line, bool inverse) const
+{
+    for (int i = 0; i < this->n; i++)
+    {
+        if (i < this->bit_reverse[i])
+        {
+            std::swap(line[i], line[this->bit_reverse[i]]);
+        }
+    }
+    // iterative Cooley-Tukey butterflies
+    for (int length = 2; length <= this->n; length *= 2)
+    {
+        const int half = length / 2;
+        const int step = this->n / length;
+        for (int start = 0; start < this->n; start += length)
+        {
+            for (int k = 0; k < half; k++)
+            {
+                std::complex<double> twiddle = inverse ? std::conj(this->twiddles[k * step]) : this->twiddles[k * step];
+                std::complex<double> odd = twiddle * line[start + k + half];
+                line[start + k + half] = line[start + k] - odd;
+                line[start + k] += odd;
+            }
+        }
+    }
+    if (inverse)
+    {
+        const double scale = 1.0 / this->n;
+        for (int i = 0; i < this->n; i++)
+        {
+            line[i] *= scale;
+        }
+    }
+}
+
+void Fft3d::transform(std::complex<double> *data, bool inverse) const
+{
+    const int n = this->n;
+    const int n_lines = n * n;
+    std::vector<std::complex<double>> line(n);
+    // along k (contiguous), then j, then i, gathering each line into a contiguous buffer
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const int stride = axis == 0 ? 1 : (axis == 1 ? n : n * n);
+        #pragma omp for schedule(static)
+        for (int l = 0; l < n_lines; l++)
+        {
+            // first element of the line: the two other indices come from l
+            int outer = l / n, inner = l % n;
+            int first = axis == 0 ? l * n : (axis == 1 ? outer * n * n + inner : outer * n + inner);
+            for (int e = 0; e < n; e++)
+            {
+                line[e] = data[first + e * stride];
+            }
+            this->transformLine(line.data(), inverse);
+            for (int e = 0; e < n; e++)
+            {
+                data[first + e * stride] = line[e];
+            }
+        }
+    }
+}
@@ -0,0 +1,385 @@
+#include "fmmSolver.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    double binomial(int n, int k)
+    {
+        double value = 1;
+        for (int i = 1; i <= k; i++)
+        {
+            value = value * (n - k + i) / i;
+        }
+        return value;
+    }
+}
+
+FmmSolver::FmmSolver(double epsilon, int order, double theta, int leaf_size) : ForceSolver(epsilon), order{std::max(order, 0)}, theta{theta}, tree(leaf_size)
+{
+    const int p = this->order;
+    // multi-indices by increasing degree, so every term comes after the terms it is computed from
+    this->term_lookup.assign((p + 1) * (p + 1) * (p + 1), -1);
+    for (int n = 0; n <= p; n++)
+    {
+        for (int i = n; i >= 0; i--)
+        {
+            for (int j = n - i; j >= 0; j--)
+            {
+                this->term_lookup[(i * (p + 1) + j) * (p + 1) + (n - i - j)] = this->terms.size();
+                this->terms.push_back({i, j, n - i - j});
+            }
+        }
+    }
+    const int n_terms = this->terms.size();
+    for (int t = 0; t < n_terms; t++)
+    {
+        const std::array<int, 3> &alpha = this->terms[t];
+        int dim = alpha[0] > 0 ? 0 : (alpha[1] > 0 ? 1 : 2);
+        std::array<int, 3> lower = alpha;
+        lower[dim]--;
+        this->lower_dim.push_back(dim);
+        this->lower_term.push_back(t == 0 ? -1 : this->termIndex(lower[0], lower[1], lower[2]));
+        std::array<int, 3> one{-1, -1, -1}, two{-1, -1, -1};
+        for (int k = 0; k < 3; k++)
+        {
+            std::array<int, 3> beta = alpha;
+            if (alpha[k] >= 1)
+            {
+                beta[k] -= 1;
+                one[k] = this->termIndex(beta[0], beta[1], beta[2]);
+            }
+            if (alpha[k] >= 2)
+            {
+                beta[k] -= 1;
+                two[k] = this->termIndex(beta[0], beta[1], beta[2]);
+            }
+        }
+        this->minus_one.push_back(one);
+        this->minus_two.push_back(two);
+    }
+    // M2M: Q'[alpha] += C(alpha, beta) Q[beta] d^(alpha - beta)
+    // L2L: L'[beta] += C(gamma, beta) L[gamma] d^(gamma - beta)
+    // M2L: L[beta] += (-1)^|alpha| C(alpha + beta, beta) Q[alpha] T[alpha + beta]
+    for (int a = 0; a < n_terms; a++)
+    {
+        const std::array<int, 3> &alpha = this->terms[a];
+        for (int b = 0; b < n_terms; b++)
+        {
+            const std::array<int, 3> &beta = this->terms[b];
+            if (beta[0] <= alpha[0] && beta[1] <= alpha[1] && beta[2] <= alpha[2])
+            {
+                double coefficient = binomial(alpha[0], beta[0]) * binomial(alpha[1], beta[1]) * binomial(alpha[2], beta[2]);
+                int difference = this->termIndex(alpha[0] - beta[0], alpha[1] - beta[1], alpha[2] - beta[2]);
+                this->m2m_table.push_back({a, b, difference, coefficient});
+                this->l2l_table.push_back({b, a, difference, coefficient});
+            }
+            int degree = alpha[0] + alpha[1] + alpha[2] + beta[0] + beta[1] + beta[2];
+            if (degree <= p)
+            {
+                double sign = (alpha[0] + alpha[1] + alpha[2]) % 2 == 0 ? 1 : -1;
+                double coefficient = binomial(alpha[0] + beta[0], beta[0]) * binomial(alpha[1] + beta[1], beta[1]) * binomial(alpha[2] + beta[2], beta[2]);
+                this->m2l_table.push_back({b, a, this->termIndex(alpha[0] + beta[0], alpha[1] + beta[1], alpha[2] + beta[2]), sign * coefficient});
+            }
+        }
+        // gradient of the local expansion: d/dh_k h^alpha = alpha_k h^(alpha - e_k)
+        for (int dim = 0; dim < 3; dim++)
+        {
+            if (alpha[dim] > 0)
+            {
+                std::array<int, 3> lower = alpha;
+                lower[dim]--;
+                this->gradient_table.push_back({dim, a, this->termIndex(lower[0], lower[1], lower[2]), static_cast<double>(alpha[dim])});
+            }
+        }
+    }
+}
+
+int FmmSolver::getOrder() const
+{
+    return this->order;
+}
+
+double FmmSolver::getTheta() const
+{
+    return this->theta;
+}
+
+int FmmSolver::termIndex(int i, int j, int k) const
+{
+    const int p = this->order;
+    return this->term_lookup[(i * (p + 1) + j) * (p + 1) + k];
+}
+
+void FmmSolver::calPowers(double dx, double dy, double dz, double *powers) const
+{
+    const double d[3] = {dx, dy, dz};
+    powers[0] = 1;
+    for (std::size_t t = 1; t < this->terms.size(); t++)
+    {
+        powers[t] = powers[this->lower_term[t]] * d[this->lower_dim[t]];
+    }
+}
+
+void FmmSolver::calDerivatives(double dx, double dy, double dz, double *derivatives) const
+{
+    // T_alpha = D^alpha (1/r) / alpha! satisfies
+    // n r^2 T_alpha = -(2n - 1) sum_k d_k T_(alpha - e_k) - (n - 1) sum_k T_(alpha - 2 e_k), n = |alpha|
+    const double d[3] = {dx, dy, dz};
+    const double r2 = dx * dx + dy * dy + dz * dz;
+    derivatives[0] = 1 / std::sqrt(r2);
+    for (std::size_t t = 1; t < this->terms.size(); t++)
+    {
+        const std::array<int, 3> &alpha = this->terms[t];
+        const int n = alpha[0] + alpha[1] + alpha[2];
+        double first(0), second(0);
+        for (int k = 0; k < 3; k++)
+        {
+            if (this->minus_one[t][k] >= 0)
+            {
+                first += d[k] * derivatives[this->minus_one[t][k]];
+            }
+            if (this->minus_two[t][k] >= 0)
+            {
+                second += derivatives[this->minus_two[t][k]];
+            }
+        }
+        derivatives[t] = (-(2 * n - 1) * first - (n - 1) * second) / (n * r2);
+    }
+}
+
+void FmmSolver::upward(int node, Workspace &workspace)
+{
+    const std::vector<OctreeNode> &nodes = this->tree.getNodes();
+    const OctreeNode &cell = nodes[node];
+    const int n_terms = this->terms.size();
+    double *multipole = this->multipoles.data() + node * n_terms;
+    double *powers = workspace.powers.data();
+    if (cell.first_child < 0)
+    {
+        // P2M: Q[alpha] = sum m (y - c)^alpha
+        const double *m = this->tree.masses(), *x = this->tree.x(), *y = this->tree.y(), *z = this->tree.z();
+        for (int p = cell.begin; p < cell.end; p++)
+        {
+            this->calPowers(x[p] - cell.cx, y[p] - cell.cy, z[p] - cell.cz, powers);
+            for (int t = 0; t < n_terms; t++)
+            {
+                multipole[t] += m[p] * powers[t];
+            }
+        }
+        return;
+    }
+    for (int c = cell.first_child; c < cell.first_child + cell.n_children; c++)
+    {
+        this->upward(c, workspace);
+        // M2M from the child centre to this centre
+        const double *child = this->multipoles.data() + c * n_terms;
+        this->calPowers(nodes[c].cx - cell.cx, nodes[c].cy - cell.cy, nodes[c].cz - cell.cz, powers);
+        for (const Term &term : this->m2m_table)
+        {
+            multipole[term.o] += term.value * child[term.a] * powers[term.b];
+        }
+    }
+}
+
+void FmmSolver::p2p(int target, int source)
+{
+    const std::vector<OctreeNode> &nodes = this->tree.getNodes();
+    const double epsilon2 = this->epsilon * this->epsilon;
+    const double *m = this->tree.masses(), *x = this->tree.x(), *y = this->tree.y(), *z = this->tree.z();
+    for (int t = nodes[target].begin; t < nodes[target].end; t++)
+    {
+        double acc_x(0), acc_y(0), acc_z(0);
+        for (int s = nodes[source].begin; s < nodes[source].end; s++)
+        {
+            double dx = x[s] - x[t];
+            double dy = y[s] - y[t];
+            double dz = z[s] - z[t];
+            double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+            if (r2 > 0)
+            {
+                double factor = m[s] / (r2 * std::sqrt(r2));
+                acc_x += factor * dx;
+                acc_y += factor * dy;
+                acc_z += factor * dz;
+            }
+        }
+        this->acc_x[t] += acc_x;
+        this->acc_y[t] += acc_y;
+        this->acc_z[t] += acc_z;
+    }
+}
+
+void FmmSolver::traverse(int target, int source, Workspace &workspace)
+{
+    const std::vector<OctreeNode> &nodes = this->tree.getNodes();
+    const OctreeNode &a = nodes[target], &b = nodes[source];
+    const bool a_leaf = a.first_child < 0, b_leaf = b.first_child < 0;
+    if (target == source)
+    {
+        if (a_leaf)
+        {
+            this->p2p(target, source);
+            return;
+        }
+        for (int i = a.first_child; i < a.first_child + a.n_children; i++)
+        {
+            for (int j = a.first_child; j < a.first_child + a.n_children; j++)
+            {
+                this->traverse(i, j, workspace);
+            }
+        }
+        return;
+    }
+    const double dx = a.cx - b.cx, dy = a.cy - b.cy, dz = a.cz - b.cz;
+    const double d2 = dx * dx + dy * dy + dz * dz;
+    // radii of the spheres around the cells
+    const double radius = (a.size + b.size) * std::sqrt(3.0) / 2;
+    if (radius * radius < this->theta * this->theta * d2)
+    {
+        // M2L: the multipoles of the source about its centre into the local expansion of the target
+        const int n_terms = this->terms.size();
+        const double *multipole = this->multipoles.data() + source * n_terms;
+        double *local = this->locals.data() + target * n_terms;
+        double *derivatives = workspace.derivatives.data();
+        this->calDerivatives(dx, dy, dz, derivatives);
+        for (const Term &term : this->m2l_table)
+        {
+            local[term.o] += term.value * multipole[term.a] * derivatives[term.b];
+        }
+        return;
+    }
+    if (a_leaf && b_leaf)
+    {
+        this->p2p(target, source);
+    }
+    else if (b_leaf || (!a_leaf && a.size >= b.size))
+    {
+        for (int i = a.first_child; i < a.first_child + a.n_children; i++)
+        {
+            this->traverse(i, source, workspace);
+        }
+    }
+    else
+    {
+        for (int j = b.first_child; j < b.first_child + b.n_children; j++)
+        {
+            this->traverse(target, j, workspace);
+        }
+    }
+}
+
+void FmmSolver::downward(int node, Workspace &workspace)
+{
+    const std::vector<OctreeNode> &nodes = this->tree.getNodes();
+    const OctreeNode &cell = nodes[node];
+    const int n_terms = this->terms.size();
+    const double *local = this->locals.data() + node * n_terms;
+    double *powers = workspace.powers.data();
+    if (cell.first_child < 0)
+    {
+        // L2P: the acceleration is the gradient of the local expansion
+        const double *x = this->tree.x(), *y = this->tree.y(), *z = this->tree.z();
+        for (int p = cell.begin; p < cell.end; p++)
+        {
+            this->calPowers(x[p] - cell.cx, y[p] - cell.cy, z[p] - cell.cz, powers);
+            double acc[3] = {0, 0, 0};
+            for (const Term &term : this->gradient_table)
+            {
+                acc[term.o] += term.value * local[term.a] * powers[term.b];
+            }
+            this->acc_x[p] += acc[0];
+            this->acc_y[p] += acc[1];
+            this->acc_z[p] += acc[2];
+        }
+        return;
+    }
+    for (int c = cell.first_child; c < cell.first_child + cell.n_children; c++)
+    {
+        // L2L from this centre to the child centre
+        double *child = this->locals.data() + c * n_terms;
+        this->calPowers(nodes[c].cx - cell.cx, nodes[c].cy - cell.cy, nodes[c].cz - cell.cz, powers);
+        for (const Term &term : this->l2l_table)
+        {
+            child[term.o] += term.value * local[term.a] * powers[term.b];
+        }
+        this->downward(c, workspace);
+    }
+}
+
+void FmmSolver::computeAccelerations(ParticleSystem &system)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+    this->tree.build(system);
+    const std::vector<OctreeNode> &nodes = this->tree.getNodes();
+    const std::vector<int> &roots = this->tree.getSubtreeRoots();
+    const int n_particles = this->tree.size();
+    const int n_nodes = nodes.size();
+    const int n_roots = roots.size();
+    const int n_terms = this->terms.size();
+    #pragma omp single
+    {
+        this->multipoles.resize(n_nodes * n_terms);
+        this->locals.resize(n_nodes * n_terms);
+        this->acc_x.resize(n_particles);
+        this->acc_y.resize(n_particles);
+        this->acc_z.resize(n_particles);
+    }
+    #pragma omp for schedule(static)
+    for (int node = 0; node < n_nodes; node++)
+    {
+        std::fill(this->multipoles.begin() + node * n_terms, this->multipoles.begin() + (node + 1) * n_terms, 0.0);
+        std::fill(this->locals.begin() + node * n_terms, this->locals.begin() + (node + 1) * n_terms, 0.0);
+    }
+    #pragma omp for schedule(static)
+    for (int s = 0; s < n_particles; s++)
+    {
+        this->acc_x[s] = this->acc_y[s] = this->acc_z[s] = 0;
+    }
+    Workspace workspace{std::vector<double>(n_terms), std::vector<double>(n_terms)};
+    // upward pass: the subtrees in parallel, then the few cells above them
+    #pragma omp for schedule(dynamic, 1)
+    for (int k = 0; k < n_roots; k++)
+    {
+        this->upward(roots[k], workspace);
+    }
+    #pragma omp single
+    {
+        const int n_top = this->tree.getTopCount();
+        for (int node = n_top - 1; node >= 0; node--)
+        {
+            const OctreeNode &cell = nodes[node];
+            if (cell.first_child < 0 || cell.first_child >= n_top)
+            {
+                continue;
+            }
+            double *multipole = this->multipoles.data() + node * n_terms;
+            for (int c = cell.first_child; c < cell.first_child + cell.n_children; c++)
+            {
+                const double *child = this->multipoles.data() + c * n_terms;
+                this->calPowers(nodes[c].cx - cell.cx, nodes[c].cy - cell.cy, nodes[c].cz - cell.cz, workspace.powers.data());
+                for (const Term &term : this->m2m_table)
+                {
+                    multipole[term.o] += term.value * child[term.a] * workspace.powers[term.b];
+                }
+            }
+        }
+    }
+    // interactions and downward pass: each subtree only writes to its own cells and particles
+    #pragma omp for schedule(dynamic, 1)
+    for (int k = 0; k < n_roots; k++)
+    {
+        this->traverse(roots[k], 0, workspace);
+        this->downward(roots[k], workspace);
+    }
+    double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    #pragma omp for schedule(static)
+    for (int s = 0; s < n_particles; s++)
+    {
+        int i = this->tree.getIndex(s);
+        ax[i] = this->acc_x[s];
+        ay[i] = this->acc_y[s];
+        az[i] = this->acc_z[s];
+    }
+}
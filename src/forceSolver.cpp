@@ -0,0 +1,31 @@
+#include "forceSolver.hpp"
+
+ForceSolver::ForceSolver(double epsilon) : epsilon{epsilon}, compute_potential{false}
+{
+}
+
+double ForceSolver::getEpsilon() const
+{
+    return this->epsilon;
+}
+
+bool ForceSolver::supportsPotential() const
+{
+    return false;
+}
+
+void ForceSolver::setComputePotential(bool compute_potential)
+{
+    this->compute_potential = compute_potential;
+}
+
+bool ForceSolver::getComputePotential() const
+{
+    return this->compute_potential && this->supportsPotential();
+}
+
+void ForceSolver::computeActiveAccelerations(ParticleSystem &system, const std::vector<int> &)
+{
+    // the accelerations of all particles, the active ones among them
+    this->computeAccelerations(system);
+}
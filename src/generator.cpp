@@ -1,4 +1,10 @@
+
+
 #include "generator.hpp"
 #include <memory>
 
-// no implementation needed
\ No newline at end of file
+std::vector<std::shared_ptr<Particle>> InitialConditionGenerator::generateInitialConditions()
+{
+    this->p_list = this->generateParticleSystem().toParticles();
+    return this->p_list;
+}
@@ -0,0 +1,372 @@
+#include "gravityKernel.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <string>
+
+namespace
+{
+    SimdLevel &activeSimdLevel()
+    {
+        static SimdLevel level = detectSimdLevel();
+        return level;
+    }
+}
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::SSE2:
+        return "SSE2";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX512";
+    default:
+        return "scalar";
+    }
+}
+
+bool parseSimdLevel(const std::string &name, SimdLevel &level)
+{
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (SimdLevel candidate : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        std::string candidate_name(simdLevelName(candidate));
+        std::transform(candidate_name.begin(), candidate_name.end(), candidate_name.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (lower == candidate_name)
+        {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isSimdLevelSupported(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar:
+        return true;
+#ifdef NBODY_X86_KERNELS
+    case SimdLevel::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case SimdLevel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case SimdLevel::AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+SimdLevel detectSimdLevel()
+{
+    for (SimdLevel level : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE2})
+    {
+        if (isSimdLevelSupported(level))
+        {
+            return level;
+        }
+    }
+    return SimdLevel::Scalar;
+}
+
+SimdLevel getSimdLevel()
+{
+    return activeSimdLevel();
+}
+
+void setSimdLevel(SimdLevel level)
+{
+    activeSimdLevel() = isSimdLevelSupported(level) ? level : detectSimdLevel();
+}
+
+GravityKernel getGravityKernel(SimdLevel level)
+{
+    if (!isSimdLevelSupported(level))
+    {
+        level = detectSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef NBODY_X86_KERNELS
+    case SimdLevel::SSE2:
+        return accelerationsSSE2;
+    case SimdLevel::AVX2:
+        return accelerationsAVX2;
+    case SimdLevel::AVX512:
+        return accelerationsAVX512;
+#endif
+    default:
+        return accelerationsScalar;
+    }
+}
+
+PairKernel getPairKernel(SimdLevel level)
+{
+    if (!isSimdLevelSupported(level))
+    {
+        level = detectSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef NBODY_X86_KERNELS
+    case SimdLevel::SSE2:
+        return pairAccelerationsSSE2;
+    case SimdLevel::AVX2:
+        return pairAccelerationsAVX2;
+    case SimdLevel::AVX512:
+        return pairAccelerationsAVX512;
+#endif
+    default:
+        return pairAccelerationsScalar;
+    }
+}
+
+TileKernel getTileKernel(SimdLevel level)
+{
+    if (!isSimdLevelSupported(level))
+    {
+        level = detectSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef NBODY_X86_KERNELS
+    case SimdLevel::SSE2:
+        return tileAccelerationsSSE2;
+    case SimdLevel::AVX2:
+        return tileAccelerationsAVX2;
+    case SimdLevel::AVX512:
+        return tileAccelerationsAVX512;
+#endif
+    default:
+        return tileAccelerationsScalar;
+    }
+}
+
+FixedKernel getFixedKernel(int n, SimdLevel level)
+{
+    if (n < 1 || n > MAX_FIXED_SIZE)
+    {
+        return nullptr;
+    }
+    if (!isSimdLevelSupported(level))
+    {
+        level = detectSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef NBODY_X86_KERNELS
+    case SimdLevel::SSE2:
+        return fixedKernelSSE2(n);
+    case SimdLevel::AVX2:
+        return fixedKernelAVX2(n);
+    case SimdLevel::AVX512:
+        return fixedKernelAVX512(n);
+#endif
+    default:
+        return fixedKernelScalar(n);
+    }
+}
+
+EnsembleKernel getEnsembleKernel(SimdLevel level)
+{
+    if (!isSimdLevelSupported(level))
+    {
+        level = detectSimdLevel();
+    }
+    switch (level)
+    {
+#ifdef NBODY_X86_KERNELS
+    case SimdLevel::SSE2:
+        return ensembleAccelerationsSSE2;
+    case SimdLevel::AVX2:
+        return ensembleAccelerationsAVX2;
+    case SimdLevel::AVX512:
+        return ensembleAccelerationsAVX512;
+#endif
+    default:
+        return ensembleAccelerationsScalar;
+    }
+}
+
+void computeAccelerations(ParticleSystem &system, double epsilon, std::size_t begin, std::size_t end, bool potential)
+{
+    getGravityKernel()(system.masses(), system.x(), system.y(), system.z(), system.stride(), epsilon * epsilon,
+                       begin, end, system.ax(), system.ay(), system.az(), potential ? system.potentials() : nullptr);
+}
+
+void accelerationsScalar(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                         std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+{
+    for (std::size_t i = begin; i < end; i++)
+    {
+        double acc_x(0), acc_y(0), acc_z(0), pot(0);
+        for (std::size_t j = 0; j < n_sources; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+            if (r2 > 0)
+            {
+                double inv = 1.0 / std::sqrt(r2);
+                double factor = m[j] * inv * inv * inv;
+                acc_x += factor * dx;
+                acc_y += factor * dy;
+                acc_z += factor * dz;
+                if (j != i)
+                {
+                    pot -= m[j] * inv;
+                }
+            }
+        }
+        ax[i] = acc_x;
+        ay[i] = acc_y;
+        az[i] = acc_z;
+        if (phi)
+        {
+            phi[i] = pot;
+        }
+    }
+}
+
+void tileAccelerationsScalar(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                             double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az)
+{
+    for (std::size_t i = begin; i < end; i++)
+    {
+        double acc_x(0), acc_y(0), acc_z(0);
+        for (std::size_t j = source_begin; j < source_end; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+            if (r2 > 0)
+            {
+                double factor = m[j] / (r2 * std::sqrt(r2));
+                acc_x += factor * dx;
+                acc_y += factor * dy;
+                acc_z += factor * dz;
+            }
+        }
+        ax[i] += acc_x;
+        ay[i] += acc_y;
+        az[i] += acc_z;
+    }
+}
+
+void pairAccelerationsScalar(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                             std::size_t i, double *ax, double *ay, double *az, double *phi)
+{
+    double acc_x(0), acc_y(0), acc_z(0), pot(0);
+    for (std::size_t j = i + 1; j < n_sources; j++)
+    {
+        double dx = x[j] - x[i];
+        double dy = y[j] - y[i];
+        double dz = z[j] - z[i];
+        double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+        if (r2 > 0)
+        {
+            double inv = 1.0 / std::sqrt(r2);
+            double inv_r3 = inv * inv * inv;
+            acc_x += m[j] * inv_r3 * dx;
+            acc_y += m[j] * inv_r3 * dy;
+            acc_z += m[j] * inv_r3 * dz;
+            ax[j] -= m[i] * inv_r3 * dx;
+            ay[j] -= m[i] * inv_r3 * dy;
+            az[j] -= m[i] * inv_r3 * dz;
+            if (phi)
+            {
+                pot -= m[j] * inv;
+                phi[j] -= m[i] * inv;
+            }
+        }
+    }
+    ax[i] += acc_x;
+    ay[i] += acc_y;
+    az[i] += acc_z;
+    if (phi)
+    {
+        phi[i] += pot;
+    }
+}
+
+void ensembleAccelerationsScalar(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                                 double *ax, double *ay, double *az)
+{
+    const int length = n_bodies * ENSEMBLE_LANES;
+    std::fill(ax, ax + length, 0.0);
+    std::fill(ay, ay + length, 0.0);
+    std::fill(az, az + length, 0.0);
+    for (int i = 0; i < length; i += ENSEMBLE_LANES)
+    {
+        for (int j = i + ENSEMBLE_LANES; j < length; j += ENSEMBLE_LANES)
+        {
+            for (int k = 0; k < ENSEMBLE_LANES; k++)
+            {
+                double dx = x[j + k] - x[i + k];
+                double dy = y[j + k] - y[i + k];
+                double dz = z[j + k] - z[i + k];
+                double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+                if (r2 > 0)
+                {
+                    double inv_r3 = 1.0 / (r2 * std::sqrt(r2));
+                    ax[i + k] += m[j + k] * inv_r3 * dx;
+                    ay[i + k] += m[j + k] * inv_r3 * dy;
+                    az[i + k] += m[j + k] * inv_r3 * dz;
+                    ax[j + k] -= m[i + k] * inv_r3 * dx;
+                    ay[j + k] -= m[i + k] * inv_r3 * dy;
+                    az[j + k] -= m[i + k] * inv_r3 * dz;
+                }
+            }
+        }
+    }
+}
+
+namespace
+{
+    template <int N>
+    void fixedAccelerations(const double *m, const double *x, const double *y, const double *z, double epsilon2, double *ax, double *ay, double *az)
+    {
+        for (int i = 0; i < (N + 7) / 8 * 8; i++)
+        {
+            double acc_x(0), acc_y(0), acc_z(0);
+            unrolled<N>([&](auto j) {
+                double dx = x[j] - x[i];
+                double dy = y[j] - y[i];
+                double dz = z[j] - z[i];
+                double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+                if (r2 > 0)
+                {
+                    double factor = m[j] / (r2 * std::sqrt(r2));
+                    acc_x += factor * dx;
+                    acc_y += factor * dy;
+                    acc_z += factor * dz;
+                }
+            });
+            ax[i] = acc_x;
+            ay[i] = acc_y;
+            az[i] = acc_z;
+        }
+    }
+
+    template <int... N>
+    std::array<FixedKernel, sizeof...(N)> fixedKernels(std::integer_sequence<int, N...>)
+    {
+        return {fixedAccelerations<N + 1>...};
+    }
+}
+
+FixedKernel fixedKernelScalar(int n)
+{
+    static const std::array<FixedKernel, MAX_FIXED_SIZE> kernels = fixedKernels(std::make_integer_sequence<int, MAX_FIXED_SIZE>{});
+    return kernels[n - 1];
+}
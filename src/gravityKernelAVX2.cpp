@@ -0,0 +1,260 @@
+#include "gravityKernel.hpp"
+#include <array>
+#include <immintrin.h>
+
+namespace
+{
+    double horizontalSum(__m256d v)
+    {
+        __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+    }
+
+    // four sources per instruction
+    // sources [source_begin, source_end), added to the accumulators if ACCUMULATE
+    template <bool POTENTIAL, bool ACCUMULATE>
+    void accelerations(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                       double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+    {
+        const __m256d eps2 = _mm256_set1_pd(epsilon2);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d three_halves = _mm256_set1_pd(1.5);
+        const __m256d zero = _mm256_setzero_pd();
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const __m256d xi = _mm256_set1_pd(x[i]);
+            const __m256d yi = _mm256_set1_pd(y[i]);
+            const __m256d zi = _mm256_set1_pd(z[i]);
+            __m256d acc_x = zero, acc_y = zero, acc_z = zero, pot = zero;
+            // the lane of the target itself, skipped in the potential when softening makes r2 > 0
+            const std::size_t self_block = i / 4 * 4;
+            const __m256d not_self = _mm256_cmp_pd(_mm256_add_pd(_mm256_set1_pd(static_cast<double>(self_block)), _mm256_set_pd(3, 2, 1, 0)),
+                                                   _mm256_set1_pd(static_cast<double>(i)), _CMP_NEQ_OQ);
+            for (std::size_t j = source_begin; j < source_end; j += 4)
+            {
+                __m256d dx = _mm256_sub_pd(_mm256_load_pd(x + j), xi);
+                __m256d dy = _mm256_sub_pd(_mm256_load_pd(y + j), yi);
+                __m256d dz = _mm256_sub_pd(_mm256_load_pd(z + j), zi);
+                __m256d r2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_fmadd_pd(dz, dz, eps2)));
+                // single precision estimate of 1/sqrt(r2), refined twice by Newton's method
+                __m256d inv = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r2)));
+                __m256d half_r2 = _mm256_mul_pd(half, r2);
+                inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+                inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+                // skip sources at zero distance
+                inv = _mm256_and_pd(inv, _mm256_cmp_pd(r2, zero, _CMP_GT_OQ));
+                __m256d mj = _mm256_load_pd(m + j);
+                __m256d factor = _mm256_mul_pd(mj, _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+                acc_x = _mm256_fmadd_pd(factor, dx, acc_x);
+                acc_y = _mm256_fmadd_pd(factor, dy, acc_y);
+                acc_z = _mm256_fmadd_pd(factor, dz, acc_z);
+                if constexpr (POTENTIAL)
+                {
+                    pot = _mm256_fnmadd_pd(j == self_block ? _mm256_and_pd(mj, not_self) : mj, inv, pot);
+                }
+            }
+            if constexpr (ACCUMULATE)
+            {
+                ax[i] += horizontalSum(acc_x);
+                ay[i] += horizontalSum(acc_y);
+                az[i] += horizontalSum(acc_z);
+            }
+            else
+            {
+                ax[i] = horizontalSum(acc_x);
+                ay[i] = horizontalSum(acc_y);
+                az[i] = horizontalSum(acc_z);
+            }
+            if constexpr (POTENTIAL)
+            {
+                phi[i] = horizontalSum(pot);
+            }
+        }
+    }
+
+    template <bool POTENTIAL>
+    void pairAccelerations(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi)
+    {
+        const __m256d eps2 = _mm256_set1_pd(epsilon2);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d three_halves = _mm256_set1_pd(1.5);
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d xi = _mm256_set1_pd(x[i]);
+        const __m256d yi = _mm256_set1_pd(y[i]);
+        const __m256d zi = _mm256_set1_pd(z[i]);
+        const __m256d mi = _mm256_set1_pd(m[i]);
+        const __m256d index_i = _mm256_set1_pd(static_cast<double>(i));
+        __m256d acc_x = zero, acc_y = zero, acc_z = zero, pot = zero;
+        // start at the block holding i + 1, the lanes j <= i of that block are masked out
+        std::size_t j = (i + 1) / 4 * 4;
+        __m256d index_j = _mm256_add_pd(_mm256_set1_pd(static_cast<double>(j)), _mm256_set_pd(3, 2, 1, 0));
+        const __m256d four = _mm256_set1_pd(4.0);
+        for (; j < n_sources; j += 4)
+        {
+            __m256d dx = _mm256_sub_pd(_mm256_load_pd(x + j), xi);
+            __m256d dy = _mm256_sub_pd(_mm256_load_pd(y + j), yi);
+            __m256d dz = _mm256_sub_pd(_mm256_load_pd(z + j), zi);
+            __m256d r2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_fmadd_pd(dz, dz, eps2)));
+            __m256d inv = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r2)));
+            __m256d half_r2 = _mm256_mul_pd(half, r2);
+            inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+            inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+            inv = _mm256_and_pd(inv, _mm256_and_pd(_mm256_cmp_pd(r2, zero, _CMP_GT_OQ), _mm256_cmp_pd(index_j, index_i, _CMP_GT_OQ)));
+            index_j = _mm256_add_pd(index_j, four);
+            __m256d mj = _mm256_load_pd(m + j);
+            __m256d inv_r3 = _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv));
+            __m256d factor_i = _mm256_mul_pd(mj, inv_r3);
+            __m256d factor_j = _mm256_mul_pd(mi, inv_r3);
+            acc_x = _mm256_fmadd_pd(factor_i, dx, acc_x);
+            acc_y = _mm256_fmadd_pd(factor_i, dy, acc_y);
+            acc_z = _mm256_fmadd_pd(factor_i, dz, acc_z);
+            _mm256_store_pd(ax + j, _mm256_fnmadd_pd(factor_j, dx, _mm256_load_pd(ax + j)));
+            _mm256_store_pd(ay + j, _mm256_fnmadd_pd(factor_j, dy, _mm256_load_pd(ay + j)));
+            _mm256_store_pd(az + j, _mm256_fnmadd_pd(factor_j, dz, _mm256_load_pd(az + j)));
+            if constexpr (POTENTIAL)
+            {
+                pot = _mm256_fnmadd_pd(mj, inv, pot);
+                _mm256_store_pd(phi + j, _mm256_fnmadd_pd(mi, inv, _mm256_load_pd(phi + j)));
+            }
+        }
+        ax[i] += horizontalSum(acc_x);
+        ay[i] += horizontalSum(acc_y);
+        az[i] += horizontalSum(acc_z);
+        if constexpr (POTENTIAL)
+        {
+            phi[i] += horizontalSum(pot);
+        }
+    }
+
+    // four targets per instruction, the n sources broadcast one after the other
+    template <int N>
+    void fixedAccelerations(const double *m, const double *x, const double *y, const double *z, double epsilon2, double *ax, double *ay, double *az)
+    {
+        const __m256d eps2 = _mm256_set1_pd(epsilon2);
+        const __m256d half = _mm256_set1_pd(0.5);
+        const __m256d three_halves = _mm256_set1_pd(1.5);
+        const __m256d zero = _mm256_setzero_pd();
+        unrolled<(N + 3) / 4>([&](auto block) {
+            constexpr int i = 4 * block;
+            const __m256d xi = _mm256_load_pd(x + i);
+            const __m256d yi = _mm256_load_pd(y + i);
+            const __m256d zi = _mm256_load_pd(z + i);
+            __m256d acc_x = zero, acc_y = zero, acc_z = zero;
+            unrolled<N>([&](auto j) {
+                __m256d dx = _mm256_sub_pd(_mm256_set1_pd(x[j]), xi);
+                __m256d dy = _mm256_sub_pd(_mm256_set1_pd(y[j]), yi);
+                __m256d dz = _mm256_sub_pd(_mm256_set1_pd(z[j]), zi);
+                __m256d r2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_fmadd_pd(dz, dz, eps2)));
+                __m256d inv = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r2)));
+                __m256d half_r2 = _mm256_mul_pd(half, r2);
+                inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+                inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+                inv = _mm256_and_pd(inv, _mm256_cmp_pd(r2, zero, _CMP_GT_OQ));
+                __m256d factor = _mm256_mul_pd(_mm256_set1_pd(m[j]), _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv)));
+                acc_x = _mm256_fmadd_pd(factor, dx, acc_x);
+                acc_y = _mm256_fmadd_pd(factor, dy, acc_y);
+                acc_z = _mm256_fmadd_pd(factor, dz, acc_z);
+            });
+            _mm256_store_pd(ax + i, acc_x);
+            _mm256_store_pd(ay + i, acc_y);
+            _mm256_store_pd(az + i, acc_z);
+        });
+    }
+
+    template <int... N>
+    std::array<FixedKernel, sizeof...(N)> fixedKernels(std::integer_sequence<int, N...>)
+    {
+        return {fixedAccelerations<N + 1>...};
+    }
+}
+
+void accelerationsAVX2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                       std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+{
+    if (phi)
+    {
+        accelerations<true, false>(m, x, y, z, 0, n_sources, epsilon2, begin, end, ax, ay, az, phi);
+    }
+    else
+    {
+        accelerations<false, false>(m, x, y, z, 0, n_sources, epsilon2, begin, end, ax, ay, az, phi);
+    }
+}
+
+void tileAccelerationsAVX2(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                           double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az)
+{
+    accelerations<false, true>(m, x, y, z, source_begin, source_end, epsilon2, begin, end, ax, ay, az, nullptr);
+}
+
+void pairAccelerationsAVX2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi)
+{
+    if (phi)
+    {
+        pairAccelerations<true>(m, x, y, z, n_sources, epsilon2, i, ax, ay, az, phi);
+    }
+    else
+    {
+        pairAccelerations<false>(m, x, y, z, n_sources, epsilon2, i, ax, ay, az, phi);
+    }
+}
+
+void ensembleAccelerationsAVX2(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                               double *ax, double *ay, double *az)
+{
+    const __m256d eps2 = _mm256_set1_pd(epsilon2);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d three_halves = _mm256_set1_pd(1.5);
+    const __m256d zero = _mm256_setzero_pd();
+    const int length = n_bodies * ENSEMBLE_LANES;
+    for (int i = 0; i < length; i += 4)
+    {
+        _mm256_store_pd(ax + i, zero);
+        _mm256_store_pd(ay + i, zero);
+        _mm256_store_pd(az + i, zero);
+    }
+    // the systems in groups of four, each group a separate pass over the pairs
+    for (int lane = 0; lane < ENSEMBLE_LANES; lane += 4)
+    {
+        for (int i = lane; i < length; i += ENSEMBLE_LANES)
+        {
+            const __m256d xi = _mm256_load_pd(x + i);
+            const __m256d yi = _mm256_load_pd(y + i);
+            const __m256d zi = _mm256_load_pd(z + i);
+            const __m256d mi = _mm256_load_pd(m + i);
+            __m256d acc_x = _mm256_load_pd(ax + i), acc_y = _mm256_load_pd(ay + i), acc_z = _mm256_load_pd(az + i);
+            for (int j = i + ENSEMBLE_LANES; j < length; j += ENSEMBLE_LANES)
+            {
+                __m256d dx = _mm256_sub_pd(_mm256_load_pd(x + j), xi);
+                __m256d dy = _mm256_sub_pd(_mm256_load_pd(y + j), yi);
+                __m256d dz = _mm256_sub_pd(_mm256_load_pd(z + j), zi);
+                __m256d r2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_fmadd_pd(dz, dz, eps2)));
+                __m256d inv = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r2)));
+                __m256d half_r2 = _mm256_mul_pd(half, r2);
+                inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+                inv = _mm256_mul_pd(inv, _mm256_fnmadd_pd(half_r2, _mm256_mul_pd(inv, inv), three_halves));
+                inv = _mm256_and_pd(inv, _mm256_cmp_pd(r2, zero, _CMP_GT_OQ));
+                __m256d inv_r3 = _mm256_mul_pd(inv, _mm256_mul_pd(inv, inv));
+                __m256d factor_i = _mm256_mul_pd(_mm256_load_pd(m + j), inv_r3);
+                __m256d factor_j = _mm256_mul_pd(mi, inv_r3);
+                acc_x = _mm256_fmadd_pd(factor_i, dx, acc_x);
+                acc_y = _mm256_fmadd_pd(factor_i, dy, acc_y);
+                acc_z = _mm256_fmadd_pd(factor_i, dz, acc_z);
+                _mm256_store_pd(ax + j, _mm256_fnmadd_pd(factor_j, dx, _mm256_load_pd(ax + j)));
+                _mm256_store_pd(ay + j, _mm256_fnmadd_pd(factor_j, dy, _mm256_load_pd(ay + j)));
+                _mm256_store_pd(az + j, _mm256_fnmadd_pd(factor_j, dz, _mm256_load_pd(az + j)));
+            }
+            _mm256_store_pd(ax + i, acc_x);
+            _mm256_store_pd(ay + i, acc_y);
+            _mm256_store_pd(az + i, acc_z);
+        }
+    }
+}
+
+FixedKernel fixedKernelAVX2(int n)
+{
+    static const std::array<FixedKernel, MAX_FIXED_SIZE> kernels = fixedKernels(std::make_integer_sequence<int, MAX_FIXED_SIZE>{});
+    return kernels[n - 1];
+}
@@ -0,0 +1,247 @@
+#include "gravityKernel.hpp"
+#include <array>
+#include <immintrin.h>
+
+namespace
+{
+    // eight sources per instruction
+    // sources [source_begin, source_end), added to the accumulators if ACCUMULATE
+    template <bool POTENTIAL, bool ACCUMULATE>
+    void accelerations(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                       double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+    {
+        const __m512d eps2 = _mm512_set1_pd(epsilon2);
+        const __m512d half = _mm512_set1_pd(0.5);
+        const __m512d three_halves = _mm512_set1_pd(1.5);
+        const __m512d zero = _mm512_setzero_pd();
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const __m512d xi = _mm512_set1_pd(x[i]);
+            const __m512d yi = _mm512_set1_pd(y[i]);
+            const __m512d zi = _mm512_set1_pd(z[i]);
+            __m512d acc_x = zero, acc_y = zero, acc_z = zero, pot = zero;
+            // the lane of the target itself, skipped in the potential when softening makes r2 > 0
+            const std::size_t self_block = i / 8 * 8;
+            const __mmask8 not_self = static_cast<__mmask8>(~(1u << (i - self_block)));
+            for (std::size_t j = source_begin; j < source_end; j += 8)
+            {
+                __m512d dx = _mm512_sub_pd(_mm512_load_pd(x + j), xi);
+                __m512d dy = _mm512_sub_pd(_mm512_load_pd(y + j), yi);
+                __m512d dz = _mm512_sub_pd(_mm512_load_pd(z + j), zi);
+                __m512d r2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_fmadd_pd(dz, dz, eps2)));
+                // 14-bit estimate of 1/sqrt(r2), refined twice by Newton's method
+                __mmask8 nonzero = _mm512_cmp_pd_mask(r2, zero, _CMP_GT_OQ);
+                __m512d inv = _mm512_maskz_rsqrt14_pd(nonzero, r2);
+                __m512d half_r2 = _mm512_mul_pd(half, r2);
+                inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+                inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+                __m512d mj = _mm512_load_pd(m + j);
+                __m512d factor = _mm512_mul_pd(mj, _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+                acc_x = _mm512_fmadd_pd(factor, dx, acc_x);
+                acc_y = _mm512_fmadd_pd(factor, dy, acc_y);
+                acc_z = _mm512_fmadd_pd(factor, dz, acc_z);
+                if constexpr (POTENTIAL)
+                {
+                    pot = _mm512_mask3_fnmadd_pd(mj, inv, pot, j == self_block ? not_self : static_cast<__mmask8>(0xFF));
+                }
+            }
+            if constexpr (ACCUMULATE)
+            {
+                ax[i] += _mm512_reduce_add_pd(acc_x);
+                ay[i] += _mm512_reduce_add_pd(acc_y);
+                az[i] += _mm512_reduce_add_pd(acc_z);
+            }
+            else
+            {
+                ax[i] = _mm512_reduce_add_pd(acc_x);
+                ay[i] = _mm512_reduce_add_pd(acc_y);
+                az[i] = _mm512_reduce_add_pd(acc_z);
+            }
+            if constexpr (POTENTIAL)
+            {
+                phi[i] = _mm512_reduce_add_pd(pot);
+            }
+        }
+    }
+
+    template <bool POTENTIAL>
+    void pairAccelerations(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi)
+    {
+        const __m512d eps2 = _mm512_set1_pd(epsilon2);
+        const __m512d half = _mm512_set1_pd(0.5);
+        const __m512d three_halves = _mm512_set1_pd(1.5);
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512d xi = _mm512_set1_pd(x[i]);
+        const __m512d yi = _mm512_set1_pd(y[i]);
+        const __m512d zi = _mm512_set1_pd(z[i]);
+        const __m512d mi = _mm512_set1_pd(m[i]);
+        __m512d acc_x = zero, acc_y = zero, acc_z = zero, pot = zero;
+        // start at the block holding i + 1, the lanes j <= i of that block are masked out
+        std::size_t j = (i + 1) / 8 * 8;
+        __mmask8 after_i = static_cast<__mmask8>(0xFFu << (i + 1 - j));
+        for (; j < n_sources; j += 8)
+        {
+            __m512d dx = _mm512_sub_pd(_mm512_load_pd(x + j), xi);
+            __m512d dy = _mm512_sub_pd(_mm512_load_pd(y + j), yi);
+            __m512d dz = _mm512_sub_pd(_mm512_load_pd(z + j), zi);
+            __m512d r2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_fmadd_pd(dz, dz, eps2)));
+            __mmask8 keep = _mm512_mask_cmp_pd_mask(after_i, r2, zero, _CMP_GT_OQ);
+            after_i = 0xFF;
+            __m512d inv = _mm512_maskz_rsqrt14_pd(keep, r2);
+            __m512d half_r2 = _mm512_mul_pd(half, r2);
+            inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+            inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+            __m512d mj = _mm512_load_pd(m + j);
+            __m512d inv_r3 = _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv));
+            __m512d factor_i = _mm512_mul_pd(mj, inv_r3);
+            __m512d factor_j = _mm512_mul_pd(mi, inv_r3);
+            acc_x = _mm512_fmadd_pd(factor_i, dx, acc_x);
+            acc_y = _mm512_fmadd_pd(factor_i, dy, acc_y);
+            acc_z = _mm512_fmadd_pd(factor_i, dz, acc_z);
+            _mm512_store_pd(ax + j, _mm512_fnmadd_pd(factor_j, dx, _mm512_load_pd(ax + j)));
+            _mm512_store_pd(ay + j, _mm512_fnmadd_pd(factor_j, dy, _mm512_load_pd(ay + j)));
+            _mm512_store_pd(az + j, _mm512_fnmadd_pd(factor_j, dz, _mm512_load_pd(az + j)));
+            if constexpr (POTENTIAL)
+            {
+                pot = _mm512_fnmadd_pd(mj, inv, pot);
+                _mm512_store_pd(phi + j, _mm512_fnmadd_pd(mi, inv, _mm512_load_pd(phi + j)));
+            }
+        }
+        ax[i] += _mm512_reduce_add_pd(acc_x);
+        ay[i] += _mm512_reduce_add_pd(acc_y);
+        az[i] += _mm512_reduce_add_pd(acc_z);
+        if constexpr (POTENTIAL)
+        {
+            phi[i] += _mm512_reduce_add_pd(pot);
+        }
+    }
+
+    // eight targets per instruction, the n sources broadcast one after the other
+    template <int N>
+    void fixedAccelerations(const double *m, const double *x, const double *y, const double *z, double epsilon2, double *ax, double *ay, double *az)
+    {
+        const __m512d eps2 = _mm512_set1_pd(epsilon2);
+        const __m512d half = _mm512_set1_pd(0.5);
+        const __m512d three_halves = _mm512_set1_pd(1.5);
+        const __m512d zero = _mm512_setzero_pd();
+        unrolled<(N + 7) / 8>([&](auto block) {
+            constexpr int i = 8 * block;
+            const __m512d xi = _mm512_load_pd(x + i);
+            const __m512d yi = _mm512_load_pd(y + i);
+            const __m512d zi = _mm512_load_pd(z + i);
+            __m512d acc_x = zero, acc_y = zero, acc_z = zero;
+            unrolled<N>([&](auto j) {
+                __m512d dx = _mm512_sub_pd(_mm512_set1_pd(x[j]), xi);
+                __m512d dy = _mm512_sub_pd(_mm512_set1_pd(y[j]), yi);
+                __m512d dz = _mm512_sub_pd(_mm512_set1_pd(z[j]), zi);
+                __m512d r2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_fmadd_pd(dz, dz, eps2)));
+                __mmask8 nonzero = _mm512_cmp_pd_mask(r2, zero, _CMP_GT_OQ);
+                __m512d inv = _mm512_maskz_rsqrt14_pd(nonzero, r2);
+                __m512d half_r2 = _mm512_mul_pd(half, r2);
+                inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+                inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+                __m512d factor = _mm512_mul_pd(_mm512_set1_pd(m[j]), _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv)));
+                acc_x = _mm512_fmadd_pd(factor, dx, acc_x);
+                acc_y = _mm512_fmadd_pd(factor, dy, acc_y);
+                acc_z = _mm512_fmadd_pd(factor, dz, acc_z);
+            });
+            _mm512_store_pd(ax + i, acc_x);
+            _mm512_store_pd(ay + i, acc_y);
+            _mm512_store_pd(az + i, acc_z);
+        });
+    }
+
+    template <int... N>
+    std::array<FixedKernel, sizeof...(N)> fixedKernels(std::integer_sequence<int, N...>)
+    {
+        return {fixedAccelerations<N + 1>...};
+    }
+}
+
+void accelerationsAVX512(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                         std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+{
+    if (phi)
+    {
+        accelerations<true, false>(m, x, y, z, 0, n_sources, epsilon2, begin, end, ax, ay, az, phi);
+    }
+    else
+    {
+        accelerations<false, false>(m, x, y, z, 0, n_sources, epsilon2, begin, end, ax, ay, az, phi);
+    }
+}
+
+void tileAccelerationsAVX512(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                             double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az)
+{
+    accelerations<false, true>(m, x, y, z, source_begin, source_end, epsilon2, begin, end, ax, ay, az, nullptr);
+}
+
+void pairAccelerationsAVX512(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                             std::size_t i, double *ax, double *ay, double *az, double *phi)
+{
+    if (phi)
+    {
+        pairAccelerations<true>(m, x, y, z, n_sources, epsilon2, i, ax, ay, az, phi);
+    }
+    else
+    {
+        pairAccelerations<false>(m, x, y, z, n_sources, epsilon2, i, ax, ay, az, phi);
+    }
+}
+
+void ensembleAccelerationsAVX512(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                                 double *ax, double *ay, double *az)
+{
+    const __m512d eps2 = _mm512_set1_pd(epsilon2);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d three_halves = _mm512_set1_pd(1.5);
+    const __m512d zero = _mm512_setzero_pd();
+    // one vector holds the same body of all eight systems
+    const int length = n_bodies * ENSEMBLE_LANES;
+    for (int i = 0; i < length; i += 8)
+    {
+        _mm512_store_pd(ax + i, zero);
+        _mm512_store_pd(ay + i, zero);
+        _mm512_store_pd(az + i, zero);
+    }
+    for (int i = 0; i < length; i += 8)
+    {
+        const __m512d xi = _mm512_load_pd(x + i);
+        const __m512d yi = _mm512_load_pd(y + i);
+        const __m512d zi = _mm512_load_pd(z + i);
+        const __m512d mi = _mm512_load_pd(m + i);
+        __m512d acc_x = _mm512_load_pd(ax + i), acc_y = _mm512_load_pd(ay + i), acc_z = _mm512_load_pd(az + i);
+        for (int j = i + 8; j < length; j += 8)
+        {
+            __m512d dx = _mm512_sub_pd(_mm512_load_pd(x + j), xi);
+            __m512d dy = _mm512_sub_pd(_mm512_load_pd(y + j), yi);
+            __m512d dz = _mm512_sub_pd(_mm512_load_pd(z + j), zi);
+            __m512d r2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_fmadd_pd(dz, dz, eps2)));
+            __mmask8 nonzero = _mm512_cmp_pd_mask(r2, zero, _CMP_GT_OQ);
+            __m512d inv = _mm512_maskz_rsqrt14_pd(nonzero, r2);
+            __m512d half_r2 = _mm512_mul_pd(half, r2);
+            inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+            inv = _mm512_mul_pd(inv, _mm512_fnmadd_pd(half_r2, _mm512_mul_pd(inv, inv), three_halves));
+            __m512d inv_r3 = _mm512_mul_pd(inv, _mm512_mul_pd(inv, inv));
+            __m512d factor_i = _mm512_mul_pd(_mm512_load_pd(m + j), inv_r3);
+            __m512d factor_j = _mm512_mul_pd(mi, inv_r3);
+            acc_x = _mm512_fmadd_pd(factor_i, dx, acc_x);
+            acc_y = _mm512_fmadd_pd(factor_i, dy, acc_y);
+            acc_z = _mm512_fmadd_pd(factor_i, dz, acc_z);
+            _mm512_store_pd(ax + j, _mm512_fnmadd_pd(factor_j, dx, _mm512_load_pd(ax + j)));
+            _mm512_store_pd(ay + j, _mm512_fnmadd_pd(factor_j, dy, _mm512_load_pd(ay + j)));
+            _mm512_store_pd(az + j, _mm512_fnmadd_pd(factor_j, dz, _mm512_load_pd(az + j)));
+        }
+        _mm512_store_pd(ax + i, acc_x);
+        _mm512_store_pd(ay + i, acc_y);
+        _mm512_store_pd(az + i, acc_z);
+    }
+}
+
+FixedKernel fixedKernelAVX512(int n)
+{
+    static const std::array<FixedKernel, MAX_FIXED_SIZE> kernels = fixedKernels(std::make_integer_sequence<int, MAX_FIXED_SIZE>{});
+    return kernels[n - 1];
+}
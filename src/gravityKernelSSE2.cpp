@@ -0,0 +1,258 @@
+#include "gravityKernel.hpp"
+#include <array>
+#include <emmintrin.h>
+
+namespace
+{
+    double horizontalSum(__m128d v)
+    {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+
+    // two sources per instruction
+    // sources [source_begin, source_end), added to the accumulators if ACCUMULATE
+    template <bool POTENTIAL, bool ACCUMULATE>
+    void accelerations(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                       double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+    {
+        const __m128d eps2 = _mm_set1_pd(epsilon2);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d three_halves = _mm_set1_pd(1.5);
+        const __m128d zero = _mm_setzero_pd();
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const __m128d xi = _mm_set1_pd(x[i]);
+            const __m128d yi = _mm_set1_pd(y[i]);
+            const __m128d zi = _mm_set1_pd(z[i]);
+            __m128d acc_x = zero, acc_y = zero, acc_z = zero, pot = zero;
+            // the lane of the target itself, skipped in the potential when softening makes r2 > 0
+            const std::size_t self_block = i / 2 * 2;
+            const __m128d not_self = _mm_cmpneq_pd(_mm_set_pd(static_cast<double>(self_block + 1), static_cast<double>(self_block)), _mm_set1_pd(static_cast<double>(i)));
+            for (std::size_t j = source_begin; j < source_end; j += 2)
+            {
+                __m128d dx = _mm_sub_pd(_mm_load_pd(x + j), xi);
+                __m128d dy = _mm_sub_pd(_mm_load_pd(y + j), yi);
+                __m128d dz = _mm_sub_pd(_mm_load_pd(z + j), zi);
+                __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_add_pd(_mm_mul_pd(dz, dz), eps2));
+                // single precision estimate of 1/sqrt(r2), refined twice by Newton's method
+                __m128d inv = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(r2)));
+                __m128d half_r2 = _mm_mul_pd(half, r2);
+                inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+                inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+                // skip sources at zero distance
+                inv = _mm_and_pd(inv, _mm_cmpgt_pd(r2, zero));
+                __m128d mj = _mm_load_pd(m + j);
+                __m128d factor = _mm_mul_pd(mj, _mm_mul_pd(inv, _mm_mul_pd(inv, inv)));
+                acc_x = _mm_add_pd(acc_x, _mm_mul_pd(factor, dx));
+                acc_y = _mm_add_pd(acc_y, _mm_mul_pd(factor, dy));
+                acc_z = _mm_add_pd(acc_z, _mm_mul_pd(factor, dz));
+                if constexpr (POTENTIAL)
+                {
+                    pot = _mm_sub_pd(pot, _mm_mul_pd(j == self_block ? _mm_and_pd(mj, not_self) : mj, inv));
+                }
+            }
+            if constexpr (ACCUMULATE)
+            {
+                ax[i] += horizontalSum(acc_x);
+                ay[i] += horizontalSum(acc_y);
+                az[i] += horizontalSum(acc_z);
+            }
+            else
+            {
+                ax[i] = horizontalSum(acc_x);
+                ay[i] = horizontalSum(acc_y);
+                az[i] = horizontalSum(acc_z);
+            }
+            if constexpr (POTENTIAL)
+            {
+                phi[i] = horizontalSum(pot);
+            }
+        }
+    }
+
+    template <bool POTENTIAL>
+    void pairAccelerations(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi)
+    {
+        const __m128d eps2 = _mm_set1_pd(epsilon2);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d three_halves = _mm_set1_pd(1.5);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d xi = _mm_set1_pd(x[i]);
+        const __m128d yi = _mm_set1_pd(y[i]);
+        const __m128d zi = _mm_set1_pd(z[i]);
+        const __m128d mi = _mm_set1_pd(m[i]);
+        const __m128d index_i = _mm_set1_pd(static_cast<double>(i));
+        __m128d acc_x = zero, acc_y = zero, acc_z = zero, pot = zero;
+        // start at the block holding i + 1, the lanes j <= i of that block are masked out
+        std::size_t j = (i + 1) / 2 * 2;
+        __m128d index_j = _mm_set_pd(static_cast<double>(j + 1), static_cast<double>(j));
+        const __m128d two = _mm_set1_pd(2.0);
+        for (; j < n_sources; j += 2)
+        {
+            __m128d dx = _mm_sub_pd(_mm_load_pd(x + j), xi);
+            __m128d dy = _mm_sub_pd(_mm_load_pd(y + j), yi);
+            __m128d dz = _mm_sub_pd(_mm_load_pd(z + j), zi);
+            __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_add_pd(_mm_mul_pd(dz, dz), eps2));
+            __m128d inv = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(r2)));
+            __m128d half_r2 = _mm_mul_pd(half, r2);
+            inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+            inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+            inv = _mm_and_pd(inv, _mm_and_pd(_mm_cmpgt_pd(r2, zero), _mm_cmpgt_pd(index_j, index_i)));
+            index_j = _mm_add_pd(index_j, two);
+            __m128d mj = _mm_load_pd(m + j);
+            __m128d inv_r3 = _mm_mul_pd(inv, _mm_mul_pd(inv, inv));
+            __m128d factor_i = _mm_mul_pd(mj, inv_r3);
+            __m128d factor_j = _mm_mul_pd(mi, inv_r3);
+            acc_x = _mm_add_pd(acc_x, _mm_mul_pd(factor_i, dx));
+            acc_y = _mm_add_pd(acc_y, _mm_mul_pd(factor_i, dy));
+            acc_z = _mm_add_pd(acc_z, _mm_mul_pd(factor_i, dz));
+            _mm_store_pd(ax + j, _mm_sub_pd(_mm_load_pd(ax + j), _mm_mul_pd(factor_j, dx)));
+            _mm_store_pd(ay + j, _mm_sub_pd(_mm_load_pd(ay + j), _mm_mul_pd(factor_j, dy)));
+            _mm_store_pd(az + j, _mm_sub_pd(_mm_load_pd(az + j), _mm_mul_pd(factor_j, dz)));
+            if constexpr (POTENTIAL)
+            {
+                pot = _mm_sub_pd(pot, _mm_mul_pd(mj, inv));
+                _mm_store_pd(phi + j, _mm_sub_pd(_mm_load_pd(phi + j), _mm_mul_pd(mi, inv)));
+            }
+        }
+        ax[i] += horizontalSum(acc_x);
+        ay[i] += horizontalSum(acc_y);
+        az[i] += horizontalSum(acc_z);
+        if constexpr (POTENTIAL)
+        {
+            phi[i] += horizontalSum(pot);
+        }
+    }
+
+    // two targets per instruction, the n sources broadcast one after the other
+    template <int N>
+    void fixedAccelerations(const double *m, const double *x, const double *y, const double *z, double epsilon2, double *ax, double *ay, double *az)
+    {
+        const __m128d eps2 = _mm_set1_pd(epsilon2);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d three_halves = _mm_set1_pd(1.5);
+        const __m128d zero = _mm_setzero_pd();
+        unrolled<(N + 1) / 2>([&](auto block) {
+            constexpr int i = 2 * block;
+            const __m128d xi = _mm_load_pd(x + i);
+            const __m128d yi = _mm_load_pd(y + i);
+            const __m128d zi = _mm_load_pd(z + i);
+            __m128d acc_x = zero, acc_y = zero, acc_z = zero;
+            unrolled<N>([&](auto j) {
+                __m128d dx = _mm_sub_pd(_mm_set1_pd(x[j]), xi);
+                __m128d dy = _mm_sub_pd(_mm_set1_pd(y[j]), yi);
+                __m128d dz = _mm_sub_pd(_mm_set1_pd(z[j]), zi);
+                __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_add_pd(_mm_mul_pd(dz, dz), eps2));
+                __m128d inv = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(r2)));
+                __m128d half_r2 = _mm_mul_pd(half, r2);
+                inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+                inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+                inv = _mm_and_pd(inv, _mm_cmpgt_pd(r2, zero));
+                __m128d factor = _mm_mul_pd(_mm_set1_pd(m[j]), _mm_mul_pd(inv, _mm_mul_pd(inv, inv)));
+                acc_x = _mm_add_pd(acc_x, _mm_mul_pd(factor, dx));
+                acc_y = _mm_add_pd(acc_y, _mm_mul_pd(factor, dy));
+                acc_z = _mm_add_pd(acc_z, _mm_mul_pd(factor, dz));
+            });
+            _mm_store_pd(ax + i, acc_x);
+            _mm_store_pd(ay + i, acc_y);
+            _mm_store_pd(az + i, acc_z);
+        });
+    }
+
+    template <int... N>
+    std::array<FixedKernel, sizeof...(N)> fixedKernels(std::integer_sequence<int, N...>)
+    {
+        return {fixedAccelerations<N + 1>...};
+    }
+}
+
+void accelerationsSSE2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                       std::size_t begin, std::size_t end, double *ax, double *ay, double *az, double *phi)
+{
+    if (phi)
+    {
+        accelerations<true, false>(m, x, y, z, 0, n_sources, epsilon2, begin, end, ax, ay, az, phi);
+    }
+    else
+    {
+        accelerations<false, false>(m, x, y, z, 0, n_sources, epsilon2, begin, end, ax, ay, az, phi);
+    }
+}
+
+void tileAccelerationsSSE2(const double *m, const double *x, const double *y, const double *z, std::size_t source_begin, std::size_t source_end,
+                           double epsilon2, std::size_t begin, std::size_t end, double *ax, double *ay, double *az)
+{
+    accelerations<false, true>(m, x, y, z, source_begin, source_end, epsilon2, begin, end, ax, ay, az, nullptr);
+}
+
+void pairAccelerationsSSE2(const double *m, const double *x, const double *y, const double *z, std::size_t n_sources, double epsilon2,
+                           std::size_t i, double *ax, double *ay, double *az, double *phi)
+{
+    if (phi)
+    {
+        pairAccelerations<true>(m, x, y, z, n_sources, epsilon2, i, ax, ay, az, phi);
+    }
+    else
+    {
+        pairAccelerations<false>(m, x, y, z, n_sources, epsilon2, i, ax, ay, az, phi);
+    }
+}
+
+void ensembleAccelerationsSSE2(const double *m, const double *x, const double *y, const double *z, int n_bodies, double epsilon2,
+                               double *ax, double *ay, double *az)
+{
+    const __m128d eps2 = _mm_set1_pd(epsilon2);
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d three_halves = _mm_set1_pd(1.5);
+    const __m128d zero = _mm_setzero_pd();
+    const int length = n_bodies * ENSEMBLE_LANES;
+    for (int i = 0; i < length; i += 2)
+    {
+        _mm_store_pd(ax + i, zero);
+        _mm_store_pd(ay + i, zero);
+        _mm_store_pd(az + i, zero);
+    }
+    // the systems in pairs, each pair a separate pass over the pairs of bodies
+    for (int lane = 0; lane < ENSEMBLE_LANES; lane += 2)
+    {
+        for (int i = lane; i < length; i += ENSEMBLE_LANES)
+        {
+            const __m128d xi = _mm_load_pd(x + i);
+            const __m128d yi = _mm_load_pd(y + i);
+            const __m128d zi = _mm_load_pd(z + i);
+            const __m128d mi = _mm_load_pd(m + i);
+            __m128d acc_x = _mm_load_pd(ax + i), acc_y = _mm_load_pd(ay + i), acc_z = _mm_load_pd(az + i);
+            for (int j = i + ENSEMBLE_LANES; j < length; j += ENSEMBLE_LANES)
+            {
+                __m128d dx = _mm_sub_pd(_mm_load_pd(x + j), xi);
+                __m128d dy = _mm_sub_pd(_mm_load_pd(y + j), yi);
+                __m128d dz = _mm_sub_pd(_mm_load_pd(z + j), zi);
+                __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_add_pd(_mm_mul_pd(dz, dz), eps2));
+                __m128d inv = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_cvtpd_ps(r2)));
+                __m128d half_r2 = _mm_mul_pd(half, r2);
+                inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+                inv = _mm_mul_pd(inv, _mm_sub_pd(three_halves, _mm_mul_pd(half_r2, _mm_mul_pd(inv, inv))));
+                inv = _mm_and_pd(inv, _mm_cmpgt_pd(r2, zero));
+                __m128d inv_r3 = _mm_mul_pd(inv, _mm_mul_pd(inv, inv));
+                __m128d factor_i = _mm_mul_pd(_mm_load_pd(m + j), inv_r3);
+                __m128d factor_j = _mm_mul_pd(mi, inv_r3);
+                acc_x = _mm_add_pd(acc_x, _mm_mul_pd(factor_i, dx));
+                acc_y = _mm_add_pd(acc_y, _mm_mul_pd(factor_i, dy));
+                acc_z = _mm_add_pd(acc_z, _mm_mul_pd(factor_i, dz));
+                _mm_store_pd(ax + j, _mm_sub_pd(_mm_load_pd(ax + j), _mm_mul_pd(factor_j, dx)));
+                _mm_store_pd(ay + j, _mm_sub_pd(_mm_load_pd(ay + j), _mm_mul_pd(factor_j, dy)));
+                _mm_store_pd(az + j, _mm_sub_pd(_mm_load_pd(az + j), _mm_mul_pd(factor_j, dz)));
+            }
+            _mm_store_pd(ax + i, acc_x);
+            _mm_store_pd(ay + i, acc_y);
+            _mm_store_pd(az + i, acc_z);
+        }
+    }
+}
+
+FixedKernel fixedKernelSSE2(int n)
+{
+    static const std::array<FixedKernel, MAX_FIXED_SIZE> kernels = fixedKernels(std::make_integer_sequence<int, MAX_FIXED_SIZE>{});
+    return kernels[n - 1];
+}
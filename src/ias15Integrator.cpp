@@ -0,0 +1,370 @@
+#include "ias15Integrator.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // a new step below this fraction of the tried one rejects the step, and steps grow by at most its inverse
+    constexpr double SAFETY_FACTOR = 0.25;
+    constexpr int MAX_ITERATIONS = 12;
+}
+
+Ias15Integrator::Ias15Integrator(double tolerance) : tolerance{tolerance}, nodes{0, 0.0562625605369221464656521910318, 0.180240691736892364987579942780, 0.352624717113169637373907769648,
+                                                                                      0.547153626330555383001448554766, 0.734210177215410531523210605558, 0.885320946839095768090359771030, 0.977520613561287501891174488626},
+                                                     time{0}, step{0}, accepted_steps{0}, rejected_steps{0}
+{
+    // c[j][k] is the coefficient of t^(k+1) in t (t - h_1) ... (t - h_j)
+    std::vector<double> polynomial{0, 1};
+    for (int j = 0; j < NODES - 1; j++)
+    {
+        if (j > 0)
+        {
+            std::vector<double> product(polynomial.size() + 1, 0);
+            for (std::size_t p = 0; p < polynomial.size(); p++)
+            {
+                product[p + 1] += polynomial[p];
+                product[p] -= this->nodes[j] * polynomial[p];
+            }
+            polynomial = product;
+        }
+        for (int k = 0; k < NODES - 1; k++)
+        {
+            this->c[j][k] = k <= j ? polynomial[k + 1] : 0;
+        }
+    }
+    for (int n = 0; n < NODES; n++)
+    {
+        for (int m = 0; m < NODES; m++)
+        {
+            this->binomial[n][m] = m == 0 || m == n ? 1 : (m < n ? this->binomial[n - 1][m - 1] + this->binomial[n - 1][m] : 0);
+        }
+    }
+}
+
+double Ias15Integrator::getTolerance() const
+{
+    return this->tolerance;
+}
+
+long long Ias15Integrator::getAcceptedSteps() const
+{
+    return this->accepted_steps;
+}
+
+long long Ias15Integrator::getRejectedSteps() const
+{
+    return this->rejected_steps;
+}
+
+double Ias15Integrator::getStep() const
+{
+    return this->step;
+}
+
+std::string Ias15Integrator::getStepReport() const
+{
+    return "accepted steps: " + std::to_string(this->accepted_steps) + ", rejected steps: " + std::to_string(this->rejected_steps);
+}
+
+bool Ias15Integrator::recordsEnergy() const
+{
+    return true;
+}
+
+bool Ias15Integrator::leavesAccelerationsCurrent() const
+{
+    return true;
+}
+
+void Ias15Integrator::clearState()
+{
+    // the next call finds no compensation of its system and starts afresh
+    this->compensation_x.clear();
+    this->compensation_v.clear();
+}
+
+void Ias15Integrator::rescale(std::size_t length)
+{
+    const double ratio = this->step_ratio;
+    #pragma omp for schedule(static)
+    for (std::size_t k = 0; k < length; k++)
+    {
+        double q = ratio;
+        for (int j = 0; j < NODES - 1; j++)
+        {
+            this->b[j][k] *= q;
+            this->e[j][k] *= q;
+            q *= ratio;
+        }
+    }
+    this->updateG(length);
+}
+
+void Ias15Integrator::updateG(std::size_t length)
+{
+    #pragma omp for schedule(static)
+    for (std::size_t k = 0; k < length; k++)
+    {
+        for (int j = NODES - 2; j >= 0; j--)
+        {
+            double value = this->b[j][k];
+            for (int i = j + 1; i < NODES - 1; i++)
+            {
+                value -= this->c[i][j] * this->g[i][k];
+            }
+            this->g[j][k] = value;
+        }
+    }
+}
+
+void Ias15Integrator::predict(ParticleSystem &system, int node)
+{
+    const std::size_t length = 3 * system.stride();
+    const double h = this->nodes[node];
+    const double s = h * this->step;
+    // t^(k+3) / ((k+2)(k+3)) at t = h, divided by h^2
+    double factors[NODES - 1];
+    double power = h;
+    for (int k = 0; k < NODES - 1; k++)
+    {
+        factors[k] = power / ((k + 2) * (k + 3));
+        power *= h;
+    }
+    const double *x = system.x(), *v = system.vx(), *a = system.ax();
+    double *stage_x = this->stage.x();
+    #pragma omp for schedule(static)
+    for (std::size_t k = 0; k < length; k++)
+    {
+        double sum = 0.5 * a[k];
+        for (int j = 0; j < NODES - 1; j++)
+        {
+            sum += factors[j] * this->b[j][k];
+        }
+        stage_x[k] = x[k] + s * v[k] + s * s * sum;
+    }
+}
+
+void Ias15Integrator::correct(const ParticleSystem &system, int node)
+{
+    const std::size_t length = 3 * system.stride();
+    const double *a0 = system.ax(), *a = this->stage.ax();
+    double max_acceleration(0), max_change(0);
+    #pragma omp for schedule(static) nowait
+    for (std::size_t k = 0; k < length; k++)
+    {
+        // divided differences of the accelerations at the nodes up to this one
+        double value = (a[k] - a0[k]) / this->nodes[node];
+        for (int j = 1; j < node; j++)
+        {
+            value = (value - this->g[j - 1][k]) / (this->nodes[node] - this->nodes[j]);
+        }
+        double change = value - this->g[node - 1][k];
+        this->g[node - 1][k] = value;
+        for (int j = 0; j < node; j++)
+        {
+            this->b[j][k] += this->c[node - 1][j] * change;
+        }
+        max_acceleration = std::max(max_acceleration, std::abs(a[k]));
+        max_change = std::max(max_change, std::abs(change));
+    }
+    if (node == NODES - 1)
+    {
+        #pragma omp critical
+        {
+            this->max_acceleration = std::max(this->max_acceleration, max_acceleration);
+            this->max_change = std::max(this->max_change, max_change);
+        }
+    }
+}
+
+void Ias15Integrator::integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps)
+{
+    const std::size_t length = 3 * system.stride();
+    const double end_time = dt * n_steps;
+    // a call declared to continue the previous one on the system it left keeps the step size, the predicted
+    // polynomial and the compensation of that one, and its accelerations
+    const bool continuing = this->accelerations_current && this->compensation_x.size() == length;
+    const bool first_forces = !continuing || this->record_energy;
+    #pragma omp single
+    {
+        this->stage = system;
+        if (!continuing)
+        {
+            for (int j = 0; j < NODES - 1; j++)
+            {
+                this->b[j].assign(length, 0);
+                this->g[j].assign(length, 0);
+                this->e[j].assign(length, 0);
+            }
+            this->compensation_x.assign(length, 0);
+            this->compensation_v.assign(length, 0);
+            this->step = dt;
+            this->predicted = false;
+        }
+        this->time = 0;
+        this->accepted_steps = this->rejected_steps = 0;
+        this->force_evaluations = first_forces ? system.size() : 0;
+        solver.setComputePotential(this->record_energy);
+    }
+    if (first_forces)
+    {
+        solver.computeAccelerations(system);
+        NBODY_BARRIER();
+    }
+    #pragma omp single
+    {
+        if (solver.getComputePotential())
+        {
+            this->initial_energy = this->final_energy = this->takeEnergy(system, solver);
+        }
+    }
+    double *x = system.x(), *v = system.vx();
+    const double *a = system.ax();
+    while (true)
+    {
+        #pragma omp single
+        {
+            if (solver.getComputePotential())
+            {
+                this->final_energy = this->takeEnergy(system, solver);
+            }
+            this->finished = this->time >= end_time;
+            // the last step ends exactly at the end time
+            this->step_ratio = std::min(this->step, end_time - this->time) / this->step;
+            this->last_change = 2;
+        }
+        if (this->finished)
+        {
+            break;
+        }
+        if (this->step_ratio < 1)
+        {
+            this->rescale(length);
+            #pragma omp single
+            this->step *= this->step_ratio;
+        }
+        // predictor-corrector iterations until the polynomial stops changing
+        for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+        {
+            #pragma omp single
+            this->max_acceleration = this->max_change = 0;
+            for (int node = 1; node < NODES; node++)
+            {
+                this->predict(system, node);
+                solver.computeAccelerations(this->stage);
+                NBODY_BARRIER();
+                this->correct(system, node);
+                NBODY_BARRIER();
+            }
+            #pragma omp single
+            {
+                this->force_evaluations += static_cast<long long>(system.size()) * (NODES - 1);
+                double change = this->max_acceleration > 0 ? this->max_change / this->max_acceleration : 0;
+                // converged, or round-off keeps the change from decreasing further
+                this->converged = change < 1e-16 || (iteration > 1 && change >= this->last_change);
+                this->last_change = change;
+            }
+            if (this->converged)
+            {
+                break;
+            }
+        }
+        // error estimate from the highest coefficient
+        {
+            double max_acceleration(0), max_b(0);
+            #pragma omp single
+            this->max_acceleration = this->max_b = 0;
+            #pragma omp for schedule(static) nowait
+            for (std::size_t k = 0; k < length; k++)
+            {
+                max_acceleration = std::max(max_acceleration, std::abs(a[k]));
+                max_b = std::max(max_b, std::abs(this->b[NODES - 2][k]));
+            }
+            #pragma omp critical
+            {
+                this->max_acceleration = std::max(this->max_acceleration, max_acceleration);
+                this->max_b = std::max(this->max_b, max_b);
+            }
+            NBODY_BARRIER();
+        }
+        #pragma omp single
+        {
+            double error = this->max_acceleration > 0 ? this->max_b / this->max_acceleration : 0;
+            double new_step = error > 0 ? this->step * std::pow(this->tolerance / error, 1.0 / 7) : this->step / SAFETY_FACTOR;
+            this->accepted = std::abs(new_step) >= SAFETY_FACTOR * std::abs(this->step);
+            if (this->accepted)
+            {
+                new_step = std::min(new_step, this->step / SAFETY_FACTOR);
+                this->accepted_steps++;
+            }
+            else
+            {
+                this->rejected_steps++;
+            }
+            this->step_ratio = new_step / this->step;
+        }
+        if (!this->accepted)
+        {
+            // retry from the same start with the polynomial rescaled to the shorter step
+            this->rescale(length);
+            #pragma omp single
+            this->step *= this->step_ratio;
+            continue;
+        }
+        // advance to the end of the step with compensated sums
+        const double h = this->step;
+        const double ratio = this->step_ratio;
+        #pragma omp for schedule(static)
+        for (std::size_t k = 0; k < length; k++)
+        {
+            double dx = 0.5 * a[k], dv = a[k];
+            for (int j = 0; j < NODES - 1; j++)
+            {
+                dx += this->b[j][k] / ((j + 2) * (j + 3));
+                dv += this->b[j][k] / (j + 2);
+            }
+            dx = h * v[k] + h * h * dx;
+            dv = h * dv;
+            double y = dx - this->compensation_x[k];
+            double t = x[k] + y;
+            this->compensation_x[k] = (t - x[k]) - y;
+            x[k] = t;
+            y = dv - this->compensation_v[k];
+            t = v[k] + y;
+            this->compensation_v[k] = (t - v[k]) - y;
+            v[k] = t;
+            // polynomial of the next step: a(1 + ratio t) expanded in t, corrected by the error of the last prediction
+            double q = ratio;
+            double next[NODES - 1];
+            for (int j = 0; j < NODES - 1; j++)
+            {
+                next[j] = 0;
+                for (int i = j; i < NODES - 1; i++)
+                {
+                    next[j] += this->binomial[i + 1][j + 1] * this->b[i][k];
+                }
+                next[j] *= q;
+                q *= ratio;
+            }
+            for (int j = 0; j < NODES - 1; j++)
+            {
+                double correction = this->predicted ? this->b[j][k] - this->e[j][k] : 0;
+                this->e[j][k] = next[j];
+                this->b[j][k] = next[j] + correction;
+            }
+        }
+        this->updateG(length);
+        #pragma omp single
+        {
+            this->time += h;
+            this->step = h * ratio;
+            this->predicted = true;
+            this->force_evaluations += system.size();
+            // the evaluation at the end of the last step gives the final energy
+            solver.setComputePotential(this->record_energy && this->time >= end_time);
+        }
+        solver.computeAccelerations(system);
+        NBODY_BARRIER();
+    }
+}
@@ -0,0 +1,62 @@
+#include "integrator.hpp"
+#include "nbody.hpp"
+
+long long Integrator::getForceEvaluations() const
+{
+    return this->force_evaluations;
+}
+
+std::string Integrator::getStepReport() const
+{
+    return "";
+}
+
+bool Integrator::recordsEnergy() const
+{
+    return false;
+}
+
+void Integrator::setRecordEnergy(bool record_energy)
+{
+    this->record_energy = record_energy;
+}
+
+bool Integrator::getRecordEnergy() const
+{
+    return this->record_energy;
+}
+
+void Integrator::setAccelerationsCurrent(bool accelerations_current)
+{
+    this->accelerations_current = accelerations_current;
+}
+
+bool Integrator::getAccelerationsCurrent() const
+{
+    return this->accelerations_current;
+}
+
+bool Integrator::leavesAccelerationsCurrent() const
+{
+    return false;
+}
+
+void Integrator::clearState()
+{
+}
+
+double Integrator::getInitialEnergy() const
+{
+    return this->initial_energy;
+}
+
+double Integrator::getFinalEnergy() const
+{
+    return this->final_energy;
+}
+
+double Integrator::takeEnergy(const ParticleSystem &system, ForceSolver &solver) const
+{
+    solver.setComputePotential(false);
+    return calTotalEnergyFromPotentials(system);
+}
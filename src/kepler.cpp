@@ -0,0 +1,134 @@
+#include "kepler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // |z| below which 14 terms of the series give c2 and c3 to machine precision
+    constexpr double SERIES_LIMIT = 10;
+    constexpr int SERIES_TERMS = 14;
+    constexpr int MAX_ITERATIONS = 50;
+
+    // Stumpff functions c2(z) = sum (-z)^j / (2j + 2)! and c3(z) = sum (-z)^j / (2j + 3)! by Horner's rule
+    inline void stumpffSeries(double z, double &c2, double &c3)
+    {
+        double t2(1), t3(1);
+        for (int j = SERIES_TERMS; j > 0; j--)
+        {
+            t2 = 1 - z * t2 / ((2 * j + 1) * (2 * j + 2));
+            t3 = 1 - z * t3 / ((2 * j + 2) * (2 * j + 3));
+        }
+        c2 = t2 / 2;
+        c3 = t3 / 6;
+    }
+
+    // Stumpff functions c2 and c3 by their closed forms
+    inline void stumpffClosed(double z, double &c2, double &c3)
+    {
+        if (z > 0)
+        {
+            double sz = std::sqrt(z);
+            c2 = (1 - std::cos(sz)) / z;
+            c3 = (sz - std::sin(sz)) / (z * sz);
+        }
+        else
+        {
+            double sz = std::sqrt(-z);
+            c2 = (std::cosh(sz) - 1) / -z;
+            c3 = (std::sinh(sz) - sz) / (-z * sz);
+        }
+    }
+
+    // G_k = s^k c_k(beta s^2) for k = 0..3 of a batch
+    void calStumpff(int count, const double *beta, const double *s, double *g0, double *g1, double *g2, double *g3)
+    {
+        #pragma omp simd
+        for (int p = 0; p < count; p++)
+        {
+            double z = beta[p] * s[p] * s[p];
+            double c2, c3;
+            stumpffSeries(std::clamp(z, -SERIES_LIMIT, SERIES_LIMIT), c2, c3);
+            g2[p] = s[p] * s[p] * c2;
+            g3[p] = s[p] * s[p] * s[p] * c3;
+        }
+        for (int p = 0; p < count; p++)
+        {
+            double z = beta[p] * s[p] * s[p];
+            if (std::abs(z) > SERIES_LIMIT)
+            {
+                double c2, c3;
+                stumpffClosed(z, c2, c3);
+                g2[p] = s[p] * s[p] * c2;
+                g3[p] = s[p] * s[p] * s[p] * c3;
+            }
+        }
+        // c0 = 1 - z c2 and c1 = 1 - z c3
+        #pragma omp simd
+        for (int p = 0; p < count; p++)
+        {
+            g0[p] = 1 - beta[p] * g2[p];
+            g1[p] = s[p] - beta[p] * g3[p];
+        }
+    }
+
+    void keplerBatch(double mu, double dt, int count, double *x, double *y, double *z, double *vx, double *vy, double *vz)
+    {
+        double r0[KEPLER_BATCH], eta0[KEPLER_BATCH], beta[KEPLER_BATCH], s[KEPLER_BATCH];
+        double g0[KEPLER_BATCH], g1[KEPLER_BATCH], g2[KEPLER_BATCH], g3[KEPLER_BATCH];
+        #pragma omp simd
+        for (int p = 0; p < count; p++)
+        {
+            r0[p] = std::sqrt(x[p] * x[p] + y[p] * y[p] + z[p] * z[p]);
+            eta0[p] = x[p] * vx[p] + y[p] * vy[p] + z[p] * vz[p];
+            beta[p] = 2 * mu / r0[p] - (vx[p] * vx[p] + vy[p] * vy[p] + vz[p] * vz[p]);
+            // second order expansion of the orbit as first guess
+            s[p] = dt / r0[p] - eta0[p] * dt * dt / (2 * r0[p] * r0[p] * r0[p]);
+        }
+        // Newton's method on t(s) = r0 G1 + eta0 G2 + mu G3 = dt, whose derivative is the radius r(s)
+        for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+        {
+            calStumpff(count, beta, s, g0, g1, g2, g3);
+            double max_change(0);
+            #pragma omp simd reduction(max:max_change)
+            for (int p = 0; p < count; p++)
+            {
+                double t = r0[p] * g1[p] + eta0[p] * g2[p] + mu * g3[p];
+                double r = r0[p] * g0[p] + eta0[p] * g1[p] + mu * g2[p];
+                double ds = (t - dt) / r;
+                s[p] -= ds;
+                max_change = std::max(max_change, std::abs(ds) / (std::abs(s[p]) + 1e-300));
+            }
+            if (max_change < 1e-15)
+            {
+                break;
+            }
+        }
+        // Gauss' f and g functions
+        calStumpff(count, beta, s, g0, g1, g2, g3);
+        #pragma omp simd
+        for (int p = 0; p < count; p++)
+        {
+            double r = r0[p] * g0[p] + eta0[p] * g1[p] + mu * g2[p];
+            double f = 1 - mu * g2[p] / r0[p];
+            double g = r0[p] * g1[p] + eta0[p] * g2[p];
+            double f_dot = -mu * g1[p] / (r * r0[p]);
+            double g_dot = 1 - mu * g2[p] / r;
+            double px = x[p], py = y[p], pz = z[p];
+            x[p] = f * px + g * vx[p];
+            y[p] = f * py + g * vy[p];
+            z[p] = f * pz + g * vz[p];
+            vx[p] = f_dot * px + g_dot * vx[p];
+            vy[p] = f_dot * py + g_dot * vy[p];
+            vz[p] = f_dot * pz + g_dot * vz[p];
+        }
+    }
+}
+
+void keplerDrift(double mu, double dt, std::size_t n, double *x, double *y, double *z, double *vx, double *vy, double *vz)
+{
+    for (std::size_t begin = 0; begin < n; begin += KEPLER_BATCH)
+    {
+        int count = static_cast<int>(std::min<std::size_t>(KEPLER_BATCH, n - begin));
+        keplerBatch(mu, dt, count, x + begin, y + begin, z + begin, vx + begin, vy + begin, vz + begin);
+    }
+}
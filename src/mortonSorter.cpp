@@ -0,0 +1,132 @@
+#include "mortonSorter.hpp"
+#include "morton.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <omp.h>
+#include <utility>
+
+void MortonSorter::sort(ParticleSystem &system)
+{
+    const int n_particles = system.size();
+    const double *x = system.x(), *y = system.y(), *z = system.z();
+    // bounding cube of the particles, padded like the octree so the largest coordinate stays inside
+    #pragma omp single
+    {
+        double min_x(0), min_y(0), min_z(0), max_x(0), max_y(0), max_z(0);
+        if (n_particles > 0)
+        {
+            min_x = max_x = x[0];
+            min_y = max_y = y[0];
+            min_z = max_z = z[0];
+        }
+        for (int i = 1; i < n_particles; i++)
+        {
+            min_x = std::min(min_x, x[i]);
+            min_y = std::min(min_y, y[i]);
+            min_z = std::min(min_z, z[i]);
+            max_x = std::max(max_x, x[i]);
+            max_y = std::max(max_y, y[i]);
+            max_z = std::max(max_z, z[i]);
+        }
+        double size = std::max({max_x - min_x, max_y - min_y, max_z - min_z});
+        size = size > 0 ? size * (1 + 1e-12) : 1;
+        this->keys.resize(n_particles);
+        this->order.resize(n_particles);
+        this->scratch_keys.resize(n_particles);
+        this->scratch_order.resize(n_particles);
+        for (int i = 0; i < n_particles; i++)
+        {
+            this->keys[i] = mortonKey(x[i], y[i], z[i], min_x, min_y, min_z, size);
+            this->order[i] = i;
+        }
+    }
+    this->radixSort(n_particles);
+    this->permute(system);
+}
+
+void MortonSorter::restore(ParticleSystem &system)
+{
+    const int n_particles = system.size();
+    const int *ids = system.ids();
+    #pragma omp single
+    this->order.resize(n_particles);
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n_particles; i++)
+    {
+        this->order[ids[i]] = i;
+    }
+    this->permute(system);
+}
+
+void MortonSorter::radixSort(int n)
+{
+    const int n_threads = omp_get_num_threads();
+    const int thread = omp_get_thread_num();
+    // every thread counts and scatters its own contiguous chunk, which keeps the sort stable
+    const int begin = static_cast<long long>(n) * thread / n_threads;
+    const int end = static_cast<long long>(n) * (thread + 1) / n_threads;
+    #pragma omp single
+    this->histograms.resize(n_threads * RADIX);
+    std::size_t *histogram = this->histograms.data() + thread * RADIX;
+    for (int shift = 0; shift < 3 * MORTON_BITS; shift += RADIX_BITS)
+    {
+        std::fill(histogram, histogram + RADIX, 0);
+        for (int s = begin; s < end; s++)
+        {
+            histogram[(this->keys[s] >> shift) & (RADIX - 1)]++;
+        }
+        NBODY_BARRIER();
+        #pragma omp single
+        {
+            // exclusive prefix sum over the digits, and over the threads within a digit
+            std::size_t offset = 0;
+            this->skip_pass = false;
+            for (int digit = 0; digit < RADIX; digit++)
+            {
+                for (int t = 0; t < n_threads; t++)
+                {
+                    std::size_t count = this->histograms[t * RADIX + digit];
+                    this->histograms[t * RADIX + digit] = offset;
+                    offset += count;
+                    this->skip_pass = this->skip_pass || count == static_cast<std::size_t>(n);
+                }
+            }
+        }
+        if (this->skip_pass)
+        {
+            continue;
+        }
+        for (int s = begin; s < end; s++)
+        {
+            std::size_t target = histogram[(this->keys[s] >> shift) & (RADIX - 1)]++;
+            this->scratch_keys[target] = this->keys[s];
+            this->scratch_order[target] = this->order[s];
+        }
+        NBODY_BARRIER();
+        #pragma omp single
+        {
+            this->keys.swap(this->scratch_keys);
+            this->order.swap(this->scratch_order);
+        }
+    }
+}
+
+void MortonSorter::permute(ParticleSystem &system)
+{
+    const int n_particles = system.size();
+    #pragma omp single
+    {
+        if (this->scratch.size() != system.size() || this->scratch.stride() != system.stride())
+        {
+            this->scratch = ParticleSystem(n_particles);
+            this->scratch.reserve(system.stride());
+        }
+    }
+    const int n_threads = omp_get_num_threads();
+    const int thread = omp_get_thread_num();
+    this->scratch.gather(system, this->order.data(), static_cast<long long>(n_particles) * thread / n_threads,
+                         static_cast<long long>(n_particles) * (thread + 1) / n_threads);
+    NBODY_BARRIER();
+    #pragma omp single
+    std::swap(system, this->scratch);
+}
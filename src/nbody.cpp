@@ -1,12 +1,129 @@
 #include "nbody.hpp"
 #include "particle.hpp"
+#include "checkpoint.hpp"
+#include "profiler.hpp"
+#include "directSolver.hpp"
+#include "eulerIntegrator.hpp"
+#include "fixedSystem.hpp"
+#include "mortonSorter.hpp"
+#include "symmetricDirectSolver.hpp"
+#include "symplecticIntegrator.hpp"
+#include "tiledDirectSolver.hpp"
+#include "trajectoryWriter.hpp"
 #include "solarSystemGenerator.hpp"
+#include "randomSystemGenerator.hpp"
 #include <Eigen/Core>
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <iostream>
+#include <limits>
+#include <omp.h>
 #include <random>
 #include <chrono>
 
+namespace
+{
+    // smallest number of bodies, doubled from 16, for which Euler steps of direct summation in a parallel region
+    // beat steps on the calling thread
+    int measureParallelThreshold()
+    {
+        if (omp_get_max_threads() == 1)
+        {
+            return std::numeric_limits<int>::max();
+        }
+        DirectSolver solver;
+        EulerIntegrator integrator;
+        // start the threads before timing
+        #pragma omp parallel
+        {
+        }
+        for (int n = 16; n <= 4096; n *= 2)
+        {
+            RandomSystemGenerator generator(n - 1);
+            ParticleSystem system = generator.generateParticleSystem();
+            // about a million pair interactions per measurement, the best of three
+            const int n_steps = std::max(2, 1000000 / (n * n));
+            double serial_time = std::numeric_limits<double>::max(), parallel_time = std::numeric_limits<double>::max();
+            for (int r = 0; r < 3; r++)
+            {
+                auto start_time = std::chrono::high_resolution_clock::now();
+                integrator.integrate(system, solver, 1e-6, n_steps);
+                auto middle_time = std::chrono::high_resolution_clock::now();
+                #pragma omp parallel
+                integrator.integrate(system, solver, 1e-6, n_steps);
+                auto end_time = std::chrono::high_resolution_clock::now();
+                serial_time = std::min(serial_time, std::chrono::duration<double>(middle_time - start_time).count());
+                parallel_time = std::min(parallel_time, std::chrono::duration<double>(end_time - middle_time).count());
+            }
+            if (parallel_time < serial_time)
+            {
+                return n;
+            }
+        }
+        return std::numeric_limits<int>::max();
+    }
+
+    // steps of a system of N bodies by the fixed-size engine, returns the number of force evaluations
+    template <int N>
+    long long runFixedSystem(ParticleSystem &system, double epsilon, bool leapfrog, bool accelerations_current, double dt, int n_steps)
+    {
+        FixedSystem<N> fixed(system, epsilon);
+        if (leapfrog)
+        {
+            fixed.leapfrogSteps(dt, n_steps, accelerations_current);
+        }
+        else
+        {
+            fixed.eulerSteps(dt, n_steps);
+        }
+        fixed.copyTo(system);
+        return static_cast<long long>(N) * (n_steps + (leapfrog && !accelerations_current && n_steps > 0 ? 1 : 0));
+    }
+
+    using FixedRun = long long (*)(ParticleSystem &system, double epsilon, bool leapfrog, bool accelerations_current, double dt, int n_steps);
+
+    template <int... N>
+    std::array<FixedRun, sizeof...(N)> fixedRuns(std::integer_sequence<int, N...>)
+    {
+        return {runFixedSystem<N + 1>...};
+    }
+
+    // the fixed-size engine for a run, if it computes the same steps: a system of at most MAX_FIXED_SIZE bodies,
+    // forces summed over all pairs and Euler or leapfrog steps without recorded energies. null otherwise
+    FixedRun getFixedRun(const ParticleSystem &system, ForceSolver &solver, Integrator &integrator, int sort_interval, bool &leapfrog)
+    {
+        static const std::array<FixedRun, MAX_FIXED_SIZE> runs = fixedRuns(std::make_integer_sequence<int, MAX_FIXED_SIZE>{});
+        const int n_particles = system.size();
+        if (n_particles < 1 || n_particles > MAX_FIXED_SIZE || sort_interval > 0 || integrator.getRecordEnergy())
+        {
+            return nullptr;
+        }
+        if (!dynamic_cast<DirectSolver *>(&solver) && !dynamic_cast<SymmetricDirectSolver *>(&solver) && !dynamic_cast<TiledDirectSolver *>(&solver))
+        {
+            return nullptr;
+        }
+        auto *symplectic = dynamic_cast<SymplecticIntegrator *>(&integrator);
+        leapfrog = symplectic && symplectic->getScheme() == SymplecticScheme::Leapfrog;
+        if (!leapfrog && !dynamic_cast<EulerIntegrator *>(&integrator))
+        {
+            return nullptr;
+        }
+        return runs[n_particles - 1];
+    }
+
+    // measure the parallel threshold before a run is timed, unless the fixed-size engine takes the run and never
+    // reads it
+    void prepareParallelThreshold(const ParticleSystem &system, ForceSolver &solver, Integrator &integrator, int sort_interval)
+    {
+        bool leapfrog(false);
+        if (!getFixedRun(system, solver, integrator, sort_interval, leapfrog))
+        {
+            getParallelThreshold();
+        }
+    }
+}
+
 // return the acceleration of p1 due to p2
 Eigen::Vector3d calcAcceleration(Particle &p1, Particle &p2, double epsilon) // no default value for epsilon.
 // ! Why not shared_ptr? why shared_ptr in other functions?
@@ -19,25 +136,86 @@ Eigen::Vector3d calcAcceleration(Particle &p1, Particle &p2, double epsilon) //
 
 std::vector<std::shared_ptr<Particle>> update_Solar_System(std::vector<std::shared_ptr<Particle>> Solar_System, double dt, double total_time, int n_steps, double epsilon)
 {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    #pragma omp parallel
-    for (int n = 0; n < n_steps; n++)
-    {
-        // update the gravitational acceleration of each body
-        #pragma omp for schedule(runtime)
-        for (int i = 0; i < Solar_System.size(); i++)
+    // integrate a structure-of-arrays copy and write the result back into the same particles
+    ParticleSystem system(Solar_System);
+    update_Solar_System(system, dt, total_time, n_steps, epsilon);
+    system.copyTo(Solar_System);
+    return Solar_System;
+}
+
+std::vector<std::shared_ptr<Particle>> update_Solar_System(std::vector<std::shared_ptr<Particle>> Solar_System, ForceSolver &solver, Integrator &integrator, double dt, double total_time, int n_steps)
+{
+    ParticleSystem system(Solar_System);
+    update_Solar_System(system, solver, integrator, dt, total_time, n_steps);
+    system.copyTo(Solar_System);
+    return Solar_System;
+}
+
+void update_Solar_System(ParticleSystem &system, double dt, double total_time, int n_steps, double epsilon)
+{
+    DirectSolver solver(epsilon);
+    update_Solar_System(system, solver, dt, total_time, n_steps);
+}
+
+void update_Solar_System(ParticleSystem &system, ForceSolver &solver, double dt, double total_time, int n_steps)
+{
+    EulerIntegrator integrator;
+    update_Solar_System(system, solver, integrator, dt, total_time, n_steps);
+}
+
+long long advanceSystem(ParticleSystem &system, ForceSolver &solver, Integrator &integrator, double dt, int n_steps, int sort_interval)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Step, n_steps);
+    MortonSorter sorter;
+    long long force_evaluations(0);
+    auto run = [&]() {
+        if (sort_interval > 0)
         {
-            Solar_System[i]->updateAcceleration(Solar_System, epsilon);
+            // the integrator restarts after every re-sort, its per-particle state would refer to the old order
+            for (int done = 0; done < n_steps; done += sort_interval)
+            {
+                sorter.sort(system);
+                integrator.integrate(system, solver, dt, std::min(sort_interval, n_steps - done));
+                #pragma omp single
+                force_evaluations += integrator.getForceEvaluations();
+            }
+            // the callers see the bodies in their original order
+            sorter.restore(system);
         }
-        #pragma omp barrier
-        // update the position and velocity of each body
-        #pragma omp for schedule(runtime)
-        for (int j = 0; j < Solar_System.size(); j++)
+        else
         {
-            Solar_System[j]->update(dt);
+            integrator.integrate(system, solver, dt, n_steps);
         }
-        #pragma omp barrier
+    };
+    bool leapfrog(false);
+    const FixedRun fixed_run = getFixedRun(system, solver, integrator, sort_interval, leapfrog);
+    if (fixed_run)
+    {
+        // small systems skip the general solvers and integrators altogether, their steps are timed as forces
+        NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+        const long long force_evaluations = fixed_run(system, solver.getEpsilon(), leapfrog, integrator.getAccelerationsCurrent(), dt, n_steps);
+        NBODY_PROFILE_INTERACTIONS(force_evaluations * (static_cast<long long>(system.size()) - 1));
+        return force_evaluations;
+    }
+    if (static_cast<int>(system.size()) >= getParallelThreshold())
+    {
+        #pragma omp parallel
+        run();
+    }
+    else
+    {
+        // outside a parallel region the worksharing constructs and barriers of the steps cost next to nothing
+        run();
     }
+    return sort_interval > 0 ? force_evaluations : integrator.getForceEvaluations();
+}
+
+void update_Solar_System(ParticleSystem &system, ForceSolver &solver, Integrator &integrator, double dt, double total_time, int n_steps, int sort_interval)
+{
+    // measured before the clock starts
+    prepareParallelThreshold(system, solver, integrator, sort_interval);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    long long force_evaluations = advanceSystem(system, solver, integrator, dt, n_steps, sort_interval);
     auto end_time = std::chrono::high_resolution_clock::now();
     double elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(); // unit: ms
     double time_per_step = elapsed_time / n_steps;
@@ -54,49 +232,73 @@ std::vector<std::shared_ptr<Particle>> update_Solar_System(std::vector<std::shar
               << "time per step is "
               << time_per_step
               << " ms"
+              << std::endl
+              << "force evaluations per particle and step: "
+              << static_cast<double>(force_evaluations) / (static_cast<double>(system.size()) * n_steps)
               << std::endl;
+    std::string step_report = integrator.getStepReport();
+    if (!step_report.empty())
+    {
+        std::cout << step_report << std::endl;
+    }
+}
 
-    return Solar_System;
+int getParallelThreshold()
+{
+    static const int threshold = measureParallelThreshold();
+    return threshold;
 }
 
 void run_Solar_System(double dt, double total_time, int n_steps, double epsilon)
+{
+    DirectSolver solver(epsilon);
+    run_Solar_System(solver, dt, total_time, n_steps);
+}
+
+void run_Solar_System(ForceSolver &solver, double dt, double total_time, int n_steps)
+{
+    EulerIntegrator integrator;
+    run_Solar_System(solver, integrator, dt, total_time, n_steps);
+}
+
+void run_Solar_System(ForceSolver &solver, Integrator &integrator, double dt, double total_time, int n_steps)
 {
     // Simulation of the real solar system for one year
     // initialize the solar system
     std::shared_ptr<SolarSystemGenerator> generator = std::make_shared<SolarSystemGenerator>();
-    std::vector<std::shared_ptr<Particle>> SS_initial = generator->generateInitialConditions();
+    ParticleSystem SS = generator->generateParticleSystem();
     // print the initial position of planets in the solar system
-    for (int i = 0; i < SS_initial.size(); i++)
+    for (int i = 0; i < SS.size(); i++)
     {
         std::cout << "initial position of the "
                   << i
                   << "th planet: "
                   << std::endl
-                  << SS_initial[i]->getPosition()
+                  << SS[i].getPosition()
                   << std::endl;
     }
     #ifdef DEBUG
     // calculate the total energy of the solar system at the beginning
-    double total_energy_initial = calTotalEnergy(SS_initial);
+    double total_energy_initial = calTotalEnergy(SS);
     std::cout << "total energy of the solar system at the beginning is "
               << total_energy_initial
               << std::endl;
     #endif
-    std::vector<std::shared_ptr<Particle>> SS_updated = update_Solar_System(SS_initial, dt, total_time, n_steps, epsilon);
+    update_Solar_System(SS, solver, integrator, dt, total_time, n_steps);
     // print the final position of planets in the solar system
-    for (int i = 0; i < SS_updated.size(); i++)
+    for (int i = 0; i < SS.size(); i++)
     {
         std::cout << "final position of "
                   << i
                   << "th planet after one year and dt = "
                   << dt
                   << std::endl
-                  << SS_updated[i]->getPosition()
+                  << SS[i].getPosition()
                   << std::endl;
     }
     #ifdef DEBUG
     // calculate the total energy of the solar system
-    double total_energy_updated = calTotalEnergy(SS_updated);
+    double total_energy_updated = calTotalEnergy(SS);
     std::cout << "total energy of the solar system after one year and dt = "
               << dt
               << " is "
@@ -108,13 +310,197 @@ void run_Solar_System(double dt, double total_time, int n_steps, double epsilon)
     #endif
 }
 
+bool run_Simulation(Simulator &simulator, const CheckpointInfo &info, const std::string &checkpoint_path, TrajectoryWriter *trajectory)
+{
+    // measured before the clock starts, the chunks step without sorting
+    prepareParallelThreshold(simulator.getSystem(), simulator.getSolver(), simulator.getIntegrator(), 0);
+    const long long first_step = simulator.getSteps();
+    const long long first_evaluations = simulator.getForceEvaluations();
+    const int trajectory_interval = trajectory ? trajectory->getInterval() : 0;
+    // the step after `step` that is a multiple of interval, counted from the start of the run
+    auto next_multiple = [](long long step, int interval) { return interval > 0 ? (step / interval + 1) * interval : std::numeric_limits<long long>::max(); };
+    std::string error;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if (trajectory_interval > 0 && simulator.getSteps() % trajectory_interval == 0)
+    {
+        trajectory->submit(simulator.getSystem(), simulator.getSteps(), simulator.getTime());
+    }
+    while (simulator.getSteps() < info.target_steps)
+    {
+        // the chunks end on the output steps, so a restarted run with the same intervals makes the same calls as an
+        // uninterrupted one
+        const long long steps = simulator.getSteps();
+        long long next = std::min({info.target_steps, next_multiple(steps, info.interval), next_multiple(steps, trajectory_interval)});
+        simulator.advance(static_cast<int>(std::min<long long>(next - steps, std::numeric_limits<int>::max())));
+        if (trajectory_interval > 0 && simulator.getSteps() % trajectory_interval == 0)
+        {
+            trajectory->submit(simulator.getSystem(), simulator.getSteps(), simulator.getTime());
+        }
+        if (checkpoint_path.empty() || (simulator.getSteps() < info.target_steps && (info.interval <= 0 || simulator.getSteps() % info.interval != 0)))
+        {
+            continue;
+        }
+        if (!writeCheckpoint(checkpoint_path, simulator, info, error))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return false;
+        }
+        // a restart from the checkpoint has a fresh integrator, so the run goes on from the same state as it would
+        simulator.getIntegrator().clearState();
+        std::cout << "checkpoint at step "
+                  << simulator.getSteps()
+                  << " (t = "
+                  << simulator.getTime()
+                  << ") written to "
+                  << checkpoint_path
+                  << std::endl;
+    }
+    // the time waiting for the last frames counts, the stepping cannot end before they are on disk
+    bool trajectory_written = !trajectory || trajectory->close();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    double elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(); // unit: ms
+    const long long n_steps = simulator.getSteps() - first_step;
+    std::cout << "dt = "
+              << simulator.getDt()
+              << " (year/2Pi). steps "
+              << first_step
+              << " to "
+              << simulator.getSteps()
+              << std::endl
+              << "Running time =  "
+              << elapsed_time
+              << " ms. "
+              << "time per step is "
+              << (n_steps > 0 ? elapsed_time / n_steps : 0)
+              << " ms"
+              << std::endl
+              << "force evaluations per particle and step: "
+              << (n_steps > 0 ? static_cast<double>(simulator.getForceEvaluations() - first_evaluations) / (static_cast<double>(simulator.getSystem().size()) * n_steps) : 0)
+              << std::endl;
+    if (trajectory)
+    {
+        std::cout << "trajectory: "
+                  << trajectory->getWritten()
+                  << " frames written, "
+                  << trajectory->getDropped()
+                  << " dropped, "
+                  << trajectory->getStalls()
+                  << " waits for the writer ("
+                  << trajectory->getStallTime()
+                  << " ms)"
+                  << std::endl;
+        if (!trajectory_written)
+        {
+            std::cerr << "Error: the trajectory could not be written completely." << std::endl;
+        }
+    }
+    double total_energy_updated = calTotalEnergy(simulator.getSystem(), info.epsilon);
+    std::cout << "total energy at the beginning of the run is "
+              << info.initial_energy
+              << std::endl
+              << "total energy at t = "
+              << simulator.getTime()
+              << " is "
+              << total_energy_updated
+              << std::endl
+              << "relative energy error is "
+              << std::abs((total_energy_updated - info.initial_energy) / info.initial_energy)
+              << std::endl;
+    return trajectory_written;
+}
+
+void run_Ensemble(int num_planets, int first_seed, int n_seeds, double epsilon, EnsembleScheme scheme, double dt, double total_time, int n_steps)
+{
+    std::vector<ParticleSystem> systems;
+    systems.reserve(n_seeds);
+    for (int seed = first_seed; seed < first_seed + n_seeds; seed++)
+    {
+        RandomSystemGenerator generator(num_planets, seed, epsilon);
+        systems.push_back(generator.generateParticleSystem());
+    }
+    EnsembleSystem ensemble(systems, epsilon);
+    std::vector<double> initial_energies = ensemble.calTotalEnergies();
+    auto start_time = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel
+    ensemble.integrate(scheme, dt, n_steps);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::vector<double> final_energies = ensemble.calTotalEnergies();
+    double elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count(); // unit: ms
+    std::cout << "dt = "
+              << dt
+              << " (year/2Pi). Total time = "
+              << total_time
+              << " year, step = "
+              << n_steps
+              << ", systems = "
+              << n_seeds
+              << " of "
+              << ensemble.getBodies()
+              << " bodies"
+              << std::endl
+              << "Running time =  "
+              << elapsed_time
+              << " ms. "
+              << "time per system and step is "
+              << elapsed_time / (static_cast<double>(n_steps) * n_seeds)
+              << " ms"
+              << std::endl;
+    std::cout << "| seed | initial energy | final energy | relative energy drift |" << std::endl
+              << "| --- | --- | --- | --- |" << std::endl;
+    for (int k = 0; k < n_seeds; k++)
+    {
+        std::cout << "| "
+                  << first_seed + k
+                  << " | "
+                  << initial_energies[k]
+                  << " | "
+                  << final_energies[k]
+                  << " | "
+                  << std::abs((final_energies[k] - initial_energies[k]) / initial_energies[k])
+                  << " |"
+                  << std::endl;
+    }
+}
+
 double calTotalEnergy(const std::vector<std::shared_ptr<Particle>> &Solar_System)
 {
+    return calTotalEnergy(ParticleSystem(Solar_System));
+}
+
+double calTotalEnergy(const ParticleSystem &system, double epsilon)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Energy);
+    const int n_particles = system.size();
+    const double epsilon2 = epsilon * epsilon;
+    const double *m = system.masses(), *x = system.x(), *y = system.y(), *z = system.z();
+    double total_energy(0);
+    // every pair once, the triangular rows are handed out dynamically to balance the load
+    #pragma omp parallel for reduction(+:total_energy) schedule(dynamic, 16)
+    for (int i = 0; i < n_particles; i++)
+    {
+        double potential(0);
+        #pragma omp simd reduction(+:potential)
+        for (int j = i + 1; j < n_particles; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            potential += m[j] / std::sqrt(dx * dx + dy * dy + dz * dz + epsilon2);
+        }
+        total_energy += system.calKineticEnergy(i) - m[i] * potential;
+    }
+    return total_energy;
+}
+
+double calTotalEnergyFromPotentials(const ParticleSystem &system)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Energy);
+    const int n_particles = system.size();
+    const double *m = system.masses(), *phi = system.potentials();
     double total_energy(0);
-    #pragma omp parallel for reduction(+:total_energy) schedule(runtime)
-    for (int i = 0; i < Solar_System.size(); i++)
+    for (int i = 0; i < n_particles; i++)
     {
-        total_energy += (Solar_System[i]->calKineticEnergy() + Solar_System[i]->calPotentialEnergy(Solar_System));
+        total_energy += system.calKineticEnergy(i) + 0.5 * m[i] * phi[i];
     }
     return total_energy;
-}
\ No newline at end of file
+}
@@ -0,0 +1,221 @@
+#include "octree.hpp"
+#include "morton.hpp"
+#include <algorithm>
+
+namespace
+{
+    // the top levels are built serially, the cells at this level become independent subtrees
+    constexpr int SPLIT_LEVEL = 2;
+
+    // set the mass and centre of mass of an internal cell from its children
+    void summarise(std::vector<OctreeNode> &nodes, int index)
+    {
+        OctreeNode &node = nodes[index];
+        double mass(0), x(0), y(0), z(0);
+        for (int c = node.first_child; c < node.first_child + node.n_children; c++)
+        {
+            mass += nodes[c].mass;
+            x += nodes[c].mass * nodes[c].x;
+            y += nodes[c].mass * nodes[c].y;
+            z += nodes[c].mass * nodes[c].z;
+        }
+        node.mass = mass;
+        node.x = mass > 0 ? x / mass : node.cx;
+        node.y = mass > 0 ? y / mass : node.cy;
+        node.z = mass > 0 ? z / mass : node.cz;
+    }
+}
+
+Octree::Octree(int leaf_size) : leaf_size{leaf_size}, n_top{0}
+{
+}
+
+const std::vector<OctreeNode> &Octree::getNodes() const
+{
+    return this->nodes;
+}
+
+const std::vector<int> &Octree::getSubtreeRoots() const
+{
+    return this->subtree_roots;
+}
+
+int Octree::getTopCount() const
+{
+    return this->n_top;
+}
+
+void Octree::buildNode(std::vector<OctreeNode> &nodes, int index, int begin, int end, int level, double cx, double cy, double cz, double size, bool top)
+{
+    OctreeNode node{cx, cy, cz, 0, cx, cy, cz, size, -1, 0, begin, end};
+    if (end - begin <= this->leaf_size || level == MORTON_BITS)
+    {
+        // leaf: centre of mass of its particles
+        double x(0), y(0), z(0);
+        for (int p = begin; p < end; p++)
+        {
+            node.mass += this->sorted_mass[p];
+            x += this->sorted_mass[p] * this->sorted_x[p];
+            y += this->sorted_mass[p] * this->sorted_y[p];
+            z += this->sorted_mass[p] * this->sorted_z[p];
+        }
+        if (node.mass > 0)
+        {
+            node.x = x / node.mass;
+            node.y = y / node.mass;
+            node.z = z / node.mass;
+        }
+        nodes[index] = node;
+        if (top)
+        {
+            this->subtree_roots.push_back(index);
+        }
+        return;
+    }
+    if (top && level == SPLIT_LEVEL)
+    {
+        this->deferred.push_back({index, begin, end, level, cx, cy, cz, size});
+        this->subtree_roots.push_back(index);
+        nodes[index] = node;
+        return;
+    }
+    // the particles of each octant are contiguous in Morton order
+    const int shift = 3 * (MORTON_BITS - 1 - level);
+    int child_begin[8], child_end[8], child_octant[8];
+    int n_children = 0;
+    int start = begin;
+    for (int octant = 0; octant < 8; octant++)
+    {
+        auto stop = std::partition_point(this->keys.begin() + start, this->keys.begin() + end, [shift, octant](const std::pair<std::uint64_t, int> &key) {
+            return static_cast<int>((key.first >> shift) & 7) <= octant;
+        });
+        int stop_index = stop - this->keys.begin();
+        if (stop_index > start)
+        {
+            child_begin[n_children] = start;
+            child_end[n_children] = stop_index;
+            child_octant[n_children] = octant;
+            n_children++;
+        }
+        start = stop_index;
+    }
+    node.first_child = nodes.size();
+    node.n_children = n_children;
+    nodes.resize(nodes.size() + n_children);
+    const double quarter = size / 4;
+    for (int c = 0; c < n_children; c++)
+    {
+        // the octant holds the x, y and z bits from high to low
+        double child_cx = cx + (child_octant[c] & 4 ? quarter : -quarter);
+        double child_cy = cy + (child_octant[c] & 2 ? quarter : -quarter);
+        double child_cz = cz + (child_octant[c] & 1 ? quarter : -quarter);
+        this->buildNode(nodes, node.first_child + c, child_begin[c], child_end[c], level + 1, child_cx, child_cy, child_cz, size / 2, top);
+    }
+    nodes[index] = node;
+    summarise(nodes, index);
+}
+
+void Octree::build(const ParticleSystem &system)
+{
+    const int n_particles = system.size();
+    const double *m = system.masses(), *x = system.x(), *y = system.y(), *z = system.z();
+    // bounding cube of the particles
+    #pragma omp single
+    {
+        double max_x(0), max_y(0), max_z(0);
+        this->min_x = this->min_y = this->min_z = 0;
+        if (n_particles > 0)
+        {
+            max_x = this->min_x = x[0];
+            max_y = this->min_y = y[0];
+            max_z = this->min_z = z[0];
+        }
+        for (int i = 1; i < n_particles; i++)
+        {
+            this->min_x = std::min(this->min_x, x[i]);
+            this->min_y = std::min(this->min_y, y[i]);
+            this->min_z = std::min(this->min_z, z[i]);
+            max_x = std::max(max_x, x[i]);
+            max_y = std::max(max_y, y[i]);
+            max_z = std::max(max_z, z[i]);
+        }
+        this->box_size = std::max({max_x - this->min_x, max_y - this->min_y, max_z - this->min_z});
+        // keep the largest coordinate inside the cube
+        this->box_size = this->box_size > 0 ? this->box_size * (1 + 1e-12) : 1;
+        this->keys.resize(n_particles);
+        this->sorted_mass.resize(n_particles);
+        this->sorted_x.resize(n_particles);
+        this->sorted_y.resize(n_particles);
+        this->sorted_z.resize(n_particles);
+    }
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n_particles; i++)
+    {
+        this->keys[i] = {mortonKey(x[i], y[i], z[i], this->min_x, this->min_y, this->min_z, this->box_size), i};
+    }
+    #pragma omp single
+    std::sort(this->keys.begin(), this->keys.end());
+    #pragma omp for schedule(static)
+    for (int s = 0; s < n_particles; s++)
+    {
+        int i = this->keys[s].second;
+        this->sorted_mass[s] = m[i];
+        this->sorted_x[s] = x[i];
+        this->sorted_y[s] = y[i];
+        this->sorted_z[s] = z[i];
+    }
+    // top levels of the tree
+    #pragma omp single
+    {
+        const double half = this->box_size / 2;
+        this->nodes.assign(1, OctreeNode{});
+        this->deferred.clear();
+        this->subtree_roots.clear();
+        this->buildNode(this->nodes, 0, 0, n_particles, 0, this->min_x + half, this->min_y + half, this->min_z + half, this->box_size, true);
+        this->subtrees.resize(this->deferred.size());
+        this->n_top = this->nodes.size();
+    }
+    // independent subtrees in parallel
+    const int n_deferred = this->deferred.size();
+    #pragma omp for schedule(dynamic, 1)
+    for (int k = 0; k < n_deferred; k++)
+    {
+        const DeferredCell &cell = this->deferred[k];
+        this->subtrees[k].assign(1, OctreeNode{});
+        this->buildNode(this->subtrees[k], 0, cell.begin, cell.end, cell.level, cell.cx, cell.cy, cell.cz, cell.size, false);
+    }
+    // attach the subtrees and summarise the top levels
+    #pragma omp single
+    {
+        for (int k = 0; k < n_deferred; k++)
+        {
+            const std::vector<OctreeNode> &subtree = this->subtrees[k];
+            const int root = this->deferred[k].node;
+            const int base = this->nodes.size() - 1;
+            for (std::size_t l = 0; l < subtree.size(); l++)
+            {
+                OctreeNode node = subtree[l];
+                if (node.first_child >= 0)
+                {
+                    node.first_child += base;
+                }
+                if (l == 0)
+                {
+                    this->nodes[root] = node;
+                }
+                else
+                {
+                    this->nodes.push_back(node);
+                }
+            }
+        }
+        // children of the top cells have larger indices than their parents
+        for (int index = this->n_top - 1; index >= 0; index--)
+        {
+            if (this->nodes[index].first_child >= 0)
+            {
+                summarise(this->nodes, index);
+            }
+        }
+    }
+}
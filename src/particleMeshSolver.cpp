@@ -0,0 +1,163 @@
+#include "particleMeshSolver.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // mean of 1/r over a cube of unit edge centred on the origin, the potential of a node due to itself
+    constexpr double SELF_POTENTIAL = 2.38008;
+}
+
+ParticleMeshSolver::ParticleMeshSolver(double epsilon, int grid_size, MassAssignment assignment) : ForceSolver(epsilon), grid_size{nextPowerOfTwo(std::max(grid_size, 8))}, assignment{assignment}, fft(2 * nextPowerOfTwo(std::max(grid_size, 8)))
+{
+    // -1/r on the padded grid, with distances folded so the second half stands for negative offsets
+    const int n = this->fft.size();
+    this->green.resize(static_cast<std::size_t>(n) * n * n);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            for (int k = 0; k < n; k++)
+            {
+                double di = std::min(i, n - i), dj = std::min(j, n - j), dk = std::min(k, n - k);
+                double r = std::sqrt(di * di + dj * dj + dk * dk);
+                this->green[(static_cast<std::size_t>(i) * n + j) * n + k] = r > 0 ? -1 / r : -SELF_POTENTIAL;
+            }
+        }
+    }
+    this->fft.transform(this->green.data(), false);
+}
+
+int ParticleMeshSolver::getGridSize() const
+{
+    return this->grid_size;
+}
+
+int ParticleMeshSolver::weights(double u, int *nodes, double *w) const
+{
+    if (this->assignment == MassAssignment::CIC)
+    {
+        int i = static_cast<int>(std::floor(u));
+        double f = u - i;
+        nodes[0] = i;
+        nodes[1] = i + 1;
+        w[0] = 1 - f;
+        w[1] = f;
+        return 2;
+    }
+    int i = static_cast<int>(std::floor(u + 0.5));
+    double d = u - i;
+    nodes[0] = i - 1;
+    nodes[1] = i;
+    nodes[2] = i + 1;
+    w[0] = 0.5 * (0.5 - d) * (0.5 - d);
+    w[1] = 0.75 - d * d;
+    w[2] = 0.5 * (0.5 + d) * (0.5 + d);
+    return 3;
+}
+
+void ParticleMeshSolver::computeAccelerations(ParticleSystem &system)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+    const int n_particles = system.size();
+    const int m = this->grid_size;
+    const int n = this->fft.size();
+    const std::size_t n_nodes = static_cast<std::size_t>(n) * n * n;
+    const double *mass = system.masses(), *x = system.x(), *y = system.y(), *z = system.z();
+    // grid over the bounding cube, with two spare nodes on each side for the assignment stencil and the differences
+    #pragma omp single
+    {
+        double min_x(0), min_y(0), min_z(0), max_x(0), max_y(0), max_z(0);
+        if (n_particles > 0)
+        {
+            min_x = max_x = x[0];
+            min_y = max_y = y[0];
+            min_z = max_z = z[0];
+        }
+        for (int i = 1; i < n_particles; i++)
+        {
+            min_x = std::min(min_x, x[i]);
+            min_y = std::min(min_y, y[i]);
+            min_z = std::min(min_z, z[i]);
+            max_x = std::max(max_x, x[i]);
+            max_y = std::max(max_y, y[i]);
+            max_z = std::max(max_z, z[i]);
+        }
+        double extent = std::max({max_x - min_x, max_y - min_y, max_z - min_z});
+        this->spacing = extent > 0 ? extent / (m - 5) : 1;
+        this->origin_x = (min_x + max_x) / 2 - this->spacing * (m - 1) / 2;
+        this->origin_y = (min_y + max_y) / 2 - this->spacing * (m - 1) / 2;
+        this->origin_z = (min_z + max_z) / 2 - this->spacing * (m - 1) / 2;
+        this->mesh.resize(n_nodes);
+    }
+    #pragma omp for schedule(static)
+    for (std::size_t node = 0; node < n_nodes; node++)
+    {
+        this->mesh[node] = 0;
+    }
+    // mass assignment into the first grid_size nodes of each dimension
+    const double inv_spacing = 1 / this->spacing;
+    #pragma omp for schedule(static)
+    for (int p = 0; p < n_particles; p++)
+    {
+        int ni[3], nj[3], nk[3];
+        double wi[3], wj[3], wk[3];
+        int count = this->weights((x[p] - this->origin_x) * inv_spacing, ni, wi);
+        this->weights((y[p] - this->origin_y) * inv_spacing, nj, wj);
+        this->weights((z[p] - this->origin_z) * inv_spacing, nk, wk);
+        for (int a = 0; a < count; a++)
+        {
+            for (int b = 0; b < count; b++)
+            {
+                for (int c = 0; c < count; c++)
+                {
+                    double *node = reinterpret_cast<double *>(&this->mesh[(static_cast<std::size_t>(ni[a]) * n + nj[b]) * n + nk[c]]);
+                    #pragma omp atomic
+                    node[0] += mass[p] * wi[a] * wj[b] * wk[c];
+                }
+            }
+        }
+    }
+    // potential = density convolved with -1/r, the Green's function scales as 1 / spacing
+    this->fft.transform(this->mesh.data(), false);
+    #pragma omp for schedule(static)
+    for (std::size_t node = 0; node < n_nodes; node++)
+    {
+        this->mesh[node] *= this->green[node] * inv_spacing;
+    }
+    this->fft.transform(this->mesh.data(), true);
+    // acceleration = -grad(potential) by central differences, interpolated with the assignment weights
+    double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    auto potential = [this, n](int i, int j, int k) {
+        return this->mesh[(static_cast<std::size_t>(i) * n + j) * n + k].real();
+    };
+    const double factor = -0.5 * inv_spacing;
+    #pragma omp for schedule(static)
+    for (int p = 0; p < n_particles; p++)
+    {
+        int ni[3], nj[3], nk[3];
+        double wi[3], wj[3], wk[3];
+        int count = this->weights((x[p] - this->origin_x) * inv_spacing, ni, wi);
+        this->weights((y[p] - this->origin_y) * inv_spacing, nj, wj);
+        this->weights((z[p] - this->origin_z) * inv_spacing, nk, wk);
+        double acc_x(0), acc_y(0), acc_z(0);
+        for (int a = 0; a < count; a++)
+        {
+            for (int b = 0; b < count; b++)
+            {
+                for (int c = 0; c < count; c++)
+                {
+                    const int i = ni[a], j = nj[b], k = nk[c];
+                    const double w = wi[a] * wj[b] * wk[c];
+                    acc_x += w * (potential(i + 1, j, k) - potential(i - 1, j, k));
+                    acc_y += w * (potential(i, j + 1, k) - potential(i, j - 1, k));
+                    acc_z += w * (potential(i, j, k + 1) - potential(i, j, k - 1));
+                }
+            }
+        }
+        ax[p] = factor * acc_x;
+        ay[p] = factor * acc_y;
+        az[p] = factor * acc_z;
+    }
+}
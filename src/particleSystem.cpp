@@ -0,0 +1,237 @@
+#include "particleSystem.hpp"
+#include "particle.hpp"
+#include <Eigen/Core>
+#include <cmath>
+
+namespace
+{
+    // round the number of particles up to a whole number of cache lines of doubles
+    std::size_t paddedSize(std::size_t n)
+    {
+        return (n + 7) / 8 * 8;
+    }
+
+    // move the x, y and z blocks of a buffer from the old stride to the new stride
+    void relayout(AlignedVector<double> &buffer, std::size_t old_stride, std::size_t new_stride)
+    {
+        AlignedVector<double> resized(3 * new_stride, 0.0);
+        for (std::size_t d = 0; d < 3; d++)
+        {
+            for (std::size_t i = 0; i < old_stride; i++)
+            {
+                resized[d * new_stride + i] = buffer[d * old_stride + i];
+            }
+        }
+        buffer.swap(resized);
+    }
+}
+
+ParticleView::ParticleView(ParticleSystem &system, std::size_t index) : system{system}, index{index}
+{
+}
+
+Vector3dView ParticleView::getPosition()
+{
+    return Vector3dView(this->system.x() + this->index, 3, Eigen::InnerStride<>(this->system.stride()));
+}
+
+Vector3dView ParticleView::getVelocity()
+{
+    return Vector3dView(this->system.vx() + this->index, 3, Eigen::InnerStride<>(this->system.stride()));
+}
+
+Vector3dView ParticleView::getAcceleration()
+{
+    return Vector3dView(this->system.ax() + this->index, 3, Eigen::InnerStride<>(this->system.stride()));
+}
+
+const double &ParticleView::getMass()
+{
+    return this->system.masses()[this->index];
+}
+
+void ParticleView::update(double dt)
+{
+    this->system.update(this->index, dt);
+}
+
+void ParticleView::setAcceleration(const Eigen::Vector3d &acceleration)
+{
+    this->getAcceleration() = acceleration;
+}
+
+void ParticleView::setVelocity(const Eigen::Vector3d &velocity)
+{
+    this->getVelocity() = velocity;
+}
+
+void ParticleView::setPosition(const Eigen::Vector3d &position)
+{
+    this->getPosition() = position;
+}
+
+double ParticleView::calKineticEnergy()
+{
+    return this->system.calKineticEnergy(this->index);
+}
+
+ParticleSystem::ParticleSystem() : ParticleSystem(0)
+{
+}
+
+ParticleSystem::ParticleSystem(std::size_t n) : n{n}, capacity{paddedSize(n)}, mass(paddedSize(n), 0.0), position(3 * paddedSize(n), 0.0), velocity(3 * paddedSize(n), 0.0), acceleration(3 * paddedSize(n), 0.0), potential(paddedSize(n), 0.0), id(paddedSize(n), -1)
+{
+    for (std::size_t i = 0; i < n; i++)
+    {
+        this->id[i] = i;
+    }
+}
+
+ParticleSystem::ParticleSystem(const std::vector<std::shared_ptr<Particle>> &p_list) : ParticleSystem()
+{
+    this->reserve(p_list.size());
+    for (const auto &p : p_list)
+    {
+        this->addParticle(p->getMass(), p->getPosition(), p->getVelocity(), p->getAcceleration());
+    }
+}
+
+void ParticleSystem::reserve(std::size_t n)
+{
+    std::size_t new_capacity = paddedSize(n);
+    if (new_capacity <= this->capacity)
+    {
+        return;
+    }
+    this->mass.resize(new_capacity, 0.0);
+    this->potential.resize(new_capacity, 0.0);
+    this->id.resize(new_capacity, -1);
+    relayout(this->position, this->capacity, new_capacity);
+    relayout(this->velocity, this->capacity, new_capacity);
+    relayout(this->acceleration, this->capacity, new_capacity);
+    this->capacity = new_capacity;
+}
+
+void ParticleSystem::addParticle(double mass, const Eigen::Vector3d &position, const Eigen::Vector3d &velocity, const Eigen::Vector3d &acceleration)
+{
+    if (this->n == this->capacity)
+    {
+        this->reserve(2 * this->capacity + 8);
+    }
+    std::size_t i = this->n++;
+    this->mass[i] = mass;
+    this->id[i] = i;
+    (*this)[i].setPosition(position);
+    (*this)[i].setVelocity(velocity);
+    (*this)[i].setAcceleration(acceleration);
+}
+
+ParticleView ParticleSystem::operator[](std::size_t i)
+{
+    return ParticleView(*this, i);
+}
+
+void ParticleSystem::update(std::size_t i, double dt)
+{
+    double *px = this->x(), *py = this->y(), *pz = this->z();
+    double *pvx = this->vx(), *pvy = this->vy(), *pvz = this->vz();
+    px[i] += pvx[i] * dt;
+    py[i] += pvy[i] * dt;
+    pz[i] += pvz[i] * dt;
+    pvx[i] += this->ax()[i] * dt;
+    pvy[i] += this->ay()[i] * dt;
+    pvz[i] += this->az()[i] * dt;
+}
+
+void ParticleSystem::updateAcceleration(std::size_t i, double epsilon)
+{
+    const double *px = this->x(), *py = this->y(), *pz = this->z(), *m = this->masses();
+    double epsilon2 = epsilon * epsilon;
+    double acc_x(0), acc_y(0), acc_z(0);
+    for (std::size_t j = 0; j < this->n; j++)
+    {
+        if (j != i)
+        {
+            double dx = px[j] - px[i];
+            double dy = py[j] - py[i];
+            double dz = pz[j] - pz[i];
+            double r2 = dx * dx + dy * dy + dz * dz + epsilon2;
+            double factor = m[j] / (r2 * std::sqrt(r2));
+            acc_x += factor * dx;
+            acc_y += factor * dy;
+            acc_z += factor * dz;
+        }
+    }
+    this->ax()[i] = acc_x;
+    this->ay()[i] = acc_y;
+    this->az()[i] = acc_z;
+}
+
+double ParticleSystem::calKineticEnergy(std::size_t i) const
+{
+    double v2 = this->vx()[i] * this->vx()[i] + this->vy()[i] * this->vy()[i] + this->vz()[i] * this->vz()[i];
+    return 0.5 * this->mass[i] * v2;
+}
+
+double ParticleSystem::calPotentialEnergy(std::size_t i) const
+{
+    const double *px = this->x(), *py = this->y(), *pz = this->z(), *m = this->masses();
+    double potential_energy = 0;
+    for (std::size_t j = 0; j < this->n; j++)
+    {
+        if (j != i)
+        {
+            double dx = px[j] - px[i];
+            double dy = py[j] - py[i];
+            double dz = pz[j] - pz[i];
+            potential_energy += -0.5 * m[i] * m[j] / std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+    }
+    return potential_energy;
+}
+
+void ParticleSystem::gather(const ParticleSystem &source, const int *order, std::size_t begin, std::size_t end)
+{
+    const std::size_t stride = this->capacity, source_stride = source.capacity;
+    for (std::size_t s = begin; s < end; s++)
+    {
+        const std::size_t i = order[s];
+        this->mass[s] = source.mass[i];
+        this->potential[s] = source.potential[i];
+        this->id[s] = source.id[i];
+        for (std::size_t d = 0; d < 3; d++)
+        {
+            this->position[d * stride + s] = source.position[d * source_stride + i];
+            this->velocity[d * stride + s] = source.velocity[d * source_stride + i];
+            this->acceleration[d * stride + s] = source.acceleration[d * source_stride + i];
+        }
+    }
+}
+
+void ParticleSystem::copyTo(const std::vector<std::shared_ptr<Particle>> &p_list) const
+{
+    for (std::size_t i = 0; i < this->n; i++)
+    {
+        const std::size_t k = this->id[i];
+        if (k < p_list.size())
+        {
+            p_list[k]->setPosition({this->x()[i], this->y()[i], this->z()[i]});
+            p_list[k]->setVelocity({this->vx()[i], this->vy()[i], this->vz()[i]});
+            p_list[k]->setAcceleration({this->ax()[i], this->ay()[i], this->az()[i]});
+        }
+    }
+}
+
+std::vector<std::shared_ptr<Particle>> ParticleSystem::toParticles() const
+{
+    std::vector<std::shared_ptr<Particle>> p_list(this->n);
+    for (std::size_t i = 0; i < this->n; i++)
+    {
+        p_list[this->id[i]] = std::make_shared<Particle>(
+            this->mass[i],
+            Eigen::Vector3d(this->x()[i], this->y()[i], this->z()[i]),
+            Eigen::Vector3d(this->vx()[i], this->vy()[i], this->vz()[i]),
+            Eigen::Vector3d(this->ax()[i], this->ay()[i], this->az()[i]));
+    }
+    return p_list;
+}
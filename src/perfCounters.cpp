@@ -0,0 +1,163 @@
+#include "perfCounters.hpp"
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    const char *const EVENT_NAMES[PERF_EVENTS] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+    // type and config of each event for perf_event_open
+    void describeEvent(PerfEvent event, perf_event_attr &attr)
+    {
+        constexpr std::uint64_t read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        switch (event)
+        {
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+            break;
+        case PerfEvent::LlcMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | read_miss;
+            break;
+        default:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+    }
+
+    // open an event counting the user space of the calling thread on any CPU, in the group of leader (-1 to lead)
+    int openEvent(PerfEvent event, int leader)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        describeEvent(event, attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+    }
+
+    // the group of events of one thread, in the order they were opened, closed when the thread exits
+    struct ThreadGroup
+    {
+        bool opened = false;
+        int n_fds = 0;
+        std::array<int, PERF_EVENTS> fds{};
+        std::array<PerfEvent, PERF_EVENTS> events{};
+
+        // open the events marked in wanted, or those that open if available is null, noting them in it
+        void open(const std::array<bool, PERF_EVENTS> &wanted, std::array<bool, PERF_EVENTS> *available)
+        {
+            this->opened = true;
+            for (int e = 0; e < PERF_EVENTS; e++)
+            {
+                if (!wanted[e])
+                {
+                    continue;
+                }
+                const int fd = openEvent(static_cast<PerfEvent>(e), this->n_fds > 0 ? this->fds[0] : -1);
+                if (fd >= 0)
+                {
+                    this->fds[this->n_fds] = fd;
+                    this->events[this->n_fds] = static_cast<PerfEvent>(e);
+                    this->n_fds++;
+                }
+                if (available)
+                {
+                    (*available)[e] = fd >= 0;
+                }
+            }
+        }
+
+        ~ThreadGroup()
+        {
+            for (int k = 0; k < this->n_fds; k++)
+            {
+                close(this->fds[k]);
+            }
+        }
+    };
+
+    thread_local ThreadGroup group;
+}
+
+const char *perfEventName(PerfEvent event)
+{
+    return EVENT_NAMES[static_cast<int>(event)];
+}
+
+PerfCounters &PerfCounters::get()
+{
+    static PerfCounters counters;
+    return counters;
+}
+
+bool PerfCounters::start(std::string &error)
+{
+    if (this->isActive())
+    {
+        return true;
+    }
+    if (group.opened)
+    {
+        error = "the counters of this thread were already tried";
+        return false;
+    }
+    std::array<bool, PERF_EVENTS> wanted;
+    wanted.fill(true);
+    errno = 0;
+    group.open(wanted, &this->available);
+    if (group.n_fds == 0)
+    {
+        error = std::string("perf_event_open failed: ") + std::strerror(errno);
+        return false;
+    }
+    this->active = true;
+    return true;
+}
+
+bool PerfCounters::isAvailable(PerfEvent event) const
+{
+    return this->available[static_cast<int>(event)];
+}
+
+bool PerfCounters::read(PerfValues &values)
+{
+    values.fill(0);
+    if (!group.opened)
+    {
+        // a worker thread opens the events found on the thread that started the counters
+        group.open(this->available, nullptr);
+    }
+    if (group.n_fds == 0)
+    {
+        return false;
+    }
+    // the number of events, the times enabled and running, then the values in the order of opening
+    std::array<std::uint64_t, 3 + PERF_EVENTS> buffer;
+    const ssize_t expected = (3 + group.n_fds) * sizeof(std::uint64_t);
+    if (::read(group.fds[0], buffer.data(), expected) != expected || buffer[2] == 0)
+    {
+        return false;
+    }
+    const double scale = static_cast<double>(buffer[1]) / buffer[2];
+    for (int k = 0; k < group.n_fds; k++)
+    {
+        values[static_cast<int>(group.events[k])] = static_cast<std::uint64_t>(buffer[3 + k] * scale);
+    }
+    return true;
+}
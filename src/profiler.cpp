@@ -0,0 +1,223 @@
+#include "profiler.hpp"
+#include "tracer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char *const PHASE_NAMES[PROFILE_PHASES] = {"force", "integration", "energy", "io", "barrier", "step"};
+}
+
+const char *profilePhaseName(ProfilePhase phase)
+{
+    return PHASE_NAMES[static_cast<int>(phase)];
+}
+
+ProfileScope::ProfileScope(ProfilePhase phase, long long count) : phase{phase}, count{count}, start{std::chrono::steady_clock::now()}
+{
+    // read last, and first at the end, so that the counts leave out the scope itself
+    PerfCounters &counters = PerfCounters::get();
+    this->counting = counters.isActive() && counters.read(this->events_start);
+}
+
+ProfileScope::~ProfileScope()
+{
+    PerfValues events;
+    if (this->counting && PerfCounters::get().read(events))
+    {
+        for (int e = 0; e < PERF_EVENTS; e++)
+        {
+            events[e] -= this->events_start[e];
+        }
+        Profiler::get().recordEvents(this->phase, events);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    Profiler::get().record(this->phase, std::chrono::duration<double>(end - this->start).count(), this->count);
+    Tracer &tracer = Tracer::get();
+    if (tracer.isActive())
+    {
+        tracer.record(this->phase, this->start, end);
+    }
+}
+
+Profiler &Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::~Profiler()
+{
+    if (this->report_path.empty())
+    {
+        return;
+    }
+    std::ofstream file(this->report_path);
+    this->writeReport(file);
+    if (!file)
+    {
+        std::cerr << "Error: cannot write the profile to " << this->report_path << "." << std::endl;
+    }
+}
+
+bool Profiler::isEnabled()
+{
+    #ifdef NBODY_PROFILE
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+Profiler::ThreadCounters &Profiler::local()
+{
+    thread_local ThreadCounters *counters = nullptr;
+    if (!counters)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->threads.push_back(std::make_unique<ThreadCounters>());
+        counters = this->threads.back().get();
+    }
+    return *counters;
+}
+
+void Profiler::record(ProfilePhase phase, double seconds, long long count)
+{
+    ThreadCounters &counters = this->local();
+    const int p = static_cast<int>(phase);
+    counters.seconds[p] += seconds;
+    counters.occurrences[p] += count;
+    const double nanoseconds = seconds * 1e9 / std::max(count, 1LL);
+    const int bin = nanoseconds < 1 ? 0 : std::min(std::ilogb(nanoseconds), PROFILE_BINS - 1);
+    counters.histogram[p][bin] += count;
+}
+
+void Profiler::recordEvents(ProfilePhase phase, const PerfValues &events)
+{
+    PerfValues &totals = this->local().events[static_cast<int>(phase)];
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        totals[e] += events[e];
+    }
+}
+
+void Profiler::addInteractions(long long interactions)
+{
+    this->local().interactions += interactions;
+}
+
+void Profiler::reset()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto &counters : this->threads)
+    {
+        *counters = ThreadCounters();
+    }
+}
+
+void Profiler::setReportPath(const std::string &path)
+{
+    this->report_path = path;
+}
+
+void Profiler::writeReport(std::ostream &out) const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    long long interactions(0);
+    for (const auto &counters : this->threads)
+    {
+        interactions += counters->interactions;
+    }
+    double force_seconds(0);
+    const PerfCounters &perf_counters = PerfCounters::get();
+    out << "{\n"
+        << "  \"enabled\": " << (isEnabled() ? "true" : "false") << ",\n"
+        << "  \"hardware_counters\": " << (perf_counters.isActive() ? "true" : "false") << ",\n"
+        << "  \"threads\": " << this->threads.size() << ",\n"
+        << "  \"phases\": {\n";
+    for (int p = 0; p < PROFILE_PHASES; p++)
+    {
+        double total(0), slowest(0);
+        long long occurrences(0);
+        std::array<long long, PROFILE_BINS> histogram{};
+        PerfValues events{};
+        for (const auto &counters : this->threads)
+        {
+            for (int e = 0; e < PERF_EVENTS; e++)
+            {
+                events[e] += counters->events[p][e];
+            }
+            total += counters->seconds[p];
+            slowest = std::max(slowest, counters->seconds[p]);
+            occurrences += counters->occurrences[p];
+            for (int b = 0; b < PROFILE_BINS; b++)
+            {
+                histogram[b] += counters->histogram[p][b];
+            }
+        }
+        if (p == static_cast<int>(ProfilePhase::Force))
+        {
+            force_seconds = slowest;
+        }
+        out << "    \"" << PHASE_NAMES[p] << "\": {\n"
+            << "      \"count\": " << occurrences << ",\n"
+            << "      \"total_seconds\": " << total << ",\n"
+            << "      \"slowest_thread_seconds\": " << slowest << ",\n"
+            << "      \"mean_seconds\": " << (occurrences > 0 ? total / occurrences : 0) << ",\n";
+        // the events the machine does not count are null
+        if (perf_counters.isActive())
+        {
+            out << "      \"counters\": {";
+            for (int e = 0; e < PERF_EVENTS; e++)
+            {
+                out << (e > 0 ? ", " : "") << "\"" << perfEventName(static_cast<PerfEvent>(e)) << "\": ";
+                if (perf_counters.isAvailable(static_cast<PerfEvent>(e)))
+                {
+                    out << events[e];
+                }
+                else
+                {
+                    out << "null";
+                }
+            }
+            const double cycles = events[static_cast<int>(PerfEvent::Cycles)];
+            out << ", \"instructions_per_cycle\": ";
+            if (perf_counters.isAvailable(PerfEvent::Cycles) && perf_counters.isAvailable(PerfEvent::Instructions) && cycles > 0)
+            {
+                out << events[static_cast<int>(PerfEvent::Instructions)] / cycles;
+            }
+            else
+            {
+                out << "null";
+            }
+            out << "},\n";
+        }
+        out
+            << "      \"thread_seconds\": [";
+        for (std::size_t t = 0; t < this->threads.size(); t++)
+        {
+            out << (t > 0 ? ", " : "") << this->threads[t]->seconds[p];
+        }
+        // up to the last bin in use
+        int bins = PROFILE_BINS;
+        while (bins > 0 && histogram[bins - 1] == 0)
+        {
+            bins--;
+        }
+        out << "],\n"
+            << "      \"histogram_log2_ns\": [";
+        for (int b = 0; b < bins; b++)
+        {
+            out << (b > 0 ? ", " : "") << histogram[b];
+        }
+        out << "]\n"
+            << "    }" << (p < PROFILE_PHASES - 1 ? "," : "") << "\n";
+    }
+    out << "  },\n"
+        << "  \"interactions\": " << interactions << ",\n"
+        << "  \"interactions_per_second\": " << (force_seconds > 0 ? interactions / force_seconds : 0) << ",\n"
+        << "  \"gflops\": " << (force_seconds > 0 ? PROFILE_FLOPS_PER_PAIR * interactions / force_seconds * 1e-9 : 0) << "\n"
+        << "}\n";
+}
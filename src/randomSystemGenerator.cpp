@@ -7,11 +7,13 @@ RandomSystemGenerator::RandomSystemGenerator(int num_planets, int seed, double e
 {
 }
 
-std::vector<std::shared_ptr<Particle>> RandomSystemGenerator::generateInitialConditions()
+ParticleSystem RandomSystemGenerator::generateParticleSystem()
 {
-    // add the Sun to the list
-    this->p_list.push_back(std::make_shared<Particle>(1.0, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0)));
-    // add planets to the list
+    ParticleSystem system;
+    system.reserve(this->num_planets + 1);
+    // add the Sun to the system
+    system.addParticle(1.0, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0));
+    // add planets to the system
     std::mt19937 rng_mt{static_cast<std::mt19937::result_type>(this->seed)};
     std::uniform_real_distribution<double> dist_mass{1. / 6000000, 1. / 1000};
     std::uniform_real_distribution<double> dist_distance{0.4, 30};
@@ -21,12 +23,11 @@ std::vector<std::shared_ptr<Particle>> RandomSystemGenerator::generateInitialCon
         double mass = dist_mass(rng_mt);
         double distance = dist_distance(rng_mt);
         double angle = dist_angle(rng_mt);
-        this->p_list.push_back(
-            std::make_shared<Particle>(
-                mass,
-                Eigen::Vector3d(distance * sin(angle), distance * cos(angle), 0),
-                Eigen::Vector3d(-cos(angle) / sqrt(distance), sin(angle) / sqrt(distance), 0),
-                Eigen::Vector3d(0, 0, 0)));
+        system.addParticle(
+            mass,
+            Eigen::Vector3d(distance * sin(angle), distance * cos(angle), 0),
+            Eigen::Vector3d(-cos(angle) / sqrt(distance), sin(angle) / sqrt(distance), 0),
+            Eigen::Vector3d(0, 0, 0));
     }
-    return this->p_list;
+    return system;
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "simulator.hpp"
+#include "nbody.hpp"
+#include <cmath>
+#include <limits>
+#include <utility>
+
+Simulator::Simulator(ParticleSystem system, std::shared_ptr<ForceSolver> solver, std::shared_ptr<Integrator> integrator, double dt)
+    : system{std::move(system)}, solver{std::move(solver)}, integrator{std::move(integrator)}, dt{dt}
+{
+}
+
+void Simulator::step()
+{
+    this->advance(1);
+}
+
+void Simulator::advance(int n_steps)
+{
+    if (n_steps <= 0)
+    {
+        return;
+    }
+    // the integrator continues from the accelerations, and its own state, left by the previous call
+    this->integrator->setAccelerationsCurrent(this->progress.accelerations_current);
+    this->progress.force_evaluations += advanceSystem(this->system, *this->solver, *this->integrator, this->dt, n_steps);
+    this->integrator->setAccelerationsCurrent(false);
+    this->progress.accelerations_current = this->integrator->leavesAccelerationsCurrent();
+    this->progress.steps += n_steps;
+}
+
+int Simulator::runUntil(double t)
+{
+    // a time a rounding error short of a step boundary still reaches it
+    const double remaining = (t - this->getTime()) / this->dt;
+    if (!(remaining > 0))
+    {
+        return 0;
+    }
+    const double n_steps = std::floor(remaining * (1 + 1e-12));
+    const int n = n_steps < std::numeric_limits<int>::max() ? static_cast<int>(n_steps) : std::numeric_limits<int>::max();
+    this->advance(n);
+    return n;
+}
+
+double Simulator::getTime() const
+{
+    return this->progress.epoch + (this->progress.steps - this->progress.epoch_steps) * this->dt;
+}
+
+long long Simulator::getSteps() const
+{
+    return this->progress.steps;
+}
+
+long long Simulator::getForceEvaluations() const
+{
+    return this->progress.force_evaluations;
+}
+
+double Simulator::getDt() const
+{
+    return this->dt;
+}
+
+void Simulator::setDt(double dt)
+{
+    this->progress.epoch = this->getTime();
+    this->progress.epoch_steps = this->progress.steps;
+    this->dt = dt;
+}
+
+const ParticleSystem &Simulator::getSystem() const
+{
+    return this->system;
+}
+
+ParticleSystem &Simulator::editSystem()
+{
+    this->progress.accelerations_current = false;
+    return this->system;
+}
+
+ForceSolver &Simulator::getSolver()
+{
+    return *this->solver;
+}
+
+Integrator &Simulator::getIntegrator()
+{
+    return *this->integrator;
+}
+
+const SimulatorProgress &Simulator::getProgress() const
+{
+    return this->progress;
+}
+
+void Simulator::setProgress(const SimulatorProgress &progress)
+{
+    this->progress = progress;
+}
@@ -7,10 +7,11 @@ SolarSystemGenerator::SolarSystemGenerator()
 {
 }
 
-std::vector<std::shared_ptr<Particle>> SolarSystemGenerator::generateInitialConditions()
+ParticleSystem SolarSystemGenerator::generateParticleSystem()
 {
-    // All the particles are stored in a vector, in order of Mercury, Venus, Earth, Mars, Jupiter, Saturn, Uranus, Neptune
-    std::vector<std::shared_ptr<Particle>> p_list;
+    // All the particles are stored in a system, in order of the Sun, Mercury, Venus, Earth, Mars, Jupiter, Saturn, Uranus, Neptune
+    ParticleSystem system;
+    system.reserve(9);
     // vector of masses of planets, sun = 1
     std::vector<double> masses{1. / 6023600, 1. / 408524, 1. / 332946.038, 1. / 3098710, 1. / 1047.55, 1. / 3499, 1. / 22962, 1. / 19352};
     // vector of distances of planets, earth = 1
@@ -23,19 +24,18 @@ std::vector<std::shared_ptr<Particle>> SolarSystemGenerator::generateInitialCond
     {
         angles.push_back(distribution(rng_mt));
     }
-    // create the sun and append to the vector
-    p_list.push_back(std::make_shared<Particle>(1, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0)));
+    // create the sun and append to the system
+    system.addParticle(1, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0));
 
-    // create planets and append to the vector
+    // create planets and append to the system
     for (int i = 0; i < 8; i++)
     {
-        p_list.push_back(
-            std::make_shared<Particle>(
-                masses[i],
-                Eigen::Vector3d(distances[i] * sin(angles[i]), distances[i] * cos(angles[i]), 0),
-                Eigen::Vector3d(-cos(angles[i]) / sqrt(distances[i]), sin(angles[i]) / sqrt(distances[i]), 0),
-                Eigen::Vector3d(0, 0, 0)));
+        system.addParticle(
+            masses[i],
+            Eigen::Vector3d(distances[i] * sin(angles[i]), distances[i] * cos(angles[i]), 0),
+            Eigen::Vector3d(-cos(angles[i]) / sqrt(distances[i]), sin(angles[i]) / sqrt(distances[i]), 0),
+            Eigen::Vector3d(0, 0, 0));
     }
 
-    return p_list;
+    return system;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "sweep.hpp"
+#include "nbody.hpp"
+#include "randomSystemGenerator.hpp"
+#include "solarSystemGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+Sweep::Sweep(const std::vector<int> &n_particles, const std::vector<int> &seeds, const std::vector<double> &epsilons, const std::vector<double> &dts,
+             double total_time, int n_steps, SolverFactory make_solver, IntegratorFactory make_integrator, int sort_interval)
+    : make_solver{std::move(make_solver)}, make_integrator{std::move(make_integrator)}, sort_interval{sort_interval}
+{
+    for (int n : n_particles)
+    {
+        // the seeds do not apply to the solar system
+        const std::size_t n_seeds = n > 0 ? seeds.size() : std::min<std::size_t>(seeds.size(), 1);
+        for (std::size_t s = 0; s < n_seeds; s++)
+        {
+            for (double epsilon : epsilons)
+            {
+                for (double dt : dts)
+                {
+                    SweepRun run;
+                    run.n_particles = n;
+                    run.seed = seeds[s];
+                    run.epsilon = epsilon;
+                    run.dt = dt;
+                    run.n_steps = n_steps > 0 ? n_steps : static_cast<int>(total_time * 2 * M_PI / dt);
+                    this->runs.push_back(run);
+                }
+            }
+        }
+    }
+}
+
+void Sweep::execute(SweepRun &run) const
+{
+    ParticleSystem system = run.n_particles > 0 ? RandomSystemGenerator(run.n_particles, run.seed, run.epsilon).generateParticleSystem()
+                                                : SolarSystemGenerator().generateParticleSystem();
+    std::shared_ptr<ForceSolver> solver = this->make_solver(run.epsilon);
+    std::shared_ptr<Integrator> integrator = this->make_integrator();
+    run.n_bodies = system.size();
+    run.initial_energy = calTotalEnergy(system, run.epsilon);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    advanceSystem(system, *solver, *integrator, run.dt, run.n_steps, run.n_particles > 0 ? this->sort_interval : 0);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    run.running_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    run.final_energy = calTotalEnergy(system, run.epsilon);
+}
+
+void Sweep::run()
+{
+    // measured before any run, with all threads available
+    const int threshold = getParallelThreshold();
+    const int solar_system_bodies = SolarSystemGenerator().generateParticleSystem().size();
+    auto bodies = [&](int k) { return this->runs[k].n_particles > 0 ? this->runs[k].n_particles + 1 : solar_system_bodies; };
+    std::vector<int> small_runs, large_runs;
+    for (int k = 0; k < static_cast<int>(this->runs.size()); k++)
+    {
+        (bodies(k) < threshold ? small_runs : large_runs).push_back(k);
+    }
+    // the longest runs first, so that the threads run out of work at about the same time
+    auto cost = [&](int k) { return static_cast<double>(bodies(k)) * bodies(k) * this->runs[k].n_steps; };
+    std::sort(small_runs.begin(), small_runs.end(), [&](int a, int b) { return cost(a) > cost(b); });
+    #pragma omp parallel for schedule(dynamic)
+    for (std::size_t k = 0; k < small_runs.size(); k++)
+    {
+        // a team of one, which the worksharing constructs of the steps bind to
+        #pragma omp parallel num_threads(1)
+        this->execute(this->runs[small_runs[k]]);
+    }
+    for (int k : large_runs)
+    {
+        this->execute(this->runs[k]);
+    }
+}
+
+const std::vector<SweepRun> &Sweep::getRuns() const
+{
+    return this->runs;
+}
+
+void Sweep::print(std::ostream &out) const
+{
+    out << "| Num Bodies | seed | epsilon | dt | Number of step | Running time (ms) | Time per step (ms) | Energy change | Relative energy error |" << std::endl
+        << "| --- | --- | --- | --- | --- | --- | --- | --- | --- |" << std::endl;
+    for (const SweepRun &run : this->runs)
+    {
+        out << "| "
+            << run.n_bodies
+            << " | ";
+        if (run.n_particles > 0)
+        {
+            out << run.seed;
+        }
+        else
+        {
+            out << "solar system";
+        }
+        out << " | "
+            << run.epsilon
+            << " | "
+            << run.dt
+            << " | "
+            << run.n_steps
+            << " | "
+            << run.running_time
+            << " | "
+            << run.running_time / run.n_steps
+            << " | "
+            << run.final_energy - run.initial_energy
+            << " | "
+            << std::abs((run.final_energy - run.initial_energy) / run.initial_energy)
+            << " |"
+            << std::endl;
+    }
+}
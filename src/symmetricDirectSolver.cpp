@@ -0,0 +1,69 @@
+#include "symmetricDirectSolver.hpp"
+#include "profiler.hpp"
+#include "gravityKernel.hpp"
+#include <algorithm>
+#include <omp.h>
+
+SymmetricDirectSolver::SymmetricDirectSolver(double epsilon) : ForceSolver(epsilon)
+{
+}
+
+void SymmetricDirectSolver::computeAccelerations(ParticleSystem &system)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+    const int n_particles = system.size();
+    // counted as the interactions of summing both sides of every pair
+    NBODY_PROFILE_INTERACTIONS(static_cast<long long>(n_particles) * (n_particles - 1));
+    const std::size_t stride = system.stride();
+    const double epsilon2 = this->epsilon * this->epsilon;
+    const double *m = system.masses(), *x = system.x(), *y = system.y(), *z = system.z();
+    const int n_threads = omp_get_num_threads();
+    const bool potential = this->getComputePotential();
+    #pragma omp single
+    {
+        if (this->thread_buffers.size() != n_threads * 4 * stride)
+        {
+            this->thread_buffers.assign(n_threads * 4 * stride, 0.0);
+        }
+    }
+    // clear the buffer of this thread
+    double *acc_x = this->thread_buffers.data() + omp_get_thread_num() * 4 * stride;
+    double *acc_y = acc_x + stride;
+    double *acc_z = acc_y + stride;
+    double *phi = acc_z + stride;
+    std::fill(acc_x, acc_x + (potential ? 4 : 3) * stride, 0.0);
+    // every pair once, the triangular rows are handed out dynamically to balance the load
+    PairKernel kernel = getPairKernel();
+    #pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < n_particles; i++)
+    {
+        kernel(m, x, y, z, stride, epsilon2, i, acc_x, acc_y, acc_z, potential ? phi : nullptr);
+    }
+    // sum the buffers of all threads
+    const double *buffers = this->thread_buffers.data();
+    double *ax = system.ax(), *ay = system.ay(), *az = system.az(), *potentials = system.potentials();
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n_particles; i++)
+    {
+        double sum_x(0), sum_y(0), sum_z(0), sum_phi(0);
+        for (int t = 0; t < n_threads; t++)
+        {
+            sum_x += buffers[t * 4 * stride + i];
+            sum_y += buffers[t * 4 * stride + stride + i];
+            sum_z += buffers[t * 4 * stride + 2 * stride + i];
+            sum_phi += buffers[t * 4 * stride + 3 * stride + i];
+        }
+        ax[i] = sum_x;
+        ay[i] = sum_y;
+        az[i] = sum_z;
+        if (potential)
+        {
+            potentials[i] = sum_phi;
+        }
+    }
+}
+
+bool SymmetricDirectSolver::supportsPotential() const
+{
+    return true;
+}
@@ -0,0 +1,148 @@
+#include "symplecticIntegrator.hpp"
+#include "profiler.hpp"
+#include <cmath>
+
+SymplecticIntegrator::SymplecticIntegrator(SymplecticScheme scheme) : scheme{scheme}, kick_first{scheme != SymplecticScheme::PositionVerlet}
+{
+    switch (scheme)
+    {
+    case SymplecticScheme::Yoshida4:
+    {
+        const double w1 = 1 / (2 - std::cbrt(2.0));
+        const double w0 = 1 - 2 * w1;
+        this->weights = {w1, w0, w1};
+        break;
+    }
+    case SymplecticScheme::Yoshida6:
+    {
+        const double w1 = -1.17767998417887, w2 = 0.235573213359357, w3 = 0.784513610477560;
+        const double w0 = 1 - 2 * (w1 + w2 + w3);
+        this->weights = {w3, w2, w1, w0, w1, w2, w3};
+        break;
+    }
+    default:
+        this->weights = {1};
+    }
+}
+
+SymplecticScheme SymplecticIntegrator::getScheme() const
+{
+    return this->scheme;
+}
+
+int SymplecticIntegrator::getOrder() const
+{
+    switch (this->scheme)
+    {
+    case SymplecticScheme::Yoshida4:
+        return 4;
+    case SymplecticScheme::Yoshida6:
+        return 6;
+    default:
+        return 2;
+    }
+}
+
+bool SymplecticIntegrator::recordsEnergy() const
+{
+    return this->kick_first;
+}
+
+bool SymplecticIntegrator::leavesAccelerationsCurrent() const
+{
+    return this->kick_first;
+}
+
+void SymplecticIntegrator::kickDrift(ParticleSystem &system, double kick, double drift) const
+{
+    const int n_particles = system.size();
+    double *x = system.x(), *y = system.y(), *z = system.z();
+    double *vx = system.vx(), *vy = system.vy(), *vz = system.vz();
+    const double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    {
+        NBODY_PROFILE_SCOPE(ProfilePhase::Integration);
+        #pragma omp for schedule(static) nowait
+        for (int i = 0; i < n_particles; i++)
+        {
+            vx[i] += ax[i] * kick;
+            vy[i] += ay[i] * kick;
+            vz[i] += az[i] * kick;
+            x[i] += vx[i] * drift;
+            y[i] += vy[i] * drift;
+            z[i] += vz[i] * drift;
+        }
+    }
+    NBODY_BARRIER();
+}
+
+void SymplecticIntegrator::integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps)
+{
+    const int n_substeps = this->weights.size();
+    // the half operations that start and end substep k, merged with those of the neighbouring substeps
+    auto half = [&](int k) {
+        double before = k > 0 ? this->weights[k - 1] : 0;
+        double after = k < n_substeps ? this->weights[k] : 0;
+        return 0.5 * (before + after) * dt;
+    };
+    // the first half operation of a step also closes the previous step
+    const double wrap = half(0) + half(n_substeps);
+    // the opening force evaluation is left out if the accelerations are current, unless it has to bring the energy
+    const bool first_forces = this->kick_first && (!this->accelerations_current || this->record_energy);
+    #pragma omp single
+    this->force_evaluations = static_cast<long long>(system.size()) * (static_cast<long long>(n_steps) * n_substeps + (first_forces ? 1 : 0));
+    if (n_steps <= 0)
+    {
+        return;
+    }
+    if (this->kick_first)
+    {
+        // K D K ... K D K, the energies come with the first and the last force evaluation
+        if (first_forces)
+        {
+            #pragma omp single
+            solver.setComputePotential(this->record_energy);
+            solver.computeAccelerations(system);
+            #pragma omp single
+            {
+                if (solver.getComputePotential())
+                {
+                    this->initial_energy = this->takeEnergy(system, solver);
+                }
+            }
+        }
+        for (int n = 0; n < n_steps; n++)
+        {
+            for (int k = 0; k < n_substeps; k++)
+            {
+                this->kickDrift(system, k == 0 && n > 0 ? wrap : half(k), this->weights[k] * dt);
+                if (n == n_steps - 1 && k == n_substeps - 1)
+                {
+                    #pragma omp single
+                    solver.setComputePotential(this->record_energy);
+                }
+                solver.computeAccelerations(system);
+            }
+        }
+        this->kickDrift(system, half(n_substeps), 0);
+        #pragma omp single
+        {
+            if (solver.getComputePotential())
+            {
+                this->final_energy = this->takeEnergy(system, solver);
+            }
+        }
+    }
+    else
+    {
+        // D K D ... D K D
+        this->kickDrift(system, 0, half(0));
+        for (int n = 0; n < n_steps; n++)
+        {
+            for (int k = 0; k < n_substeps; k++)
+            {
+                solver.computeAccelerations(system);
+                this->kickDrift(system, this->weights[k] * dt, k == n_substeps - 1 && n < n_steps - 1 ? wrap : half(k + 1));
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include "tiledDirectSolver.hpp"
+#include "profiler.hpp"
+#include "gravityKernel.hpp"
+#include "randomSystemGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace
+{
+    // candidates of the tuner, the source tiles are multiples of 8 as the tile kernels require
+    const int SOURCE_TILES[] = {256, 512, 1024, 2048, 4096, 8192};
+    const int TARGET_BLOCKS[] = {16, 64, 256};
+    // the synthetic system has more sources than fit in L2, the tuner times the same targets for every candidate
+    constexpr int TUNING_SOURCES = 32768;
+    constexpr int TUNING_TARGETS = 256;
+
+    // add the accelerations of the targets [begin, end) due to all sources, tile by tile
+    void sweepTiles(ParticleSystem &system, TileKernel kernel, double epsilon2, int begin, int end, int source_tile)
+    {
+        const std::size_t stride = system.stride();
+        for (std::size_t source_begin = 0; source_begin < stride; source_begin += source_tile)
+        {
+            kernel(system.masses(), system.x(), system.y(), system.z(), source_begin, std::min(source_begin + source_tile, stride),
+                   epsilon2, begin, end, system.ax(), system.ay(), system.az());
+        }
+    }
+
+    struct TileSizes
+    {
+        int source_tile, target_block;
+    };
+
+    TileSizes measureTileSizes()
+    {
+        RandomSystemGenerator generator(TUNING_SOURCES - 1);
+        ParticleSystem system = generator.generateParticleSystem();
+        TileKernel kernel = getTileKernel();
+        TileSizes best{SOURCE_TILES[0], TARGET_BLOCKS[0]};
+        double best_time = std::numeric_limits<double>::max();
+        for (int source_tile : SOURCE_TILES)
+        {
+            for (int target_block : TARGET_BLOCKS)
+            {
+                auto start_time = std::chrono::high_resolution_clock::now();
+                for (int begin = 0; begin < TUNING_TARGETS; begin += target_block)
+                {
+                    sweepTiles(system, kernel, 0, begin, std::min(begin + target_block, TUNING_TARGETS), source_tile);
+                }
+                auto end_time = std::chrono::high_resolution_clock::now();
+                double time = std::chrono::duration<double>(end_time - start_time).count();
+                if (time < best_time)
+                {
+                    best_time = time;
+                    best = {source_tile, target_block};
+                }
+            }
+        }
+        return best;
+    }
+}
+
+TiledDirectSolver::TiledDirectSolver(double epsilon, int source_tile, int target_block) : ForceSolver(epsilon)
+{
+    int tuned_source_tile(0), tuned_target_block(0);
+    if (source_tile <= 0 || target_block <= 0)
+    {
+        tuneTileSizes(tuned_source_tile, tuned_target_block);
+    }
+    // whole SIMD blocks of sources
+    this->source_tile = source_tile > 0 ? (source_tile + 7) / 8 * 8 : tuned_source_tile;
+    this->target_block = target_block > 0 ? target_block : tuned_target_block;
+}
+
+void TiledDirectSolver::tuneTileSizes(int &source_tile, int &target_block)
+{
+    static const TileSizes tuned = measureTileSizes();
+    source_tile = tuned.source_tile;
+    target_block = tuned.target_block;
+}
+
+int TiledDirectSolver::getSourceTile() const
+{
+    return this->source_tile;
+}
+
+int TiledDirectSolver::getTargetBlock() const
+{
+    return this->target_block;
+}
+
+void TiledDirectSolver::computeAccelerations(ParticleSystem &system)
+{
+    const int n_particles = system.size();
+    const double epsilon2 = this->epsilon * this->epsilon;
+    const int n_blocks = (n_particles + this->target_block - 1) / this->target_block;
+    double *ax = system.ax(), *ay = system.ay(), *az = system.az();
+    TileKernel kernel = getTileKernel();
+    NBODY_PROFILE_INTERACTIONS(static_cast<long long>(n_particles) * (n_particles - 1));
+    {
+        NBODY_PROFILE_SCOPE(ProfilePhase::Force);
+        #pragma omp for schedule(dynamic) nowait
+        for (int block = 0; block < n_blocks; block++)
+        {
+            const int begin = block * this->target_block;
+            const int end = std::min(begin + this->target_block, n_particles);
+            std::fill(ax + begin, ax + end, 0.0);
+            std::fill(ay + begin, ay + end, 0.0);
+            std::fill(az + begin, az + end, 0.0);
+            sweepTiles(system, kernel, epsilon2, begin, end, this->source_tile);
+        }
+    }
+    // the barrier of the loop, timed apart from the forces
+    NBODY_BARRIER();
+}
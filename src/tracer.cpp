@@ -0,0 +1,135 @@
+#include "tracer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+Tracer &Tracer::get()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::~Tracer()
+{
+    if (this->path.empty())
+    {
+        return;
+    }
+    this->stop();
+    std::ofstream file(this->path);
+    this->writeTrace(file);
+    if (!file)
+    {
+        std::cerr << "Error: cannot write the trace to " << this->path << "." << std::endl;
+        return;
+    }
+    std::cout << "trace: "
+              << this->getRecorded()
+              << " events written to "
+              << this->path
+              << ", "
+              << this->getDropped()
+              << " overwritten"
+              << std::endl;
+}
+
+void Tracer::start(const std::string &path, int sample_interval, std::size_t capacity)
+{
+    this->path = path;
+    this->sample_interval = std::max(sample_interval, 1);
+    this->capacity = std::max<std::size_t>(capacity, 1);
+    this->origin = std::chrono::steady_clock::now();
+    this->active = true;
+}
+
+void Tracer::stop()
+{
+    this->active = false;
+}
+
+Tracer::ThreadBuffer &Tracer::local()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->threads.push_back(std::make_unique<ThreadBuffer>());
+        buffer = this->threads.back().get();
+        buffer->events.resize(this->capacity);
+    }
+    return *buffer;
+}
+
+void Tracer::record(ProfilePhase phase, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    ThreadBuffer &buffer = this->local();
+    if (phase == ProfilePhase::Force)
+    {
+        buffer.sampled = buffer.forces++ % this->sample_interval == 0;
+    }
+    const bool windowed = phase == ProfilePhase::Force || phase == ProfilePhase::Integration || phase == ProfilePhase::Barrier;
+    if (windowed && !buffer.sampled)
+    {
+        return;
+    }
+    using std::chrono::nanoseconds;
+    buffer.events[buffer.head % this->capacity] = {phase, std::chrono::duration_cast<nanoseconds>(begin - this->origin).count(),
+                                                   std::chrono::duration_cast<nanoseconds>(end - this->origin).count()};
+    buffer.head++;
+}
+
+long long Tracer::getRecorded() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    long long recorded(0);
+    for (const auto &buffer : this->threads)
+    {
+        recorded += std::min<long long>(buffer->head, this->capacity);
+    }
+    return recorded;
+}
+
+long long Tracer::getDropped() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    long long dropped(0);
+    for (const auto &buffer : this->threads)
+    {
+        dropped += std::max<long long>(buffer->head - static_cast<long long>(this->capacity), 0);
+    }
+    return dropped;
+}
+
+void Tracer::writeTrace(std::ostream &out) const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    const long long capacity = this->capacity;
+    // microseconds to the nanosecond, whatever the length of the run
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    bool first = true;
+    auto separate = [&]() {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+    for (std::size_t t = 0; t < this->threads.size(); t++)
+    {
+        const ThreadBuffer &buffer = *this->threads[t];
+        separate();
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << t << ", \"args\": {\"name\": \"thread " << t << "\"}}";
+        // oldest first, complete events with the begin and the duration in microseconds
+        for (long long k = std::max(buffer.head - capacity, 0LL); k < buffer.head; k++)
+        {
+            const Event &event = buffer.events[k % capacity];
+            separate();
+            out << "{\"name\": \"" << profilePhaseName(event.phase) << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << t
+                << ", \"ts\": " << event.begin * 1e-3 << ", \"dur\": " << (event.end - event.begin) * 1e-3 << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
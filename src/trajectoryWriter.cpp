@@ -0,0 +1,177 @@
+#include "trajectoryWriter.hpp"
+#include "profiler.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    constexpr char MAGIC[8] = {'N', 'B', 'O', 'D', 'Y', 'T', 'R', 'J'};
+    constexpr std::uint32_t TRAJECTORY_VERSION = 1;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t coordinate_bytes;
+        std::uint64_t n_bodies;
+        char padding[40];
+    };
+    static_assert(sizeof(Header) == 64, "the trajectory header is 64 bytes");
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string &path, std::size_t n_bodies, int interval, TrajectoryPolicy policy)
+    : n_bodies{n_bodies}, interval{interval}, policy{policy}, file(path, std::ios::binary | std::ios::trunc)
+{
+    // every buffer is sized once, the snapshots reuse them
+    this->front.positions.resize(3 * n_bodies);
+    this->back.positions.resize(3 * n_bodies);
+    this->frame.resize(3 * n_bodies);
+    if (!this->file)
+    {
+        this->failed = true;
+        return;
+    }
+    this->opened = true;
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = TRAJECTORY_VERSION;
+    header.coordinate_bytes = sizeof(float);
+    header.n_bodies = n_bodies;
+    this->file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    this->thread = std::thread(&TrajectoryWriter::writeLoop, this);
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    this->close();
+}
+
+bool TrajectoryWriter::isOpen() const
+{
+    return this->opened;
+}
+
+int TrajectoryWriter::getInterval() const
+{
+    return this->interval;
+}
+
+bool TrajectoryWriter::submit(const ParticleSystem &system, long long step, double time)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::IO);
+    // the frames have room for n_bodies bodies only
+    if (system.size() != this->n_bodies)
+    {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (!this->thread.joinable())
+    {
+        return false;
+    }
+    if (this->pending)
+    {
+        if (this->policy == TrajectoryPolicy::Drop)
+        {
+            this->dropped++;
+            return false;
+        }
+        // back-pressure: the stepping waits until the I/O thread has taken the previous snapshot
+        auto start_time = std::chrono::steady_clock::now();
+        this->ready.wait(lock, [this] { return !this->pending; });
+        this->stalls++;
+        this->stall_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    }
+    lock.unlock();
+    // the I/O thread leaves the front buffer alone until it is pending
+    this->front.step = step;
+    this->front.time = time;
+    for (int d = 0; d < 3; d++)
+    {
+        std::memcpy(this->front.positions.data() + d * this->n_bodies, system.x() + d * system.stride(), this->n_bodies * sizeof(double));
+    }
+    lock.lock();
+    this->pending = true;
+    lock.unlock();
+    this->ready.notify_all();
+    return true;
+}
+
+void TrajectoryWriter::writeLoop()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true)
+    {
+        this->ready.wait(lock, [this] { return this->pending || this->closing; });
+        if (!this->pending)
+        {
+            return;
+        }
+        std::swap(this->front, this->back);
+        this->pending = false;
+        lock.unlock();
+        this->ready.notify_all();
+        this->writeFrame(this->back);
+        lock.lock();
+    }
+}
+
+void TrajectoryWriter::writeFrame(const Snapshot &snapshot)
+{
+    NBODY_PROFILE_SCOPE(ProfilePhase::IO);
+    for (std::size_t i = 0; i < 3 * this->n_bodies; i++)
+    {
+        this->frame[i] = static_cast<float>(snapshot.positions[i]);
+    }
+    const std::int64_t step = snapshot.step;
+    this->file.write(reinterpret_cast<const char *>(&step), sizeof(step));
+    this->file.write(reinterpret_cast<const char *>(&snapshot.time), sizeof(snapshot.time));
+    this->file.write(reinterpret_cast<const char *>(this->frame.data()), this->frame.size() * sizeof(float));
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->file)
+    {
+        this->written++;
+    }
+    else
+    {
+        this->failed = true;
+    }
+}
+
+bool TrajectoryWriter::close()
+{
+    if (this->thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->closing = true;
+        }
+        this->ready.notify_all();
+        this->thread.join();
+        this->file.close();
+        this->failed = this->failed || this->file.fail();
+    }
+    return !this->failed;
+}
+
+long long TrajectoryWriter::getWritten() const
+{
+    return this->written;
+}
+
+long long TrajectoryWriter::getDropped() const
+{
+    return this->dropped;
+}
+
+long long TrajectoryWriter::getStalls() const
+{
+    return this->stalls;
+}
+
+double TrajectoryWriter::getStallTime() const
+{
+    return this->stall_time;
+}
@@ -0,0 +1,198 @@
+#include "wisdomHolmanIntegrator.hpp"
+#include "profiler.hpp"
+#include "kepler.hpp"
+#include <algorithm>
+
+void WisdomHolmanIntegrator::kick(double h)
+{
+    const int n_planets = this->planets.size();
+    double *vx = this->planets.vx(), *vy = this->planets.vy(), *vz = this->planets.vz();
+    const double *ax = this->planets.ax(), *ay = this->planets.ay(), *az = this->planets.az();
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n_planets; i++)
+    {
+        vx[i] += ax[i] * h;
+        vy[i] += ay[i] * h;
+        vz[i] += az[i] * h;
+    }
+}
+
+void WisdomHolmanIntegrator::jump(double h)
+{
+    const int n_planets = this->planets.size();
+    double *x = this->planets.x(), *y = this->planets.y(), *z = this->planets.z();
+    #pragma omp single
+    {
+        const double *m = this->planets.masses();
+        const double *vx = this->planets.vx(), *vy = this->planets.vy(), *vz = this->planets.vz();
+        double px(0), py(0), pz(0);
+        for (int i = 0; i < n_planets; i++)
+        {
+            px += m[i] * vx[i];
+            py += m[i] * vy[i];
+            pz += m[i] * vz[i];
+        }
+        this->jump_x = h * px / this->central_mass;
+        this->jump_y = h * py / this->central_mass;
+        this->jump_z = h * pz / this->central_mass;
+    }
+    #pragma omp for schedule(static)
+    for (int i = 0; i < n_planets; i++)
+    {
+        x[i] += this->jump_x;
+        y[i] += this->jump_y;
+        z[i] += this->jump_z;
+    }
+}
+
+void WisdomHolmanIntegrator::drift(double h)
+{
+    const int n_planets = this->planets.size();
+    const int n_batches = (n_planets + KEPLER_BATCH - 1) / KEPLER_BATCH;
+    #pragma omp for schedule(dynamic)
+    for (int b = 0; b < n_batches; b++)
+    {
+        const int begin = b * KEPLER_BATCH;
+        const int count = std::min(KEPLER_BATCH, n_planets - begin);
+        keplerDrift(this->central_mass, h, count, this->planets.x() + begin, this->planets.y() + begin, this->planets.z() + begin,
+                    this->planets.vx() + begin, this->planets.vy() + begin, this->planets.vz() + begin);
+    }
+}
+
+void WisdomHolmanIntegrator::integrate(ParticleSystem &system, ForceSolver &solver, double dt, int n_steps)
+{
+    const int n_particles = system.size();
+    const int n_planets = std::max(n_particles - 1, 0);
+    // a call declared to continue the previous one goes on from the heliocentric state that one kept, with its
+    // closing half kick still owed to the velocities, and takes the same steps as a single longer call
+    const bool continuing = this->accelerations_current && this->resumable && this->planets.size() == static_cast<std::size_t>(n_planets);
+    #pragma omp single
+    {
+        if (continuing)
+        {
+            if (dt != this->last_dt)
+            {
+                // the centre of mass moves on from where it got to with the old step
+                const double time = this->last_dt * this->elapsed_steps;
+                this->cm_x += this->cm_vx * time;
+                this->cm_y += this->cm_vy * time;
+                this->cm_z += this->cm_vz * time;
+                this->elapsed_steps = 0;
+            }
+        }
+        else
+        {
+            // from inertial to democratic heliocentric coordinates
+            const double *m = system.masses();
+            double total_mass(0);
+            this->cm_x = this->cm_y = this->cm_z = this->cm_vx = this->cm_vy = this->cm_vz = 0;
+            for (int i = 0; i < n_particles; i++)
+            {
+                total_mass += m[i];
+                this->cm_x += m[i] * system.x()[i];
+                this->cm_y += m[i] * system.y()[i];
+                this->cm_z += m[i] * system.z()[i];
+                this->cm_vx += m[i] * system.vx()[i];
+                this->cm_vy += m[i] * system.vy()[i];
+                this->cm_vz += m[i] * system.vz()[i];
+            }
+            if (total_mass > 0)
+            {
+                this->cm_x /= total_mass;
+                this->cm_y /= total_mass;
+                this->cm_z /= total_mass;
+                this->cm_vx /= total_mass;
+                this->cm_vy /= total_mass;
+                this->cm_vz /= total_mass;
+            }
+            this->central_mass = n_particles > 0 ? m[0] : 0;
+            if (this->planets.size() != static_cast<std::size_t>(n_planets))
+            {
+                this->planets = ParticleSystem(n_planets);
+            }
+            for (int i = 0; i < n_planets; i++)
+            {
+                this->planets.masses()[i] = m[i + 1];
+                this->planets.x()[i] = system.x()[i + 1] - system.x()[0];
+                this->planets.y()[i] = system.y()[i + 1] - system.y()[0];
+                this->planets.z()[i] = system.z()[i + 1] - system.z()[0];
+                this->planets.vx()[i] = system.vx()[i + 1] - this->cm_vx;
+                this->planets.vy()[i] = system.vy()[i + 1] - this->cm_vy;
+                this->planets.vz()[i] = system.vz()[i + 1] - this->cm_vz;
+            }
+            this->elapsed_steps = 0;
+            this->owed_kick = 0;
+        }
+        this->last_dt = dt;
+        this->force_evaluations = static_cast<long long>(n_planets) * (n_steps + (continuing ? 0 : 1));
+    }
+    if (!continuing)
+    {
+        solver.computeAccelerations(this->planets);
+        NBODY_BARRIER();
+    }
+    for (int n = 0; n < n_steps; n++)
+    {
+        // the closing half kick of a step is merged with the opening one of the next
+        this->kick(n == 0 ? this->owed_kick + 0.5 * dt : dt);
+        this->jump(0.5 * dt);
+        this->drift(dt);
+        this->jump(0.5 * dt);
+        solver.computeAccelerations(this->planets);
+        NBODY_BARRIER();
+    }
+    // back to inertial coordinates with the closing half kick, the centre of mass moves uniformly
+    #pragma omp single
+    {
+        if (n_steps > 0)
+        {
+            this->owed_kick = 0.5 * dt;
+        }
+        this->elapsed_steps += n_steps;
+        this->resumable = true;
+        const double h = this->owed_kick;
+        const double *m = this->planets.masses();
+        const double *vx = this->planets.vx(), *vy = this->planets.vy(), *vz = this->planets.vz();
+        const double *ax = this->planets.ax(), *ay = this->planets.ay(), *az = this->planets.az();
+        double total_mass(this->central_mass), mx(0), my(0), mz(0), px(0), py(0), pz(0);
+        for (int i = 0; i < n_planets; i++)
+        {
+            total_mass += m[i];
+            mx += m[i] * this->planets.x()[i];
+            my += m[i] * this->planets.y()[i];
+            mz += m[i] * this->planets.z()[i];
+            px += m[i] * (vx[i] + ax[i] * h);
+            py += m[i] * (vy[i] + ay[i] * h);
+            pz += m[i] * (vz[i] + az[i] * h);
+        }
+        const double time = this->last_dt * this->elapsed_steps;
+        if (n_particles > 0)
+        {
+            system.x()[0] = this->cm_x + this->cm_vx * time - (total_mass > 0 ? mx / total_mass : 0);
+            system.y()[0] = this->cm_y + this->cm_vy * time - (total_mass > 0 ? my / total_mass : 0);
+            system.z()[0] = this->cm_z + this->cm_vz * time - (total_mass > 0 ? mz / total_mass : 0);
+            system.vx()[0] = this->cm_vx - (this->central_mass > 0 ? px / this->central_mass : 0);
+            system.vy()[0] = this->cm_vy - (this->central_mass > 0 ? py / this->central_mass : 0);
+            system.vz()[0] = this->cm_vz - (this->central_mass > 0 ? pz / this->central_mass : 0);
+        }
+        for (int i = 0; i < n_planets; i++)
+        {
+            system.x()[i + 1] = this->planets.x()[i] + system.x()[0];
+            system.y()[i + 1] = this->planets.y()[i] + system.y()[0];
+            system.z()[i + 1] = this->planets.z()[i] + system.z()[0];
+            system.vx()[i + 1] = (vx[i] + ax[i] * h) + this->cm_vx;
+            system.vy()[i + 1] = (vy[i] + ay[i] * h) + this->cm_vy;
+            system.vz()[i + 1] = (vz[i] + az[i] * h) + this->cm_vz;
+        }
+    }
+}
+
+bool WisdomHolmanIntegrator::leavesAccelerationsCurrent() const
+{
+    return true;
+}
+
+void WisdomHolmanIntegrator::clearState()
+{
+    this->resumable = false;
+}
@@ -0,0 +1,160 @@
+#include <catch2/catch_test_macros.hpp>
+#include "nbody.hpp"
+#include "particleSystem.hpp"
+#include "directSolver.hpp"
+#include "eulerIntegrator.hpp"
+#include "randomSystemGenerator.hpp"
+#include "solarSystemGenerator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <omp.h>
+
+// the timed workloads are normalised by a fixed scalar loop run on the same machine, so that the baseline carries
+// over between machines of similar microarchitecture. set NBODY_PERF_UPDATE=1 to write the measured ratios back to
+// the baseline file instead of checking them.
+
+namespace
+{
+    // best time in seconds of the repetitions of a call, each on a fresh setup
+    double bestTime(const std::function<std::function<void()>()> &setup, int repetitions)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int r = 0; r < repetitions; r++)
+        {
+            std::function<void()> call = setup();
+            auto start_time = std::chrono::steady_clock::now();
+            call();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+        }
+        return best;
+    }
+
+    // a dependent chain of multiplies, adds and square roots that the compiler cannot vectorise or fold
+    double referenceTime()
+    {
+        static const double time = bestTime([] {
+            return std::function<void()>([] {
+                volatile double sink;
+                double value = 1.0;
+                for (int k = 0; k < 20000000; k++)
+                {
+                    value = std::sqrt(value * 1.0000001 + 0.5);
+                }
+                sink = value;
+                (void)sink;
+            });
+        }, 5);
+        return time;
+    }
+
+    // baseline ratio and relative tolerance of each workload
+    struct Baseline
+    {
+        double ratio;
+        double tolerance;
+    };
+
+    std::map<std::string, Baseline> readBaselines()
+    {
+        std::map<std::string, Baseline> baselines;
+        std::ifstream file(NBODY_PERF_BASELINE);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string name;
+            Baseline baseline;
+            if (line.empty() || line[0] == '#' || !(fields >> name >> baseline.ratio >> baseline.tolerance))
+            {
+                continue;
+            }
+            baselines[name] = baseline;
+        }
+        return baselines;
+    }
+
+    // replace the ratio of a workload in the baseline file, keeping its tolerance and the other lines
+    void updateBaseline(const std::string &name, double ratio, double default_tolerance)
+    {
+        std::ifstream in(NBODY_PERF_BASELINE);
+        std::ostringstream out;
+        std::string line;
+        bool found = false;
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            std::string field;
+            Baseline baseline;
+            if (!line.empty() && line[0] != '#' && fields >> field >> baseline.ratio >> baseline.tolerance && field == name)
+            {
+                out << name << ' ' << ratio << ' ' << baseline.tolerance << '\n';
+                found = true;
+            }
+            else
+            {
+                out << line << '\n';
+            }
+        }
+        if (!found)
+        {
+            out << name << ' ' << ratio << ' ' << default_tolerance << '\n';
+        }
+        in.close();
+        std::ofstream(NBODY_PERF_BASELINE) << out.str();
+    }
+
+    // time a workload against its baseline: it fails if it is slower than the baseline by more than the tolerance
+    void checkWorkload(const std::string &name, const std::function<std::function<void()>()> &setup)
+    {
+        // one thread, so that the result does not depend on the cores of the machine
+        const int threads = omp_get_max_threads();
+        omp_set_num_threads(1);
+        const double time = bestTime(setup, 3);
+        omp_set_num_threads(threads);
+        const double ratio = time / referenceTime();
+        const char *update = std::getenv("NBODY_PERF_UPDATE");
+        if (update != nullptr && std::string(update) == "1")
+        {
+            updateBaseline(name, ratio, 0.5);
+            WARN(name << ": baseline set to " << ratio << " (" << time * 1e3 << " ms)");
+            return;
+        }
+        const std::map<std::string, Baseline> baselines = readBaselines();
+        auto baseline = baselines.find(name);
+        if (baseline == baselines.end())
+        {
+            FAIL(name << " has no baseline in " << NBODY_PERF_BASELINE << ", run with NBODY_PERF_UPDATE=1 to record one");
+        }
+        INFO(name << ": " << time * 1e3 << " ms, " << ratio << " reference loops, baseline "
+                  << baseline->second.ratio << " + " << 100 * baseline->second.tolerance << "%");
+        CHECK(ratio <= baseline->second.ratio * (1 + baseline->second.tolerance));
+    }
+}
+
+TEST_CASE("Solar system of 9 bodies, 1e5 Euler steps", "[perf][solar_system_1e5_steps]")
+{
+    checkWorkload("solar_system_1e5_steps", [] {
+        auto system = std::make_shared<ParticleSystem>(SolarSystemGenerator().generateParticleSystem());
+        auto solver = std::make_shared<DirectSolver>();
+        auto integrator = std::make_shared<EulerIntegrator>();
+        return std::function<void()>([=] { advanceSystem(*system, *solver, *integrator, 0.0001, 100000); });
+    });
+}
+
+TEST_CASE("Random system of 1024 planets, 100 Euler steps", "[perf][random_system_1024_100_steps]")
+{
+    checkWorkload("random_system_1024_100_steps", [] {
+        auto system = std::make_shared<ParticleSystem>(RandomSystemGenerator(1024, 2023, 0.001).generateParticleSystem());
+        auto solver = std::make_shared<DirectSolver>(0.001);
+        auto integrator = std::make_shared<EulerIntegrator>();
+        return std::function<void()>([=] { advanceSystem(*system, *solver, *integrator, 0.001, 100); });
+    });
+}
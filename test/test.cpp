@@ -2,7 +2,43 @@
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include "particle.hpp"
 #include "nbody.hpp"
+#include "particleSystem.hpp"
+#include "gravityKernel.hpp"
+#include "directSolver.hpp"
+#include "symmetricDirectSolver.hpp"
+#include "tiledDirectSolver.hpp"
+#include "barnesHutSolver.hpp"
+#include "fmmSolver.hpp"
+#include "mortonSorter.hpp"
+#include "morton.hpp"
+#include "fft.hpp"
+#include "particleMeshSolver.hpp"
+#include "eulerIntegrator.hpp"
+#include "symplecticIntegrator.hpp"
+#include "blockTimestepIntegrator.hpp"
+#include "wisdomHolmanIntegrator.hpp"
+#include "kepler.hpp"
+#include "ias15Integrator.hpp"
+#include "randomSystemGenerator.hpp"
+#include "solarSystemGenerator.hpp"
+#include "fixedSystem.hpp"
+#include "ensembleSystem.hpp"
+#include "sweep.hpp"
+#include "simulator.hpp"
+#include "checkpoint.hpp"
+#include "trajectoryWriter.hpp"
+#include "perfCounters.hpp"
+#include "profiler.hpp"
+#include "tracer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 using Catch::Matchers::WithinRel;
 
@@ -206,4 +242,940 @@ TEST_CASE("Unit Test: calTotalEnergy", "[calTotalEnergy]")
     // Check if the total energy is correct
     std::vector<std::shared_ptr<Particle>> p_list{p0, p1, p2};
     REQUIRE_THAT(calTotalEnergy(p_list), WithinRel(expected_total_energy, 1e-6));
-}
\ No newline at end of file
+}
+
+TEST_CASE("ParticleSystem keeps aligned structure-of-arrays storage", "[ParticleSystem]")
+{
+    std::shared_ptr<Particle> p0 = std::make_shared<Particle>(10, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0));
+    std::shared_ptr<Particle> p1 = std::make_shared<Particle>(1, Eigen::Vector3d(1, 2, 3), Eigen::Vector3d(4, 5, 6), Eigen::Vector3d(7, 8, 9));
+    std::vector<std::shared_ptr<Particle>> p_list{p0, p1};
+    ParticleSystem system(p_list);
+
+    REQUIRE(system.size() == 2);
+    REQUIRE(system.stride() % 8 == 0);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(system.y()) % 64 == 0);
+    REQUIRE(system[1].getPosition().isApprox(Eigen::Vector3d(1, 2, 3)));
+    REQUIRE(system.vz()[1] == 6);
+
+    // the view writes through to the arrays and back to the particles
+    system[1].update(1.0);
+    system.copyTo(p_list);
+    REQUIRE(p1->getPosition().isApprox(Eigen::Vector3d(5, 7, 9)));
+    REQUIRE(p1->getVelocity().isApprox(Eigen::Vector3d(11, 13, 15)));
+}
+
+TEST_CASE("ParticleSystem matches the particle list", "[ParticleSystem]")
+{
+    RandomSystemGenerator generator(20);
+    ParticleSystem system = generator.generateParticleSystem();
+    std::vector<std::shared_ptr<Particle>> p_list = system.toParticles();
+
+    for (int i = 0; i < p_list.size(); i++)
+    {
+        system.updateAcceleration(i, 0.0);
+        p_list[i]->updateAcceleration(p_list, 0.0);
+        REQUIRE(system[i].getAcceleration().isApprox(p_list[i]->getAcceleration(), 1e-12));
+        REQUIRE_THAT(system.calPotentialEnergy(i), WithinRel(p_list[i]->calPotentialEnergy(p_list), 1e-12));
+    }
+}
+
+TEST_CASE("Every SIMD kernel agrees with calcAcceleration", "[Gravity][SIMD]")
+{
+    // 37 bodies, so the last SIMD block is partly padding
+    RandomSystemGenerator generator(36);
+    ParticleSystem system = generator.generateParticleSystem();
+    std::vector<std::shared_ptr<Particle>> p_list = system.toParticles();
+
+    for (double epsilon : {0.0, 0.001})
+    {
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        {
+            if (!isSimdLevelSupported(level))
+            {
+                continue;
+            }
+            getGravityKernel(level)(system.masses(), system.x(), system.y(), system.z(), system.stride(), epsilon * epsilon,
+                                    0, system.size(), system.ax(), system.ay(), system.az(), nullptr);
+            for (int i = 0; i < p_list.size(); i++)
+            {
+                Eigen::Vector3d expected_acceleration{0, 0, 0};
+                for (int j = 0; j < p_list.size(); j++)
+                {
+                    if (j != i)
+                    {
+                        expected_acceleration += calcAcceleration(*p_list[i], *p_list[j], epsilon);
+                    }
+                }
+                INFO(simdLevelName(level) << " particle " << i << " epsilon " << epsilon);
+                REQUIRE(system[i].getAcceleration().isApprox(expected_acceleration, 1e-10));
+            }
+        }
+    }
+}
+
+TEST_CASE("Symmetric pair evaluation agrees with the direct solver", "[Gravity][Solver]")
+{
+    RandomSystemGenerator generator(100);
+    ParticleSystem direct_system = generator.generateParticleSystem();
+    ParticleSystem symmetric_system = direct_system;
+    DirectSolver direct(0.001);
+    SymmetricDirectSolver symmetric(0.001);
+    direct.computeAccelerations(direct_system);
+
+    // every instruction set, serially and shared by the threads of a parallel region
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (!isSimdLevelSupported(level))
+        {
+            continue;
+        }
+        setSimdLevel(level);
+        for (int n_threads : {1, 4})
+        {
+            #pragma omp parallel num_threads(n_threads)
+            symmetric.computeAccelerations(symmetric_system);
+            for (int i = 0; i < direct_system.size(); i++)
+            {
+                INFO(simdLevelName(level) << " threads " << n_threads << " particle " << i);
+                REQUIRE(symmetric_system[i].getAcceleration().isApprox(direct_system[i].getAcceleration(), 1e-10));
+            }
+        }
+    }
+    setSimdLevel(detectSimdLevel());
+}
+
+TEST_CASE("Barnes-Hut tree approaches direct summation as theta decreases", "[Gravity][Solver]")
+{
+    RandomSystemGenerator generator(500);
+    ParticleSystem direct_system = generator.generateParticleSystem();
+    DirectSolver direct(0.001);
+    direct.computeAccelerations(direct_system);
+
+    // relative RMS error of the accelerations of a tree solve
+    auto treeError = [&](double theta, int n_threads) {
+        ParticleSystem tree_system = direct_system;
+        BarnesHutSolver tree(0.001, theta);
+        #pragma omp parallel num_threads(n_threads)
+        tree.computeAccelerations(tree_system);
+        double error2(0), norm2(0);
+        for (int i = 0; i < direct_system.size(); i++)
+        {
+            error2 += (tree_system[i].getAcceleration() - direct_system[i].getAcceleration()).squaredNorm();
+            norm2 += direct_system[i].getAcceleration().squaredNorm();
+        }
+        return std::sqrt(error2 / norm2);
+    };
+    REQUIRE(treeError(0.0, 1) < 1e-12);
+    REQUIRE(treeError(0.0, 4) < 1e-12);
+    REQUIRE(treeError(0.3, 4) < treeError(0.8, 4));
+    REQUIRE(treeError(0.5, 4) < 1e-2);
+}
+
+TEST_CASE("Barnes-Hut tree opens the cells containing the target at wide opening angles", "[Gravity][Solver]")
+{
+    // the root seen from either body passes size < theta * d at theta = 1.2, its centre of mass lying in between
+    ParticleSystem system;
+    system.addParticle(1, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    system.addParticle(1, Eigen::Vector3d(1, 1, 1), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero());
+    ParticleSystem direct_system = system;
+    DirectSolver direct;
+    direct.computeAccelerations(direct_system);
+    BarnesHutSolver tree(0, 1.2, 1);
+    tree.computeAccelerations(system);
+    for (int i = 0; i < 2; i++)
+    {
+        REQUIRE(system[i].getAcceleration().isApprox(direct_system[i].getAcceleration(), 1e-12));
+    }
+}
+
+TEST_CASE("FMM converges to direct summation as the expansion order grows", "[Gravity][Solver]")
+{
+    RandomSystemGenerator generator(2000);
+    ParticleSystem direct_system = generator.generateParticleSystem();
+    DirectSolver direct(0.001);
+    direct.computeAccelerations(direct_system);
+
+    // relative RMS error of the accelerations of an FMM solve
+    auto fmmError = [&](int order, int n_threads) {
+        ParticleSystem fmm_system = direct_system;
+        FmmSolver fmm(0.001, order, 0.5);
+        #pragma omp parallel num_threads(n_threads)
+        fmm.computeAccelerations(fmm_system);
+        double error2(0), norm2(0);
+        for (int i = 0; i < direct_system.size(); i++)
+        {
+            error2 += (fmm_system[i].getAcceleration() - direct_system[i].getAcceleration()).squaredNorm();
+            norm2 += direct_system[i].getAcceleration().squaredNorm();
+        }
+        return std::sqrt(error2 / norm2);
+    };
+    REQUIRE(fmmError(2, 1) < 1e-3);
+    REQUIRE(fmmError(4, 4) < fmmError(2, 4));
+    REQUIRE(fmmError(8, 4) < 1e-6);
+    REQUIRE_THAT(fmmError(4, 1), WithinRel(fmmError(4, 4), 1e-6));
+}
+
+TEST_CASE("3D FFT matches the definition and inverts exactly", "[FFT]")
+{
+    Fft3d fft(5);
+    const int n = fft.size();
+    REQUIRE(n == 8);
+    std::vector<std::complex<double>> data(n * n * n), original;
+    for (int i = 0; i < n * n * n; i++)
+    {
+        data[i] = std::complex<double>(std::sin(0.3 * i), std::cos(0.7 * i));
+    }
+    original = data;
+    fft.transform(data.data(), false);
+    // one coefficient by the definition
+    const double pi = std::acos(-1.0);
+    std::complex<double> expected(0);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            for (int k = 0; k < n; k++)
+                expected += original[(i * n + j) * n + k] * std::polar(1.0, -2 * pi * (1 * i + 2 * j + 3 * k) / n);
+    REQUIRE(std::abs(data[(1 * n + 2) * n + 3] - expected) < 1e-10);
+    fft.transform(data.data(), true);
+    for (int i = 0; i < n * n * n; i++)
+    {
+        REQUIRE(std::abs(data[i] - original[i]) < 1e-12);
+    }
+}
+
+TEST_CASE("Particle-mesh solver reproduces the far field of a point mass", "[Gravity][Solver]")
+{
+    for (MassAssignment assignment : {MassAssignment::CIC, MassAssignment::TSC})
+    {
+        ParticleSystem system;
+        system.addParticle(1.0, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0));
+        system.addParticle(1e-6, Eigen::Vector3d(10, 3, 1), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0));
+        ParticleMeshSolver pm(0, 64, assignment);
+        pm.computeAccelerations(system);
+        ParticleSystem direct_system = system;
+        DirectSolver direct(0);
+        direct.computeAccelerations(direct_system);
+        Eigen::Vector3d expected = direct_system[1].getAcceleration();
+        REQUIRE((system[1].getAcceleration() - expected).norm() < 1e-2 * expected.norm());
+    }
+}
+
+TEST_CASE("Block timesteps conserve energy with fewer force evaluations", "[Integrator]")
+{
+    RandomSystemGenerator generator(200, 2023, 0.01);
+    ParticleSystem system = generator.generateParticleSystem();
+    DirectSolver solver(0.01);
+    const double initial_energy = calTotalEnergy(system);
+    const int max_level = 10, n_steps = 5;
+    BlockTimestepIntegrator integrator(max_level, 0.01);
+    #pragma omp parallel num_threads(2)
+    integrator.integrate(system, solver, 0.1, n_steps);
+    REQUIRE(std::abs((calTotalEnergy(system) - initial_energy) / initial_energy) < 1e-3);
+    // every particle on the finest level would take 2^max_level force evaluations per step
+    REQUIRE(integrator.getForceEvaluations() < system.size() * n_steps * (1 << max_level) / 20);
+    // bodies close to the Sun step more often than distant ones
+    const std::vector<int> &levels = integrator.getLevels();
+    int inner(-1), outer(-1);
+    for (int i = 1; i < system.size(); i++)
+    {
+        double r = system[i].getPosition().norm();
+        if (inner < 0 || r < system[inner].getPosition().norm())
+            inner = i;
+        if (outer < 0 || r > system[outer].getPosition().norm())
+            outer = i;
+    }
+    REQUIRE(levels[inner] > levels[outer]);
+}
+
+TEST_CASE("Symplectic integrators converge with their order on a circular orbit", "[Integrator]")
+{
+    // massless planet on the unit circle around a unit mass, position error after one orbit with steps dt
+    auto orbitError = [](SymplecticScheme scheme, int n_steps) {
+        ParticleSystem system;
+        system.addParticle(1.0, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0));
+        system.addParticle(0.0, Eigen::Vector3d(1, 0, 0), Eigen::Vector3d(0, 1, 0), Eigen::Vector3d(0, 0, 0));
+        DirectSolver solver;
+        SymplecticIntegrator integrator(scheme);
+        integrator.integrate(system, solver, 2 * M_PI / n_steps, n_steps);
+        return (system[1].getPosition() - Eigen::Vector3d(1, 0, 0)).norm();
+    };
+    for (SymplecticScheme scheme : {SymplecticScheme::Leapfrog, SymplecticScheme::PositionVerlet, SymplecticScheme::Yoshida4, SymplecticScheme::Yoshida6})
+    {
+        const int order = SymplecticIntegrator(scheme).getOrder();
+        const double ratio = orbitError(scheme, 32) / orbitError(scheme, 64);
+        REQUIRE(ratio > 0.8 * std::pow(2.0, order));
+        REQUIRE(ratio < 1.2 * std::pow(2.0, order));
+    }
+}
+
+TEST_CASE("Universal-variable Kepler drift follows elliptic and hyperbolic orbits", "[Integrator]")
+{
+    // ellipse of semi-major axis 1 and eccentricity 0.5 from pericentre, period 2 pi with mu = 1
+    double x(0.5), y(0), z(0), vx(0), vy(std::sqrt(3.0)), vz(0);
+    keplerDrift(1.0, 2 * M_PI, 1, &x, &y, &z, &vx, &vy, &vz);
+    REQUIRE(std::abs(x - 0.5) < 1e-12);
+    REQUIRE(std::abs(y) < 1e-12);
+    REQUIRE(std::abs(vy - std::sqrt(3.0)) < 1e-12);
+    // a batch of hyperbolic orbits keeps its energy and angular momentum, and steps compose
+    const int n = 70;
+    std::vector<double> px(n), py(n), pz(n, 0.1), pvx(n), pvy(n), pvz(n, 0);
+    for (int i = 0; i < n; i++)
+    {
+        px[i] = 1 + 0.01 * i;
+        py[i] = 0;
+        pvx[i] = 0.2;
+        pvy[i] = 1.5 + 0.01 * i;
+    }
+    std::vector<double> qx(px), qy(py), qz(pz), qvx(pvx), qvy(pvy), qvz(pvz);
+    keplerDrift(1.0, 3.0, n, px.data(), py.data(), pz.data(), pvx.data(), pvy.data(), pvz.data());
+    for (int step = 0; step < 30; step++)
+    {
+        keplerDrift(1.0, 0.1, n, qx.data(), qy.data(), qz.data(), qvx.data(), qvy.data(), qvz.data());
+    }
+    for (int i = 0; i < n; i++)
+    {
+        double x0 = 1 + 0.01 * i, vy0 = 1.5 + 0.01 * i;
+        double energy0 = 0.5 * (0.04 + vy0 * vy0) - 1 / std::sqrt(x0 * x0 + 0.01);
+        double energy = 0.5 * (pvx[i] * pvx[i] + pvy[i] * pvy[i] + pvz[i] * pvz[i]) - 1 / std::sqrt(px[i] * px[i] + py[i] * py[i] + pz[i] * pz[i]);
+        REQUIRE(energy0 > 0);
+        REQUIRE(std::abs(energy - energy0) < 1e-12);
+        REQUIRE(std::abs((px[i] * pvy[i] - py[i] * pvx[i]) - x0 * vy0) < 1e-12);
+        REQUIRE(std::abs(px[i] - qx[i]) < 1e-10);
+        REQUIRE(std::abs(pvy[i] - qvy[i]) < 1e-10);
+    }
+}
+
+TEST_CASE("Wisdom-Holman steps track a Sun-dominated system far better than leapfrog", "[Integrator]")
+{
+    RandomSystemGenerator generator(8, 2023);
+    ParticleSystem initial = generator.generateParticleSystem();
+    DirectSolver solver;
+    const double total_time = 20;
+    ParticleSystem reference = initial;
+    SymplecticIntegrator(SymplecticScheme::Yoshida6).integrate(reference, solver, 0.005, total_time / 0.005);
+    // largest position error of any body after total_time with steps of dt
+    auto positionError = [&](Integrator &&integrator, double dt) {
+        ParticleSystem system = initial;
+        #pragma omp parallel num_threads(2)
+        integrator.integrate(system, solver, dt, std::lround(total_time / dt));
+        double error(0);
+        for (int i = 0; i < system.size(); i++)
+        {
+            error = std::max(error, (system[i].getPosition() - reference[i].getPosition()).norm());
+        }
+        return error;
+    };
+    const double wh_error = positionError(WisdomHolmanIntegrator(), 0.05);
+    REQUIRE(wh_error < 1e-3);
+    REQUIRE(wh_error < 0.01 * positionError(SymplecticIntegrator(SymplecticScheme::Leapfrog), 0.05));
+}
+
+TEST_CASE("IAS15 follows an eccentric orbit to machine precision with adaptive steps", "[Integrator]")
+{
+    // ellipse of semi-major axis 1 and eccentricity 0.9 from pericentre, as a particle list
+    std::vector<std::shared_ptr<Particle>> p_list{
+        std::make_shared<Particle>(1, Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(0, 0, 0)),
+        std::make_shared<Particle>(0, Eigen::Vector3d(0.1, 0, 0), Eigen::Vector3d(0, std::sqrt(19.0), 0), Eigen::Vector3d(0, 0, 0))};
+    DirectSolver solver;
+    Ias15Integrator integrator;
+    // the first trial step of a whole orbit is far too long and gets rejected
+    p_list = update_Solar_System(p_list, solver, integrator, 2 * M_PI, 1, 1);
+    REQUIRE((p_list[1]->getPosition() - Eigen::Vector3d(0.1, 0, 0)).norm() < 1e-12);
+    REQUIRE((p_list[1]->getVelocity() - Eigen::Vector3d(0, std::sqrt(19.0), 0)).norm() < 1e-10);
+    REQUIRE(integrator.getRejectedSteps() > 0);
+    REQUIRE(integrator.getAcceptedSteps() > 10);
+    // steps shrink near pericentre and grow near apocentre
+    REQUIRE(integrator.getStep() < 0.1);
+
+    RandomSystemGenerator generator(50, 2023);
+    ParticleSystem system = generator.generateParticleSystem();
+    const double initial_energy = calTotalEnergy(system);
+    #pragma omp parallel num_threads(2)
+    integrator.integrate(system, solver, 0.1, 10);
+    REQUIRE(std::abs((calTotalEnergy(system) - initial_energy) / initial_energy) < 1e-14);
+}
+
+TEST_CASE("Fused potentials give the same energy as the pair sum", "[Energy]")
+{
+    RandomSystemGenerator generator(99, 2023);
+    ParticleSystem system = generator.generateParticleSystem();
+    // the symmetric pair sum against the per-particle sum with half of each pair
+    double half_pair_energy(0);
+    for (int i = 0; i < system.size(); i++)
+    {
+        half_pair_energy += system.calKineticEnergy(i) + system.calPotentialEnergy(i);
+    }
+    REQUIRE_THAT(calTotalEnergy(system), WithinRel(half_pair_energy, 1e-12));
+
+    for (double epsilon : {0.0, 0.01})
+    {
+        const double expected_energy = calTotalEnergy(system, epsilon);
+        DirectSolver direct(epsilon);
+        SymmetricDirectSolver symmetric(epsilon);
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        {
+            if (!isSimdLevelSupported(level))
+            {
+                continue;
+            }
+            setSimdLevel(level);
+            for (ForceSolver *solver : {static_cast<ForceSolver *>(&direct), static_cast<ForceSolver *>(&symmetric)})
+            {
+                std::fill(system.potentials(), system.potentials() + system.stride(), 0.0);
+                solver->setComputePotential(true);
+                #pragma omp parallel num_threads(2)
+                solver->computeAccelerations(system);
+                INFO(simdLevelName(level) << " epsilon " << epsilon);
+                REQUIRE_THAT(calTotalEnergyFromPotentials(system), WithinRel(expected_energy, 1e-12));
+            }
+        }
+        setSimdLevel(detectSimdLevel());
+    }
+
+    // the leapfrog records the energies with its first and last force evaluations
+    DirectSolver solver;
+    SymplecticIntegrator integrator(SymplecticScheme::Leapfrog);
+    integrator.setRecordEnergy(true);
+    const double initial_energy = calTotalEnergy(system);
+    #pragma omp parallel num_threads(2)
+    integrator.integrate(system, solver, 1e-4, 20);
+    REQUIRE_THAT(integrator.getInitialEnergy(), WithinRel(initial_energy, 1e-12));
+    REQUIRE_THAT(integrator.getFinalEnergy(), WithinRel(calTotalEnergy(system), 1e-12));
+    REQUIRE_FALSE(solver.getComputePotential());
+}
+
+TEST_CASE("The tiled solver agrees with the direct solver", "[Gravity][Solver]")
+{
+    // 1001 bodies, so neither the tiles nor the blocks divide the system
+    RandomSystemGenerator generator(1000);
+    ParticleSystem direct_system = generator.generateParticleSystem();
+    ParticleSystem tiled_system = direct_system;
+    DirectSolver direct(0.001);
+    #pragma omp parallel
+    direct.computeAccelerations(direct_system);
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+    {
+        if (!isSimdLevelSupported(level))
+        {
+            continue;
+        }
+        setSimdLevel(level);
+        TiledDirectSolver tiled(0.001, 100, 24);
+        REQUIRE(tiled.getSourceTile() == 104);
+        #pragma omp parallel num_threads(3)
+        tiled.computeAccelerations(tiled_system);
+        for (int i = 0; i < direct_system.size(); i++)
+        {
+            INFO(simdLevelName(level) << " particle " << i);
+            REQUIRE(tiled_system[i].getAcceleration().isApprox(direct_system[i].getAcceleration(), 1e-10));
+        }
+    }
+    setSimdLevel(detectSimdLevel());
+    TiledDirectSolver tuned;
+    REQUIRE(tuned.getSourceTile() % 8 == 0);
+    REQUIRE(tuned.getTargetBlock() > 0);
+}
+
+TEST_CASE("Morton sorting reorders the storage and keeps the ids", "[MortonSorter]")
+{
+    RandomSystemGenerator generator(1000);
+    ParticleSystem system = generator.generateParticleSystem();
+    const ParticleSystem original = system;
+    MortonSorter sorter;
+    #pragma omp parallel num_threads(3)
+    sorter.sort(system);
+    REQUIRE(system.size() == original.size());
+    // every body is found under its id, and the keys never decrease along the storage
+    std::vector<bool> seen(system.size(), false);
+    double min_x = *std::min_element(original.x(), original.x() + original.size());
+    double min_y = *std::min_element(original.y(), original.y() + original.size());
+    double min_z = *std::min_element(original.z(), original.z() + original.size());
+    double size = std::max({*std::max_element(original.x(), original.x() + original.size()) - min_x,
+                            *std::max_element(original.y(), original.y() + original.size()) - min_y,
+                            *std::max_element(original.z(), original.z() + original.size()) - min_z}) * (1 + 1e-12);
+    std::uint64_t last_key = 0;
+    for (int i = 0; i < system.size(); i++)
+    {
+        const int id = system.ids()[i];
+        REQUIRE(!seen[id]);
+        seen[id] = true;
+        REQUIRE(system.masses()[i] == original.masses()[id]);
+        REQUIRE(system.x()[i] == original.x()[id]);
+        REQUIRE(system.vz()[i] == original.vz()[id]);
+        std::uint64_t key = mortonKey(system.x()[i], system.y()[i], system.z()[i], min_x, min_y, min_z, size);
+        REQUIRE(key >= last_key);
+        last_key = key;
+    }
+    // the particle list is rebuilt in id order
+    std::vector<std::shared_ptr<Particle>> p_list = system.toParticles();
+    for (int id = 0; id < original.size(); id++)
+    {
+        REQUIRE(p_list[id]->getPosition().x() == original.x()[id]);
+    }
+    #pragma omp parallel num_threads(2)
+    sorter.restore(system);
+    for (int i = 0; i < system.size(); i++)
+    {
+        REQUIRE(system.ids()[i] == i);
+        REQUIRE(system.y()[i] == original.y()[i]);
+    }
+
+    // re-sorting every few steps gives the same orbits as integrating in the original order
+    ParticleSystem sorted_run = original, plain_run = original;
+    DirectSolver solver(0.01);
+    SymplecticIntegrator integrator;
+    update_Solar_System(sorted_run, solver, integrator, 1e-3, 0.01, 10, 3);
+    update_Solar_System(plain_run, solver, integrator, 1e-3, 0.01, 10);
+    for (int i = 0; i < original.size(); i++)
+    {
+        REQUIRE(sorted_run.ids()[i] == i);
+        REQUIRE(sorted_run[i].getPosition().isApprox(plain_run[i].getPosition(), 1e-10));
+    }
+}
+
+TEST_CASE("Small systems step on the calling thread with the same result", "[Integrator]")
+{
+    REQUIRE(getParallelThreshold() >= 16);
+    RandomSystemGenerator generator(8);
+    ParticleSystem serial = generator.generateParticleSystem();
+    ParticleSystem parallel = serial;
+    DirectSolver solver(0.001);
+    // drift-kick-drift steps, which the fixed-size engine does not take
+    SymplecticIntegrator integrator(SymplecticScheme::PositionVerlet);
+    // one kernel call for all targets outside a parallel region, one per target inside
+    update_Solar_System(serial, solver, integrator, 1e-3, 0.1, 100);
+    #pragma omp parallel num_threads(2)
+    integrator.integrate(parallel, solver, 1e-3, 100);
+    for (int i = 0; i < serial.size(); i++)
+    {
+        REQUIRE(serial[i].getPosition() == parallel[i].getPosition());
+        REQUIRE(serial[i].getVelocity() == parallel[i].getVelocity());
+    }
+}
+
+TEST_CASE("Fixed-size engine steps the solar system like the general integrators", "[Integrator]")
+{
+    SolarSystemGenerator generator;
+    const ParticleSystem original = generator.generateParticleSystem();
+    REQUIRE(original.size() == 9);
+    for (double epsilon : {0.0, 0.01})
+    {
+        DirectSolver solver(epsilon);
+        EulerIntegrator euler;
+        SymplecticIntegrator leapfrog;
+        ParticleSystem euler_general = original, leapfrog_general = original;
+        euler.integrate(euler_general, solver, 1e-4, 1000);
+        leapfrog.integrate(leapfrog_general, solver, 1e-4, 1000);
+        FixedSystem<9> euler_fixed(original, epsilon), leapfrog_fixed(original, epsilon);
+        euler_fixed.eulerSteps(1e-4, 1000);
+        leapfrog_fixed.leapfrogSteps(1e-4, 1000);
+        ParticleSystem euler_result = original, leapfrog_result = original;
+        euler_fixed.copyTo(euler_result);
+        leapfrog_fixed.copyTo(leapfrog_result);
+        for (int i = 0; i < original.size(); i++)
+        {
+            REQUIRE(euler_result[i].getPosition().isApprox(euler_general[i].getPosition(), 1e-10));
+            REQUIRE(euler_result[i].getVelocity().isApprox(euler_general[i].getVelocity(), 1e-10));
+            REQUIRE(leapfrog_result[i].getPosition().isApprox(leapfrog_general[i].getPosition(), 1e-10));
+            REQUIRE(leapfrog_result[i].getVelocity().isApprox(leapfrog_general[i].getVelocity(), 1e-10));
+        }
+    }
+
+    // update_Solar_System hands such runs to the engine
+    ParticleSystem dispatched = original, general = original;
+    DirectSolver solver;
+    SymplecticIntegrator leapfrog;
+    update_Solar_System(dispatched, solver, leapfrog, 1e-4, 0.1, 1000);
+    leapfrog.integrate(general, solver, 1e-4, 1000);
+    for (int i = 0; i < original.size(); i++)
+    {
+        REQUIRE(dispatched[i].getPosition().isApprox(general[i].getPosition(), 1e-10));
+    }
+}
+
+TEST_CASE("Ensemble steps each system like the general integrators", "[Integrator]")
+{
+    // ten systems, so that the second batch is padded
+    std::vector<ParticleSystem> systems;
+    for (int seed = 1; seed <= 10; seed++)
+    {
+        RandomSystemGenerator generator(11, seed);
+        systems.push_back(generator.generateParticleSystem());
+    }
+    for (EnsembleScheme scheme : {EnsembleScheme::Euler, EnsembleScheme::Leapfrog})
+    {
+        EnsembleSystem ensemble(systems, 0.01);
+        REQUIRE(ensemble.size() == 10);
+        REQUIRE(ensemble.getBodies() == 12);
+        std::vector<double> initial_energies = ensemble.calTotalEnergies();
+        #pragma omp parallel num_threads(2)
+        ensemble.integrate(scheme, 1e-3, 200);
+        std::vector<double> final_energies = ensemble.calTotalEnergies();
+        DirectSolver solver(0.01);
+        EulerIntegrator euler;
+        SymplecticIntegrator leapfrog;
+        for (int k = 0; k < ensemble.size(); k++)
+        {
+            ParticleSystem general = systems[k];
+            REQUIRE_THAT(initial_energies[k], WithinRel(calTotalEnergy(general, 0.01), 1e-12));
+            if (scheme == EnsembleScheme::Euler)
+            {
+                euler.integrate(general, solver, 1e-3, 200);
+            }
+            else
+            {
+                leapfrog.integrate(general, solver, 1e-3, 200);
+            }
+            REQUIRE_THAT(final_energies[k], WithinRel(calTotalEnergy(general, 0.01), 1e-10));
+            ParticleSystem stepped = ensemble.getSystem(k);
+            for (int i = 0; i < general.size(); i++)
+            {
+                REQUIRE(stepped[i].getPosition().isApprox(general[i].getPosition(), 1e-10));
+                REQUIRE(stepped[i].getVelocity().isApprox(general[i].getVelocity(), 1e-10));
+            }
+        }
+    }
+}
+
+TEST_CASE("Sweep runs every combination like separate runs", "[Sweep]")
+{
+    auto make_solver = [](double epsilon) { return std::make_shared<DirectSolver>(epsilon); };
+    auto make_integrator = []() { return std::make_shared<SymplecticIntegrator>(); };
+    Sweep sweep({7, 20}, {1, 2}, {0.01}, {1e-3, 2e-3}, 0, 50, make_solver, make_integrator);
+    REQUIRE(sweep.getRuns().size() == 8);
+    sweep.run();
+    for (const SweepRun &run : sweep.getRuns())
+    {
+        RandomSystemGenerator generator(run.n_particles, run.seed);
+        ParticleSystem system = generator.generateParticleSystem();
+        DirectSolver solver(run.epsilon);
+        SymplecticIntegrator integrator;
+        REQUIRE(run.n_bodies == system.size());
+        REQUIRE(run.n_steps == 50);
+        REQUIRE(run.initial_energy == calTotalEnergy(system, run.epsilon));
+        advanceSystem(system, solver, integrator, run.dt, run.n_steps);
+        REQUIRE_THAT(run.final_energy, WithinRel(calTotalEnergy(system, run.epsilon), 1e-12));
+    }
+}
+
+TEST_CASE("Simulator resumes where it paused without extra force evaluations", "[Simulator]")
+{
+    // the solar system goes to the fixed-size engine, the random one to the general integrator
+    for (ParticleSystem original : {SolarSystemGenerator().generateParticleSystem(), RandomSystemGenerator(20).generateParticleSystem()})
+    {
+        Simulator simulator(original, std::make_shared<DirectSolver>(0.01), std::make_shared<SymplecticIntegrator>(), 1e-3);
+        for (int n = 0; n < 5; n++)
+        {
+            simulator.step();
+        }
+        simulator.advance(45);
+        REQUIRE(simulator.runUntil(0.1) == 50);
+        REQUIRE(simulator.runUntil(0.1) == 0);
+        REQUIRE(simulator.getSteps() == 100);
+        REQUIRE_THAT(simulator.getTime(), WithinRel(0.1, 1e-12));
+        // one opening force evaluation for all calls
+        REQUIRE(simulator.getForceEvaluations() == original.size() * 101LL);
+
+        ParticleSystem general = original;
+        DirectSolver solver(0.01);
+        SymplecticIntegrator integrator;
+        integrator.integrate(general, solver, 1e-3, 100);
+        ParticleSystem stepped = simulator.getSystem();
+        for (int i = 0; i < original.size(); i++)
+        {
+            REQUIRE(stepped[i].getPosition().isApprox(general[i].getPosition(), 1e-10));
+            REQUIRE(stepped[i].getVelocity().isApprox(general[i].getVelocity(), 1e-10));
+        }
+
+        // an edit between steps brings the forces back up to date
+        simulator.editSystem().vx()[0] += 1e-3;
+        simulator.setDt(2e-3);
+        simulator.advance(10);
+        REQUIRE(simulator.getForceEvaluations() == original.size() * 112LL);
+        REQUIRE_THAT(simulator.getTime(), WithinRel(0.12, 1e-12));
+    }
+}
+
+TEST_CASE("Simulator carries the state of the adaptive and Kepler integrators between calls", "[Simulator]")
+{
+    const ParticleSystem original = SolarSystemGenerator().generateParticleSystem();
+    const std::vector<std::function<std::shared_ptr<Integrator>()>> makers = {
+        [] { return std::make_shared<BlockTimestepIntegrator>(4, 0.01); },
+        [] { return std::make_shared<WisdomHolmanIntegrator>(); },
+        [] { return std::make_shared<Ias15Integrator>(); }};
+    for (const auto &make : makers)
+    {
+        Simulator stepped(original, std::make_shared<DirectSolver>(), make(), 1e-2);
+        Simulator advanced(original, std::make_shared<DirectSolver>(), make(), 1e-2);
+        for (int n = 0; n < 200; n++)
+        {
+            stepped.step();
+        }
+        advanced.advance(200);
+        const bool adaptive = dynamic_cast<Ias15Integrator *>(&advanced.getIntegrator()) != nullptr;
+        INFO("force evaluations " << stepped.getForceEvaluations() << " stepped, " << advanced.getForceEvaluations() << " in one call");
+        if (adaptive)
+        {
+            // a step per call at least, but no restart of the step control and the predictor
+            REQUIRE(stepped.getForceEvaluations() < 20LL * original.size() * 200);
+        }
+        else
+        {
+            REQUIRE(stepped.getForceEvaluations() == advanced.getForceEvaluations());
+        }
+        ParticleSystem a = stepped.getSystem(), b = advanced.getSystem();
+        for (int i = 0; i < original.size(); i++)
+        {
+            if (adaptive)
+            {
+                REQUIRE(a[i].getPosition().isApprox(b[i].getPosition(), 1e-9));
+            }
+            else
+            {
+                REQUIRE(a[i].getPosition() == b[i].getPosition());
+                REQUIRE(a[i].getVelocity() == b[i].getVelocity());
+            }
+        }
+    }
+}
+
+TEST_CASE("Checkpoints resume a run bit for bit", "[Checkpoint]")
+{
+    const std::string path = "test_checkpoint.ckp";
+    ParticleSystem original = RandomSystemGenerator(20, 3, 0.01).generateParticleSystem();
+    Simulator uninterrupted(original, std::make_shared<DirectSolver>(0.01), std::make_shared<SymplecticIntegrator>(), 1e-3);
+    uninterrupted.advance(30);
+    uninterrupted.advance(30);
+
+    Simulator interrupted(original, std::make_shared<DirectSolver>(0.01), std::make_shared<SymplecticIntegrator>(), 1e-3);
+    interrupted.advance(30);
+    CheckpointInfo info;
+    info.task = "RS";
+    info.solver = "direct";
+    info.integrator = "kdk";
+    info.seed = 3;
+    info.epsilon = 0.01;
+    info.target_steps = 60;
+    info.interval = 30;
+    info.theta = 0.7;
+    info.order = 6;
+    info.max_level = 3;
+    info.tolerance = 1e-8;
+    info.simd = "scalar";
+    std::string error;
+    REQUIRE(writeCheckpoint(path, interrupted, info, error));
+
+    ParticleSystem system;
+    double dt(0);
+    SimulatorProgress progress;
+    CheckpointInfo loaded;
+    REQUIRE(readCheckpoint(path, system, dt, progress, loaded, error));
+    REQUIRE(dt == 1e-3);
+    REQUIRE(progress.steps == 30);
+    REQUIRE(progress.accelerations_current);
+    REQUIRE(loaded.task == "RS");
+    REQUIRE(loaded.integrator == "kdk");
+    REQUIRE(loaded.seed == 3);
+    REQUIRE(loaded.target_steps == 60);
+    REQUIRE(loaded.theta == 0.7);
+    REQUIRE(loaded.order == 6);
+    REQUIRE(loaded.max_level == 3);
+    REQUIRE(loaded.tolerance == 1e-8);
+    REQUIRE(loaded.simd == "scalar");
+    Simulator resumed(std::move(system), std::make_shared<DirectSolver>(0.01), std::make_shared<SymplecticIntegrator>(), dt);
+    resumed.setProgress(progress);
+    resumed.advance(30);
+    REQUIRE(resumed.getTime() == uninterrupted.getTime());
+    REQUIRE(resumed.getForceEvaluations() == uninterrupted.getForceEvaluations());
+    const ParticleSystem &a = resumed.getSystem(), &b = uninterrupted.getSystem();
+    REQUIRE(a.size() == b.size());
+    for (std::size_t d = 0; d < 3; d++)
+    {
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            REQUIRE(a.x()[d * a.stride() + i] == b.x()[d * b.stride() + i]);
+            REQUIRE(a.vx()[d * a.stride() + i] == b.vx()[d * b.stride() + i]);
+        }
+    }
+
+    // ids that are not a permutation of the bodies are refused, the ids block closes the file
+    {
+        const std::size_t stride = interrupted.getSystem().stride();
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-static_cast<std::streamoff>(stride * sizeof(int)), std::ios::end);
+        const int duplicate = 1;
+        file.write(reinterpret_cast<const char *>(&duplicate), sizeof(int));
+    }
+    REQUIRE_FALSE(readCheckpoint(path, system, dt, progress, loaded, error));
+    REQUIRE(error.find("corrupt") != std::string::npos);
+
+    // a truncated file is refused and leaves the arguments alone
+    std::filesystem::resize_file(path, 1000);
+    REQUIRE_FALSE(readCheckpoint(path, system, dt, progress, loaded, error));
+    REQUIRE(error.find("truncated") != std::string::npos);
+    REQUIRE(progress.steps == 30);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Trajectory frames hold the positions handed to the writer", "[TrajectoryWriter]")
+{
+    const std::string path = "test_trajectory.trj";
+    ParticleSystem system = RandomSystemGenerator(10, 5).generateParticleSystem();
+    const std::size_t n = system.size();
+    DirectSolver solver;
+    SymplecticIntegrator integrator;
+    std::vector<float> expected;
+    {
+        TrajectoryWriter trajectory(path, n, 5);
+        REQUIRE(trajectory.isOpen());
+        // a system of another size does not fit the frames
+        REQUIRE(!trajectory.submit(ParticleSystem(n - 1), 0, 0));
+        for (int frame = 0; frame < 4; frame++)
+        {
+            REQUIRE(trajectory.submit(system, 5 * frame, 5e-3 * frame));
+            for (int d = 0; d < 3; d++)
+            {
+                for (std::size_t i = 0; i < n; i++)
+                {
+                    expected.push_back(static_cast<float>(system.x()[d * system.stride() + i]));
+                }
+            }
+            advanceSystem(system, solver, integrator, 1e-3, 5);
+        }
+        REQUIRE(trajectory.close());
+        REQUIRE(trajectory.getWritten() == 4);
+        REQUIRE(trajectory.getDropped() == 0);
+    }
+    std::ifstream file(path, std::ios::binary);
+    char magic[8];
+    std::uint32_t version, coordinate_bytes;
+    std::uint64_t n_bodies;
+    file.read(magic, 8);
+    file.read(reinterpret_cast<char *>(&version), 4);
+    file.read(reinterpret_cast<char *>(&coordinate_bytes), 4);
+    file.read(reinterpret_cast<char *>(&n_bodies), 8);
+    REQUIRE(std::string(magic, 8) == "NBODYTRJ");
+    REQUIRE(coordinate_bytes == 4);
+    REQUIRE(n_bodies == n);
+    file.seekg(64);
+    for (int frame = 0; frame < 4; frame++)
+    {
+        std::int64_t step;
+        double time;
+        std::vector<float> positions(3 * n);
+        file.read(reinterpret_cast<char *>(&step), 8);
+        file.read(reinterpret_cast<char *>(&time), 8);
+        file.read(reinterpret_cast<char *>(positions.data()), positions.size() * sizeof(float));
+        REQUIRE(step == 5 * frame);
+        REQUIRE(time == 5e-3 * frame);
+        REQUIRE(std::equal(positions.begin(), positions.end(), expected.begin() + frame * 3 * n));
+    }
+    REQUIRE(file.peek() == EOF);
+    file.close();
+
+    // snapshots are dropped rather than waited for, and every one is counted
+    {
+        TrajectoryWriter trajectory(path, n, 1, TrajectoryPolicy::Drop);
+        for (int frame = 0; frame < 1000; frame++)
+        {
+            trajectory.submit(system, frame, frame);
+        }
+        REQUIRE(trajectory.close());
+        REQUIRE(trajectory.getWritten() + trajectory.getDropped() == 1000);
+        REQUIRE(trajectory.getStalls() == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Profiler reports the recorded phases as JSON", "[Profiler]")
+{
+    Profiler &profiler = Profiler::get();
+    profiler.reset();
+    {
+        ProfileScope scope(ProfilePhase::IO);
+    }
+    // 4 steps of 1.5 us each fall into the bin [1024, 2048) ns
+    profiler.record(ProfilePhase::Step, 6e-6, 4);
+    profiler.record(ProfilePhase::Force, 2e-6);
+    profiler.addInteractions(400);
+    std::ostringstream out;
+    profiler.writeReport(out);
+    const std::string report = out.str();
+    REQUIRE(report.find("\"io\": {\n      \"count\": 1,") != std::string::npos);
+    REQUIRE(report.find("\"step\": {\n      \"count\": 4,") != std::string::npos);
+    REQUIRE(report.find("\"histogram_log2_ns\": [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4]") != std::string::npos);
+    REQUIRE(report.find("\"interactions\": 400,") != std::string::npos);
+    // 400 interactions in 2 us
+    REQUIRE(report.find("\"interactions_per_second\": 2e+08,") != std::string::npos);
+    REQUIRE(report.find("\"gflops\": 4\n") != std::string::npos);
+    profiler.reset();
+}
+
+TEST_CASE("Tracer keeps sampled windows in per-thread rings", "[Tracer]")
+{
+    Tracer &tracer = Tracer::get();
+    tracer.start("", 2, 4);
+    const auto origin = std::chrono::steady_clock::now();
+    auto at = [&](int us) { return origin + std::chrono::microseconds(us); };
+    // three windows of a force evaluation and a kick, the second one is not sampled
+    for (int window = 0; window < 3; window++)
+    {
+        tracer.record(ProfilePhase::Force, at(100 * window), at(100 * window + 50));
+        tracer.record(ProfilePhase::Integration, at(100 * window + 50), at(100 * window + 60));
+    }
+    tracer.record(ProfilePhase::Energy, at(300), at(310));
+    tracer.stop();
+    // 5 events kept, the oldest overwritten by the last ones
+    REQUIRE(tracer.getRecorded() == 4);
+    REQUIRE(tracer.getDropped() == 1);
+    std::ostringstream out;
+    tracer.writeTrace(out);
+    const std::string trace = out.str();
+    REQUIRE(trace.find("\"name\": \"thread_name\", \"ph\": \"M\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\": \"integration\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": 50.") != std::string::npos);
+    REQUIRE(trace.find("\"dur\": 10.000}") != std::string::npos);
+    REQUIRE(trace.find("\"ts\": 100.") == std::string::npos);
+    REQUIRE(trace.find("\"name\": \"energy\"") != std::string::npos);
+}
+
+TEST_CASE("Hardware counters count the profiled phases or say why they cannot", "[PerfCounters]")
+{
+    PerfCounters &counters = PerfCounters::get();
+    Profiler &profiler = Profiler::get();
+    profiler.reset();
+    std::string error;
+    if (!counters.start(error))
+    {
+        // no counters in most containers and virtual machines, the profile keeps its wall times
+        REQUIRE(!error.empty());
+        REQUIRE(!counters.isActive());
+        std::ostringstream out;
+        profiler.writeReport(out);
+        REQUIRE(out.str().find("\"hardware_counters\": false") != std::string::npos);
+        REQUIRE(out.str().find("\"counters\"") == std::string::npos);
+        return;
+    }
+    volatile double sink = 0;
+    PerfValues before, after;
+    REQUIRE(counters.read(before));
+    {
+        ProfileScope scope(ProfilePhase::Force);
+        for (int k = 0; k < 1000000; k++)
+        {
+            sink = sink + std::sqrt(static_cast<double>(k));
+        }
+    }
+    REQUIRE(counters.read(after));
+    for (int e = 0; e < PERF_EVENTS; e++)
+    {
+        REQUIRE(after[e] >= before[e]);
+    }
+    if (counters.isAvailable(PerfEvent::Instructions))
+    {
+        REQUIRE(after[static_cast<int>(PerfEvent::Instructions)] - before[static_cast<int>(PerfEvent::Instructions)] > 1000000);
+    }
+    std::ostringstream out;
+    profiler.writeReport(out);
+    REQUIRE(out.str().find("\"hardware_counters\": true") != std::string::npos);
+    REQUIRE(out.str().find("\"counters\": {\"cycles\": ") != std::string::npos);
+    profiler.reset();
+}